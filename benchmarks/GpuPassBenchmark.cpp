@@ -0,0 +1,316 @@
+// Runs the GPU pipeline headlessly over a matrix of settings and procedural scenes and writes per pass timings and
+// memory as JSON, so numbers can be compared across drivers and hardware.
+// Usage: GpuPassBenchmark [--width W] [--height H] [--max-levels 6,8] [--probes 2,4] [--step-sizes 0.01,0.005]
+//                         [--formats rgba32f,rgba16f] [--layouts probe-first,direction-first,morton] [--warmup N]
+//                         [--frames N] [--output FILE] [--prefer-cpu]
+//
+
+#include <DistanceFieldBuilder.h>
+#include <HeadlessContext.h>
+#include <RadianceCascadeRenderer.h>
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <map>
+#include <print>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+    struct Options {
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        std::vector<uint32_t> maxLevels = {6, 8};
+        std::vector<uint32_t> probes = {2, 4};
+        std::vector<float> stepSizes = {0.01f, 0.005f};
+        std::vector<std::string> formats = {"rgba32f", "rgba16f"};
+        std::vector<std::string> layouts = {"probe-first"};
+        uint32_t warmupFrames = 16;
+        uint32_t frames = 64;
+        std::string output = "gpu_benchmark.json";
+        bool preferCPU = false;
+    };
+
+    template<typename T>
+    std::vector<T> ParseList(const std::string &text) {
+        std::vector<T> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if constexpr (std::is_same_v<T, std::string>) values.push_back(item);
+            else if constexpr (std::is_floating_point_v<T>) values.push_back(std::stof(item));
+            else values.push_back(std::stoul(item));
+        }
+        return values;
+    }
+
+    Options ParseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            if (!std::strcmp(argv[i], "--prefer-cpu")) {
+                options.preferCPU = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::print("Missing value for {}\n", argv[i]);
+                break;
+            }
+            std::string value = argv[++i];
+            if (!std::strcmp(argv[i - 1], "--width")) options.width = std::stoul(value);
+            else if (!std::strcmp(argv[i - 1], "--height")) options.height = std::stoul(value);
+            else if (!std::strcmp(argv[i - 1], "--max-levels")) options.maxLevels = ParseList<uint32_t>(value);
+            else if (!std::strcmp(argv[i - 1], "--probes")) options.probes = ParseList<uint32_t>(value);
+            else if (!std::strcmp(argv[i - 1], "--step-sizes")) options.stepSizes = ParseList<float>(value);
+            else if (!std::strcmp(argv[i - 1], "--formats")) options.formats = ParseList<std::string>(value);
+            else if (!std::strcmp(argv[i - 1], "--layouts")) options.layouts = ParseList<std::string>(value);
+            else if (!std::strcmp(argv[i - 1], "--warmup")) options.warmupFrames = std::stoul(value);
+            else if (!std::strcmp(argv[i - 1], "--frames")) options.frames = std::max(1ul, std::stoul(value));
+            else if (!std::strcmp(argv[i - 1], "--output")) options.output = value;
+            else std::print("Unknown option {}\n", argv[i - 1]);
+        }
+        return options;
+    }
+
+    VkFormat ParseFormat(const std::string &name) {
+        if (name == "rgba32f") return VK_FORMAT_R32G32B32A32_SFLOAT;
+        if (name == "rgba16f") return VK_FORMAT_R16G16B16A16_SFLOAT;
+        throw std::runtime_error(std::format("Unknown cascade format {}, expected rgba32f or rgba16f", name));
+    }
+
+    RadianceCascadeRenderer::CascadeLayout ParseLayout(const std::string &name) {
+        if (name == "probe-first") return RadianceCascadeRenderer::PROBE_FIRST;
+        if (name == "direction-first") return RadianceCascadeRenderer::DIRECTION_FIRST;
+        if (name == "morton") return RadianceCascadeRenderer::MORTON;
+        throw std::runtime_error(
+            std::format("Unknown cascade layout {}, expected probe-first, direction-first or morton", name));
+    }
+
+    struct SceneDescription {
+        const char *name;
+        uint32_t emitterCount;
+        float emitterMinRadius;
+        float emitterMaxRadius;
+        uint32_t occluderCount;
+        float occluderMinRadius;
+        float occluderMaxRadius;
+    };
+
+    // Radii are fractions of the height so scenes look the same at any resolution
+    const SceneDescription SCENES[] = {
+        {"sparse", 3, .02f, .04f, 2, .04f, .06f},
+        {"dense", 6, .01f, .03f, 150, .01f, .04f},
+        {"many_emitters", 400, .004f, .012f, 20, .01f, .03f},
+    };
+
+    // Seeded circles rasterized into an occupancy and emission raster, then turned into an SDF on the CPU
+    reference::Texture BuildScene(const SceneDescription &scene, uint32_t width, uint32_t height,
+                                  ThreadPool &threadPool) {
+        uint32_t state = 12345;
+        auto next = [&state] {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) / 16777216.0f;
+        };
+
+        std::vector<uint8_t> occupancy(static_cast<size_t>(width) * height);
+        std::vector<reference::Float4> emission(occupancy.size());
+
+        auto drawCircle = [&](float radius, reference::Float4 color) {
+            float centerX = next() * width;
+            float centerY = next() * height;
+            radius *= height;
+            int x0 = std::max(0, (int) (centerX - radius));
+            int x1 = std::min((int) width - 1, (int) (centerX + radius));
+            int y0 = std::max(0, (int) (centerY - radius));
+            int y1 = std::min((int) height - 1, (int) (centerY + radius));
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    if (std::hypot(x - centerX, y - centerY) <= radius) {
+                        size_t index = static_cast<size_t>(y) * width + x;
+                        occupancy[index] = 1;
+                        emission[index] = color;
+                    }
+                }
+            }
+        };
+
+        for (uint32_t i = 0; i < scene.occluderCount; i++) {
+            drawCircle(std::lerp(scene.occluderMinRadius, scene.occluderMaxRadius, next()), {0, 0, 0, 0});
+        }
+        for (uint32_t i = 0; i < scene.emitterCount; i++) {
+            float radius = std::lerp(scene.emitterMinRadius, scene.emitterMaxRadius, next());
+            drawCircle(radius, {next(), next(), next(), 0});
+        }
+
+        return cpu::BuildDistanceField(width, height, occupancy, emission, &threadPool);
+    }
+
+    struct Summary {
+        double median;
+        double p99;
+    };
+
+    Summary Summarize(std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        size_t p99Index = std::min(samples.size() - 1, (size_t) std::ceil(samples.size() * 0.99) - 1);
+        return {samples[samples.size() / 2], samples[p99Index]};
+    }
+
+    std::string DeviceJson(VkPhysicalDevice physicalDevice) {
+        VkPhysicalDeviceDriverProperties driverProperties{};
+        driverProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &driverProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        return std::format(
+            R"({{"name": "{}", "driver": "{}", "driver_info": "{}", "driver_version": {}, "api_version": "{}.{}.{}"}})",
+            properties.properties.deviceName, driverProperties.driverName, driverProperties.driverInfo,
+            properties.properties.driverVersion, VK_API_VERSION_MAJOR(properties.properties.apiVersion),
+            VK_API_VERSION_MINOR(properties.properties.apiVersion),
+            VK_API_VERSION_PATCH(properties.properties.apiVersion));
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options = ParseOptions(argc, argv);
+    VkExtent2D extent{options.width, options.height};
+
+    HeadlessContext context;
+    if (!context.Init(options.preferCPU)) {
+        context.Destroy();
+        return 1;
+    }
+
+    GpuTimer gpuTimer;
+    gpuTimer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetQueueFamilyIndex(), 1, 32);
+    if (!gpuTimer.Supported()) {
+        std::print("The device has no timestamp support, nothing to measure\n");
+        context.Destroy();
+        return 1;
+    }
+
+    ThreadPool threadPool;
+    std::vector<reference::Texture> scenes;
+    for (const auto &scene: SCENES) {
+        scenes.push_back(BuildScene(scene, extent.width, extent.height, threadPool));
+    }
+
+    std::ofstream file(options.output);
+    file << "{\n  \"device\": " << DeviceJson(context.GetPhysicalDevice()) << ",\n";
+    file << std::format("  \"extent\": [{}, {}],\n  \"warmup_frames\": {},\n  \"frames\": {},\n  \"results\": [",
+                        extent.width, extent.height, options.warmupFrames, options.frames);
+
+    bool firstResult = true;
+    for (const auto &formatName: options.formats) {
+        RadianceCascadeRenderer renderer;
+        bool initialized = false;
+
+        for (uint32_t maxLevel: options.maxLevels) {
+            for (uint32_t probes: options.probes) {
+                for (float stepSize: options.stepSizes) {
+                    RadianceCascadeSettings settings{
+                        .maxLevel = maxLevel,
+                        .verticalProbeCountAtMaxLevel = probes,
+                        .radius = .01f,
+                        .radiusMultiplier = 1.5f,
+                        .raymarchStepSize = stepSize,
+                        .attenuation = 100.f
+                    };
+
+                    if (!initialized) {
+                        renderer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetAllocator(), extent,
+                                      settings, 1, ParseFormat(formatName));
+                        initialized = true;
+                    } else {
+                        renderer.SetConfiguration(extent, settings);
+                    }
+
+                    // Every scene with every layout
+                    for (size_t run = 0; run < scenes.size() * options.layouts.size(); run++) {
+                        size_t sceneIndex = run / options.layouts.size();
+                        const char *sceneName = SCENES[sceneIndex].name;
+                        const std::string &layoutName = options.layouts[run % options.layouts.size()];
+                        renderer.SetCascadeLayout(ParseLayout(layoutName));
+
+                        context.Submit([&](VkCommandBuffer cmd) { renderer.RecordInitCommands(cmd); });
+                        context.WriteImage(renderer.GetSDFImage(), extent, &scenes[sceneIndex].Data()[0].x);
+
+                        std::vector<std::string> passOrder;
+                        std::map<std::string, std::vector<double> > passTimings;
+                        std::vector<double> frameTimings;
+
+                        for (uint32_t frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+                            renderer.BeginFrame();
+                            context.Submit([&](VkCommandBuffer cmd) {
+                                gpuTimer.BeginFrame(cmd, 0);
+                                // Nothing is drawn during the measured frames, the SDF is uploaded once per scene
+                                renderer.RecordFrameCommands(cmd, {}, false, gpuTimer);
+                            });
+                            gpuTimer.Resolve(0);
+
+                            if (frame < options.warmupFrames) {
+                                continue;
+                            }
+
+                            frameTimings.push_back(gpuTimer.GetFrameMilliseconds());
+                            for (const auto &passTiming: gpuTimer.GetPassTimings()) {
+                                auto &timings = passTimings[passTiming.name];
+                                if (timings.empty()) {
+                                    passOrder.push_back(passTiming.name);
+                                }
+                                timings.push_back(passTiming.milliseconds);
+                            }
+                        }
+
+                        VmaTotalStatistics statistics;
+                        vmaCalculateStatistics(context.GetAllocator(), &statistics);
+
+                        Summary frameSummary = Summarize(frameTimings);
+                        auto [cascadeWidth, cascadeHeight] = renderer.GetCascadeExtent();
+
+                        std::print("{:<14} {:<8} {:<15} level {:>2} probes {:>2} step {:<6} frame median {:>8.3f} ms, "
+                                   "p99 {:>8.3f} ms\n", sceneName, formatName, layoutName, maxLevel, probes, stepSize,
+                                   frameSummary.median, frameSummary.p99);
+
+                        file << (firstResult ? "\n" : ",\n") << std::format(
+                            "    {{\"scene\": \"{}\", \"format\": \"{}\", \"layout\": \"{}\", \"max_level\": {}, "
+                            "\"vertical_probe_count\": {}, \"step_size\": {}, \"cascade_extent\": [{}, {}], "
+                            "\"image_bytes\": {}, \"vma_allocation_bytes\": {}, \"vma_block_bytes\": {},\n"
+                            "     \"frame\": {{\"median_ms\": {:.4f}, \"p99_ms\": {:.4f}}},\n     \"passes\": [",
+                            sceneName, formatName, layoutName, maxLevel, probes, stepSize, cascadeWidth, cascadeHeight,
+                            renderer.GetImageMemoryBytes(), statistics.total.statistics.allocationBytes,
+                            statistics.total.statistics.blockBytes, frameSummary.median, frameSummary.p99);
+                        firstResult = false;
+
+                        for (size_t i = 0; i < passOrder.size(); i++) {
+                            Summary summary = Summarize(passTimings[passOrder[i]]);
+                            file << (i ? ",\n" : "\n") << std::format(
+                                R"(       {{"name": "{}", "median_ms": {:.4f}, "p99_ms": {:.4f}}})", passOrder[i],
+                                summary.median, summary.p99);
+                        }
+                        file << "\n     ]}";
+                    }
+                }
+            }
+        }
+
+        if (initialized) {
+            renderer.Destroy();
+        }
+    }
+
+    file << "\n  ]\n}\n";
+    std::print("Results written to {}\n", options.output);
+
+    gpuTimer.Destroy();
+    context.Destroy();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Compares the scalar reference raymarcher with the vectorized one, single and multi threaded, level by level.
+// Usage: RaymarchBenchmark [--width W] [--height H] [--max-level L] [--probes P] [--iterations N] [--threads T]
+//
+
+#include <ReferencePipeline.h>
+#include <SimdRaymarcher.h>
+#include <ThreadPool.h>
+#include <TiledSDF.h>
+#include <LaneSimd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <print>
+#include <string>
+
+namespace {
+    struct Options {
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        uint32_t maxLevel = 6;
+        uint32_t probes = 4;
+        uint32_t iterations = 5;
+        uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    };
+
+    Options ParseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i + 1 < argc; i += 2) {
+            uint32_t value = std::stoul(argv[i + 1]);
+            if (!std::strcmp(argv[i], "--width")) options.width = value;
+            else if (!std::strcmp(argv[i], "--height")) options.height = value;
+            else if (!std::strcmp(argv[i], "--max-level")) options.maxLevel = value;
+            else if (!std::strcmp(argv[i], "--probes")) options.probes = value;
+            else if (!std::strcmp(argv[i], "--iterations")) options.iterations = value;
+            else if (!std::strcmp(argv[i], "--threads")) options.threads = value;
+            else std::print("Unknown option {}\n", argv[i]);
+        }
+        return options;
+    }
+
+    // Deterministic scene, a few emitters and occluders drawn like brush strokes
+    void DrawScene(reference::Texture &sdf) {
+        uint32_t state = 12345;
+        auto next = [&state] {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        };
+
+        for (int i = 0; i < 24; i++) {
+            // Round dabs, zero length segments
+            reference::BrushSegment segment{};
+            segment.startX = segment.endX = static_cast<float>(next() % sdf.Width());
+            segment.startY = segment.endY = static_cast<float>(next() % sdf.Height());
+            segment.radius = static_cast<float>(4 + next() % 28);
+            // Half of them are black occluders
+            bool emitter = i % 2 == 0;
+            segment.r = emitter ? (next() % 256) / 256.0f : 0.0f;
+            segment.g = emitter ? (next() % 256) / 256.0f : 0.0f;
+            segment.b = emitter ? (next() % 256) / 256.0f : 0.0f;
+            reference::DrawToSDFTexture(sdf, {&segment, 1});
+        }
+    }
+
+    double TimeMilliseconds(uint32_t iterations, const std::function<void()> &function) {
+        // One warm up run
+        function();
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            function();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+    }
+
+    // NaN aware, the shaders divide by zero when a probe sits inside an emitter
+    bool SameTexel(const reference::Float4 &a, const reference::Float4 &b) {
+        auto same = [](float x, float y) { return x == y || (std::isnan(x) && std::isnan(y)); };
+        return same(a.x, b.x) && same(a.y, b.y) && same(a.z, b.z) && same(a.w, b.w);
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options = ParseOptions(argc, argv);
+
+    RadianceCascadeSettings settings{
+        .maxLevel = options.maxLevel,
+        .verticalProbeCountAtMaxLevel = options.probes,
+        .radius = .01f,
+        .radiusMultiplier = 1.5f,
+        .raymarchStepSize = 0.01f,
+        .attenuation = 100.f
+    };
+
+    reference::Texture sdf(options.width, options.height, {0.0f, 0.0f, 0.0f, 1000000.0f});
+    DrawScene(sdf);
+
+    cpu::TiledSDF tiledSDF;
+    double tilingMilliseconds = TimeMilliseconds(options.iterations, [&] { tiledSDF.Update(sdf); });
+
+    auto [cascadeWidth, cascadeHeight] = reference::GetCascadeExtent(options.width, options.height, settings);
+    double rayCount = static_cast<double>(cascadeWidth) * cascadeHeight;
+
+    std::print("SDF {}x{}, cascade {}x{}, {} lanes ({}), {} threads\n", options.width, options.height, cascadeWidth,
+               cascadeHeight, lanes::WIDTH, RC_STD_SIMD ? "std::experimental::simd" : "scalar fallback",
+               options.threads);
+    std::print("SDF tiling: {:.3f} ms\n", tilingMilliseconds);
+    std::print("{:>6} {:>14} {:>14} {:>14} {:>10} {:>10} {:>8}\n", "level", "scalar ms", "simd ms", "simd MT ms",
+               "speedup", "MT speedup", "match");
+
+    ThreadPool threadPool(options.threads);
+    reference::Texture expected(cascadeWidth, cascadeHeight);
+    reference::Texture actual(cascadeWidth, cascadeHeight);
+
+    bool allMatch = true;
+    double scalarTotal = 0.0;
+    double simdTotal = 0.0;
+    double threadedTotal = 0.0;
+    for (uint32_t level = 0; level < settings.maxLevel; level++) {
+        double scalar = TimeMilliseconds(options.iterations, [&] {
+            reference::RaymarchSDF(sdf, expected, settings, level);
+        });
+        double simd = TimeMilliseconds(options.iterations, [&] {
+            cpu::RaymarchSDF(tiledSDF, actual, settings, level);
+        });
+        double threaded = TimeMilliseconds(options.iterations, [&] {
+            cpu::RaymarchSDF(tiledSDF, actual, settings, level, &threadPool);
+        });
+
+        bool match = true;
+        for (size_t i = 0; i < expected.Data().size() && match; i++) {
+            match = SameTexel(expected.Data()[i], actual.Data()[i]);
+        }
+        allMatch = allMatch && match;
+
+        scalarTotal += scalar;
+        simdTotal += simd;
+        threadedTotal += threaded;
+
+        std::print("{:>6} {:>14.3f} {:>14.3f} {:>14.3f} {:>9.2f}x {:>9.2f}x {:>8}\n", level, scalar, simd, threaded,
+                   scalar / simd, scalar / threaded, match ? "yes" : "NO");
+    }
+
+    std::print("{:>6} {:>14.3f} {:>14.3f} {:>14.3f} {:>9.2f}x {:>9.2f}x\n", "total", scalarTotal, simdTotal,
+               threadedTotal, scalarTotal / simdTotal, scalarTotal / threadedTotal);
+    std::print("Multithreaded throughput: {:.1f} Mrays/s\n", rayCount * settings.maxLevel / threadedTotal / 1e3);
+
+    return allMatch ? 0 : 1;
+}
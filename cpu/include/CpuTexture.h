@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reference {
+    struct Float4 {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float w = 0.0f;
+
+        Float4 operator+(const Float4 &o) const { return {x + o.x, y + o.y, z + o.z, w + o.w}; }
+        Float4 operator-(const Float4 &o) const { return {x - o.x, y - o.y, z - o.z, w - o.w}; }
+        Float4 operator*(float s) const { return {x * s, y * s, z * s, w * s}; }
+        Float4 operator/(float s) const { return {x / s, y / s, z / s, w / s}; }
+
+        Float4 &operator+=(const Float4 &o) {
+            x += o.x;
+            y += o.y;
+            z += o.z;
+            w += o.w;
+            return *this;
+        }
+    };
+
+    // Same formula as hlsl/slang lerp, a + (b - a) * t
+    inline Float4 Lerp(const Float4 &a, const Float4 &b, float t) {
+        return a + (b - a) * t;
+    }
+
+    // Row major RGBA32F texture, the CPU counterpart of the R32G32B32A32_SFLOAT images
+    class Texture {
+    public:
+        Texture() = default;
+
+        Texture(uint32_t width, uint32_t height, Float4 value = {})
+            : m_width(width), m_height(height), m_texels(static_cast<size_t>(width) * height, value) {
+        }
+
+        uint32_t Width() const { return m_width; }
+        uint32_t Height() const { return m_height; }
+
+        Float4 &At(uint32_t x, uint32_t y) { return m_texels[static_cast<size_t>(y) * m_width + x]; }
+        const Float4 &At(uint32_t x, uint32_t y) const { return m_texels[static_cast<size_t>(y) * m_width + x]; }
+
+        // Storage image load, out of bounds reads return 0 like with robust image access
+        Float4 Load(int x, int y) const {
+            if (x < 0 || y < 0 || x >= static_cast<int>(m_width) || y >= static_cast<int>(m_height)) {
+                return {};
+            }
+            return At(x, y);
+        }
+
+        void Fill(Float4 value) { m_texels.assign(m_texels.size(), value); }
+
+        std::vector<Float4> &Data() { return m_texels; }
+        const std::vector<Float4> &Data() const { return m_texels; }
+
+    private:
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        std::vector<Float4> m_texels;
+    };
+}
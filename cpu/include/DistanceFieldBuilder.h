@@ -0,0 +1,24 @@
+#pragma once
+
+#include <CpuTexture.h>
+#include <ThreadPool.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cpu {
+    // Distance stored for texels when the raster has no solid texel at all, same value the reset SDF pass uses
+    constexpr float EMPTY_DISTANCE = 1000000.0f;
+
+    // Builds an SDF texture from an occupancy and emission raster using the exact separable euclidean distance
+    // transform of Felzenszwalb and Huttenlocher, a column pass followed by a row pass, both split in blocks across
+    // the thread pool when one is given.
+    //
+    // occupancy holds one byte per texel, non zero is solid. emission holds the color of every texel, only the
+    // solid ones are read. The output follows the sdfImage layout: rgb is the emission of the nearest solid texel
+    // and alpha the distance to it in texels, 0 inside. Texels are row major RGBA32F, the same memory layout as
+    // VK_FORMAT_R32G32B32A32_SFLOAT, so the data can be copied into sdfImage as is.
+    reference::Texture BuildDistanceField(uint32_t width, uint32_t height, const std::vector<uint8_t> &occupancy,
+                                          const std::vector<reference::Float4> &emission,
+                                          ThreadPool *threadPool = nullptr);
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Thin portable SIMD layer for the CPU kernels. Uses std::experimental::simd where the standard library ships it
+// (libstdc++) and a plain array implementation otherwise, which compilers auto vectorize reasonably well.
+// Only the handful of operations the kernels need are exposed, as free functions so both backends share them.
+// Define RC_SCALAR_LANES to force the fallback, the benchmark uses it to compare both.
+
+#if __has_include(<experimental/simd>) && !defined(RC_SCALAR_LANES)
+#include <experimental/simd>
+#define RC_STD_SIMD 1
+#else
+#define RC_STD_SIMD 0
+#endif
+
+namespace lanes {
+    // Rays processed together by a lane group
+    constexpr int WIDTH = 8;
+
+#if RC_STD_SIMD
+    namespace stdx = std::experimental;
+
+    using Float = stdx::fixed_size_simd<float, WIDTH>;
+    using Int = stdx::fixed_size_simd<int, WIDTH>;
+    using Mask = Float::mask_type;
+
+    inline Float Load(const float *data) {
+        return Float(data, stdx::element_aligned);
+    }
+
+    inline Int Load(const int *data) {
+        return Int(data, stdx::element_aligned);
+    }
+
+    inline void Store(const Float &value, float *data) {
+        value.copy_to(data, stdx::element_aligned);
+    }
+
+    inline void Store(const Int &value, int *data) {
+        value.copy_to(data, stdx::element_aligned);
+    }
+
+    inline Int FloorToInt(const Float &value) {
+        return stdx::static_simd_cast<Int>(stdx::floor(value));
+    }
+
+    inline Int Clamp(const Int &value, int low, const Int &high) {
+        return stdx::min(stdx::max(value, Int(low)), high);
+    }
+
+    inline Mask LessEqualZero(const Float &value) {
+        return value <= Float(0.0f);
+    }
+
+    inline Mask MaskFromBools(const bool *data) {
+        return Mask(data, stdx::element_aligned);
+    }
+
+    inline bool Any(const Mask &mask) {
+        return stdx::any_of(mask);
+    }
+
+    inline bool Lane(const Mask &mask, int lane) {
+        return mask[lane];
+    }
+#else
+    template<typename T>
+    struct Vector {
+        T v[WIDTH];
+
+        Vector() = default;
+
+        Vector(T scalar) {
+            for (int i = 0; i < WIDTH; i++) v[i] = scalar;
+        }
+
+        T operator[](int lane) const { return v[lane]; }
+
+        friend Vector operator+(const Vector &a, const Vector &b) {
+            Vector r;
+            for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] + b.v[i];
+            return r;
+        }
+
+        friend Vector operator-(const Vector &a, const Vector &b) {
+            Vector r;
+            for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] - b.v[i];
+            return r;
+        }
+
+        friend Vector operator*(const Vector &a, const Vector &b) {
+            Vector r;
+            for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] * b.v[i];
+            return r;
+        }
+    };
+
+    struct Mask {
+        bool v[WIDTH];
+
+        friend Mask operator&&(const Mask &a, const Mask &b) {
+            Mask r;
+            for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] && b.v[i];
+            return r;
+        }
+
+        Mask operator!() const {
+            Mask r;
+            for (int i = 0; i < WIDTH; i++) r.v[i] = !v[i];
+            return r;
+        }
+    };
+
+    using Float = Vector<float>;
+    using Int = Vector<int>;
+
+    inline Float Load(const float *data) {
+        Float r;
+        std::copy_n(data, WIDTH, r.v);
+        return r;
+    }
+
+    inline Int Load(const int *data) {
+        Int r;
+        std::copy_n(data, WIDTH, r.v);
+        return r;
+    }
+
+    inline void Store(const Float &value, float *data) {
+        std::copy_n(value.v, WIDTH, data);
+    }
+
+    inline void Store(const Int &value, int *data) {
+        std::copy_n(value.v, WIDTH, data);
+    }
+
+    inline Int FloorToInt(const Float &value) {
+        Int r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = static_cast<int>(std::floor(value.v[i]));
+        return r;
+    }
+
+    inline Int Clamp(const Int &value, int low, const Int &high) {
+        Int r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = std::min(std::max(value.v[i], low), high.v[i]);
+        return r;
+    }
+
+    inline Mask LessEqualZero(const Float &value) {
+        Mask r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = value.v[i] <= 0.0f;
+        return r;
+    }
+
+    inline Mask MaskFromBools(const bool *data) {
+        Mask r;
+        std::copy_n(data, WIDTH, r.v);
+        return r;
+    }
+
+    inline bool Any(const Mask &mask) {
+        return std::any_of(mask.v, mask.v + WIDTH, [](bool b) { return b; });
+    }
+
+    inline bool Lane(const Mask &mask, int lane) {
+        return mask.v[lane];
+    }
+#endif
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <CpuTexture.h>
+#include <RadianceCascadeSettings.h>
+#include <Scene.h>
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Scalar CPU implementation of the cascade shaders, meant to be used as an oracle for the GPU kernels.
+// Every function mirrors the shader of the same name: same formulas, same evaluation order, same integer
+// semantics (including the ones that look wrong, like the merge weights). It is single threaded so results are
+// deterministic. Differences with the GPU come from transcendental precision (cos, sin, pow), from the sub-texel
+// precision of hardware filtering and from out of bounds storage image reads, which are assumed to return 0 as with
+// robust image access.
+namespace reference {
+    // Matches RadianceCascadeRenderer::CascadeLayout and CASCADE_LAYOUT_* in Common.slangi
+    enum CascadeLayout : uint32_t {
+        PROBE_FIRST,
+        DIRECTION_FIRST,
+        MORTON
+    };
+
+    // Matches RadianceCascadeRenderer::BrushSegment, a capsule in render texels
+    struct BrushSegment {
+        float startX;
+        float startY;
+        float endX;
+        float endY;
+        float radius;
+        float r;
+        float g;
+        float b;
+    };
+
+    // BounceSource of Common.slangi, the textures are read with point sampling like on the GPU
+    struct BounceSource {
+        const Texture *previousGI;
+        const Texture *albedo;
+        float paintedAlbedo;
+    };
+
+    // Point sampling with clamp to edge on normalized coordinates, like the sampler bound to the SDF and GI
+    Float4 SampleNearest(const Texture &texture, float u, float v);
+
+    // Bilinear filtering with clamp to edge on normalized coordinates, like the sampler of the direction first merges
+    Float4 SampleLinear(const Texture &texture, float u, float v);
+
+    // Same formula as RadianceCascadeRenderer::GetCascadeExtent
+    std::pair<uint32_t, uint32_t> GetCascadeExtent(uint32_t width, uint32_t height,
+                                                   const RadianceCascadeSettings &settings);
+
+    void FillTextureFloat4(Texture &output, Float4 value);
+
+    // Only touches the texels of the dispatch RadianceCascadeRenderer sizes over the bounding box of the segments
+    void DrawToSDFTexture(Texture &output, std::span<const BrushSegment> segments);
+
+    // The albedo texture stands for the RGBA8 image, values are quantized the same way. scale is the render height.
+    void EvaluateSceneSDF(Texture &output, Texture &albedo, const Scene &scene, const Scene::Grid &grid, float scale);
+
+    // Without a bounce source the raymarch is single bounce
+    void RaymarchSDF(const Texture &sdf, Texture &cascade, const RadianceCascadeSettings &settings,
+                     uint32_t currentLevel, CascadeLayout layout = PROBE_FIRST, const BounceSource *bounce = nullptr);
+
+    // Merges in place, outputCascade holds the raymarch of the output level
+    void MergeCascades(const Texture &inputCascade, Texture &outputCascade, uint32_t outputLevel,
+                       CascadeLayout layout = PROBE_FIRST, bool filterProbes = false);
+
+    // Level 0 merge fused with BuildGITexture, outputCascade holds the raymarch of level 0
+    void MergeCascadesToGI(const Texture &inputCascade, Texture &outputCascade, Texture &output,
+                           CascadeLayout layout = PROBE_FIRST, bool filterProbes = false);
+
+    void BuildGITexture(const Texture &inputCascade, Texture &output, CascadeLayout layout = PROBE_FIRST);
+
+    void AccumulateBounce(const Texture &inputGI, Texture &bounce, float blend);
+
+    // The bilinear variant, FinalPassEdgeAware is not mirrored
+    void FinalPass(const Texture &sdf, const Texture &inputGI, Texture &output);
+
+    // Owns the textures and runs the passes in the order RadianceCascadeRenderer records them. Temporal amortization
+    // and the level schedule are not mirrored, every level is traced every frame.
+    class ReferencePipeline {
+    public:
+        // Matches RadianceCascadeRenderer::MultiBounceSettings
+        struct MultiBounceSettings {
+            bool enabled = false;
+            float blend = 0.1f;
+            float paintedAlbedo = 0.5f;
+        };
+
+        ReferencePipeline(uint32_t width, uint32_t height, const RadianceCascadeSettings &settings);
+
+        // Equivalent of the reset SDF button, the scene is evaluated again on the next render
+        void ResetSDF();
+
+        void Draw(std::span<const BrushSegment> segments);
+
+        // Evaluated into the SDF on the next render and after every reset, grid is scene.BuildGrid()
+        void SetScene(const Scene &scene, const Scene::Grid &grid);
+
+        void SetCascadeLayout(CascadeLayout layout) { m_cascadeLayout = layout; }
+
+        // Whether the direction first merges filter between probes, RadianceCascadeRenderer does when the device can
+        // filter the cascade format
+        void SetFilterProbes(bool filterProbes) { m_filterProbes = filterProbes; }
+
+        void SetFusedGIMerge(bool fused) { m_fusedGIMerge = fused; }
+
+        // Turning it on starts the average over from black
+        void SetMultiBounce(const MultiBounceSettings &settings);
+
+        // Evaluate the scene if needed, raymarch every level, merge them top down, build the GI texture, accumulate
+        // the bounce and compose the final image
+        void Render();
+
+        const RadianceCascadeSettings &GetSettings() const { return m_settings; }
+
+        Texture &GetSDF() { return m_sdf; }
+        const Texture &GetSDF() const { return m_sdf; }
+        const Texture &GetAlbedo() const { return m_albedo; }
+        const Texture &GetCascade(uint32_t level) const { return m_cascades[level]; }
+        const Texture &GetGlobalIllumination() const { return m_globalIllumination; }
+        const Texture &GetBounce() const { return m_bounce; }
+        const Texture &GetDisplay() const { return m_display; }
+
+    private:
+        RadianceCascadeSettings m_settings;
+        Texture m_sdf;
+        Texture m_albedo;
+        Texture m_display;
+        std::vector<Texture> m_cascades;
+        Texture m_globalIllumination;
+        Texture m_bounce;
+        CascadeLayout m_cascadeLayout = PROBE_FIRST;
+        bool m_filterProbes = false;
+        bool m_fusedGIMerge = true;
+        MultiBounceSettings m_multiBounce;
+        bool m_bounceInvalid = true;
+        Scene m_scene;
+        Scene::Grid m_sceneGrid{};
+        bool m_sceneDirty = false;
+    };
+}
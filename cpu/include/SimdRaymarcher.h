@@ -0,0 +1,18 @@
+#pragma once
+
+#include <CpuTexture.h>
+#include <RadianceCascadeSettings.h>
+#include <ThreadPool.h>
+#include <TiledSDF.h>
+
+#include <cstdint>
+
+namespace cpu {
+    // Vectorized RaymarchSDF, lanes::WIDTH rays of a row are marched together. Every ray of a level shares the
+    // same start offset and step count, so the march position is uniform across lanes and only the sampling is
+    // per lane. Output matches reference::RaymarchSDF exactly.
+    // The cascade is split in 32x32 texel tiles, which are whole groups of probes at the low levels and slices of
+    // a single probe's directions at the high ones, and handed to the thread pool when one is given.
+    void RaymarchSDF(const TiledSDF &sdf, reference::Texture &cascade, const RadianceCascadeSettings &settings,
+                     uint32_t currentLevel, ThreadPool *threadPool = nullptr);
+}
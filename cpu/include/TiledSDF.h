@@ -0,0 +1,43 @@
+#pragma once
+
+#include <CpuTexture.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpu {
+    // SDF copy stored in square tiles so the texels a group of neighbouring rays touches share cache lines.
+    // Distances live in their own plane since they are read at every step, colors only on hits.
+    class TiledSDF {
+    public:
+        static constexpr uint32_t TILE_SHIFT = 3;
+        static constexpr uint32_t TILE_SIZE = 1 << TILE_SHIFT;
+
+        TiledSDF() = default;
+
+        explicit TiledSDF(const reference::Texture &sdf) { Update(sdf); }
+
+        // Retiles the whole texture
+        void Update(const reference::Texture &sdf);
+
+        uint32_t Width() const { return m_width; }
+        uint32_t Height() const { return m_height; }
+
+        float Distance(uint32_t x, uint32_t y) const { return m_distances[Offset(x, y)]; }
+
+        const reference::Float4 &Texel(uint32_t x, uint32_t y) const { return m_texels[Offset(x, y)]; }
+
+    private:
+        size_t Offset(uint32_t x, uint32_t y) const {
+            size_t tile = static_cast<size_t>(y >> TILE_SHIFT) * m_tileCountX + (x >> TILE_SHIFT);
+            return tile * TILE_SIZE * TILE_SIZE + (y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1));
+        }
+
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        uint32_t m_tileCountX = 0;
+        std::vector<float> m_distances;
+        std::vector<reference::Float4> m_texels;
+    };
+}
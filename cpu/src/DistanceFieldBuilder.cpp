@@ -0,0 +1,157 @@
+#include <DistanceFieldBuilder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace cpu {
+    namespace {
+        constexpr int64_t INF = std::numeric_limits<int64_t>::max();
+
+        // Columns processed together in the first pass, so the row major raster is walked along cache lines
+        constexpr uint32_t COLUMN_BLOCK = 64;
+        constexpr uint32_t ROW_BLOCK = 16;
+
+        struct RowScratch {
+            std::vector<int64_t> f;
+            std::vector<int> v;
+            std::vector<double> z;
+        };
+
+        // Lower envelope of the parabolas (q - p)^2 + f[p], skipping infinite samples. Writes the squared distance
+        // and the index of the parabola it comes from, or INF and -1 if every sample is infinite.
+        void DistanceTransform1D(uint32_t n, RowScratch &scratch, int64_t *distance, int *nearest) {
+            const int64_t *f = scratch.f.data();
+            int *v = scratch.v.data();
+            double *z = scratch.z.data();
+
+            int k = -1;
+            for (int q = 0; q < static_cast<int>(n); q++) {
+                if (f[q] == INF) {
+                    continue;
+                }
+
+                double s = 0.0;
+                while (k >= 0) {
+                    int p = v[k];
+                    s = (static_cast<double>(f[q] + static_cast<int64_t>(q) * q) -
+                         static_cast<double>(f[p] + static_cast<int64_t>(p) * p)) / (2.0 * q - 2.0 * p);
+                    if (s > z[k]) {
+                        break;
+                    }
+                    k--;
+                }
+
+                k++;
+                v[k] = q;
+                z[k] = k == 0 ? -std::numeric_limits<double>::infinity() : s;
+                z[k + 1] = std::numeric_limits<double>::infinity();
+            }
+
+            if (k < 0) {
+                for (uint32_t q = 0; q < n; q++) {
+                    distance[q] = INF;
+                    nearest[q] = -1;
+                }
+                return;
+            }
+
+            k = 0;
+            for (int q = 0; q < static_cast<int>(n); q++) {
+                while (z[k + 1] < q) {
+                    k++;
+                }
+                int64_t offset = q - v[k];
+                distance[q] = offset * offset + f[v[k]];
+                nearest[q] = v[k];
+            }
+        }
+
+        void Run(uint32_t count, ThreadPool *threadPool, const std::function<void(uint32_t)> &task) {
+            if (threadPool) {
+                threadPool->ParallelFor(count, task);
+            } else {
+                for (uint32_t i = 0; i < count; i++) {
+                    task(i);
+                }
+            }
+        }
+    }
+
+    reference::Texture BuildDistanceField(uint32_t width, uint32_t height, const std::vector<uint8_t> &occupancy,
+                                          const std::vector<reference::Float4> &emission, ThreadPool *threadPool) {
+        const size_t texelCount = static_cast<size_t>(width) * height;
+
+        // First pass, nearest solid row in each column, two scans per column
+        std::vector<int> nearestRow(texelCount, -1);
+
+        Run((width + COLUMN_BLOCK - 1) / COLUMN_BLOCK, threadPool, [&](uint32_t block) {
+            uint32_t x0 = block * COLUMN_BLOCK;
+            uint32_t x1 = std::min(x0 + COLUMN_BLOCK, width);
+
+            for (uint32_t y = 0; y < height; y++) {
+                size_t row = static_cast<size_t>(y) * width;
+                for (uint32_t x = x0; x < x1; x++) {
+                    if (occupancy[row + x]) {
+                        nearestRow[row + x] = static_cast<int>(y);
+                    } else if (y > 0) {
+                        nearestRow[row + x] = nearestRow[row - width + x];
+                    }
+                }
+            }
+
+            for (int y = static_cast<int>(height) - 2; y >= 0; y--) {
+                size_t row = static_cast<size_t>(y) * width;
+                for (uint32_t x = x0; x < x1; x++) {
+                    int below = nearestRow[row + width + x];
+                    int current = nearestRow[row + x];
+                    if (below >= 0 && (current < 0 || below - y < y - current)) {
+                        nearestRow[row + x] = below;
+                    }
+                }
+            }
+        });
+
+        // Second pass, exact distance transform along each row of the squared column distances
+        reference::Texture output(width, height);
+
+        Run((height + ROW_BLOCK - 1) / ROW_BLOCK, threadPool, [&](uint32_t block) {
+            uint32_t y0 = block * ROW_BLOCK;
+            uint32_t y1 = std::min(y0 + ROW_BLOCK, height);
+
+            RowScratch scratch;
+            scratch.f.resize(width);
+            scratch.v.resize(width);
+            scratch.z.resize(width + 1);
+            std::vector<int64_t> distance(width);
+            std::vector<int> nearestColumn(width);
+
+            for (uint32_t y = y0; y < y1; y++) {
+                size_t row = static_cast<size_t>(y) * width;
+                for (uint32_t x = 0; x < width; x++) {
+                    int solidRow = nearestRow[row + x];
+                    int64_t offset = solidRow - static_cast<int64_t>(y);
+                    scratch.f[x] = solidRow < 0 ? INF : offset * offset;
+                }
+
+                DistanceTransform1D(width, scratch, distance.data(), nearestColumn.data());
+
+                for (uint32_t x = 0; x < width; x++) {
+                    reference::Float4 &texel = output.At(x, y);
+                    if (nearestColumn[x] < 0) {
+                        texel = {0.0f, 0.0f, 0.0f, EMPTY_DISTANCE};
+                        continue;
+                    }
+
+                    int siteX = nearestColumn[x];
+                    int siteY = nearestRow[row + siteX];
+                    const reference::Float4 &color = emission[static_cast<size_t>(siteY) * width + siteX];
+                    texel = {color.x, color.y, color.z, static_cast<float>(std::sqrt(static_cast<double>(distance[x])))};
+                }
+            }
+        });
+
+        return output;
+    }
+}
@@ -0,0 +1,725 @@
+#include <ReferencePipeline.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace reference {
+    namespace {
+        constexpr int MAX_RAY_STEPS = 64;
+
+        struct Int2 {
+            int x;
+            int y;
+        };
+
+        struct Float2 {
+            float x;
+            float y;
+
+            Float2 operator+(const Float2 &o) const { return {x + o.x, y + o.y}; }
+            Float2 operator-(const Float2 &o) const { return {x - o.x, y - o.y}; }
+            Float2 operator*(float s) const { return {x * s, y * s}; }
+        };
+
+        float Dot(Float2 a, Float2 b) {
+            return a.x * b.x + a.y * b.y;
+        }
+
+        float Length(Float2 v) {
+            return std::sqrt(Dot(v, v));
+        }
+
+        float Saturate(float v) {
+            return std::clamp(v, 0.0f, 1.0f);
+        }
+
+        // slang sign, 0 stays 0
+        float Sign(float v) {
+            return static_cast<float>((v > 0.0f) - (v < 0.0f));
+        }
+
+        // Common.slangi Ray
+        struct Ray {
+            int id;
+            float length;
+            float startOffset;
+            float angle;
+            float directionX;
+            float directionY;
+            float originX;
+            float originY;
+        };
+
+        // Common.slangi SpreadBits
+        uint32_t SpreadBits(uint32_t v) {
+            v &= 0x0000ffff;
+            v = (v | (v << 8)) & 0x00ff00ff;
+            v = (v | (v << 4)) & 0x0f0f0f0f;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        }
+
+        // Common.slangi CompactBits
+        uint32_t CompactBits(uint32_t v) {
+            v &= 0x55555555;
+            v = (v | (v >> 1)) & 0x33333333;
+            v = (v | (v >> 2)) & 0x0f0f0f0f;
+            v = (v | (v >> 4)) & 0x00ff00ff;
+            v = (v | (v >> 8)) & 0x0000ffff;
+            return v;
+        }
+
+        // Common.slangi CascadeLayout, the texel addressing of a level
+        struct LevelLayout {
+            CascadeLayout type;
+            int probeSize;
+            Int2 probeCount;
+
+            Int2 GetProbe(int x, int y) const {
+                if (type == DIRECTION_FIRST) {
+                    return {x % probeCount.x, y % probeCount.y};
+                }
+                return {x / probeSize, y / probeSize};
+            }
+
+            // Truncating division and modulo like the shader, so ray -1 is (-1, 0) outside the Morton layout
+            Int2 GetDirection(int rayID) const {
+                if (type == MORTON) {
+                    return {static_cast<int>(CompactBits(rayID)), static_cast<int>(CompactBits(rayID >> 1))};
+                }
+                return {rayID % probeSize, rayID / probeSize};
+            }
+
+            int GetRayID(int x, int y) const {
+                Int2 direction = type == DIRECTION_FIRST
+                                     ? Int2{x / probeCount.x, y / probeCount.y}
+                                     : Int2{x % probeSize, y % probeSize};
+                if (type == MORTON) {
+                    return static_cast<int>(SpreadBits(direction.x) | (SpreadBits(direction.y) << 1));
+                }
+                return direction.x + direction.y * probeSize;
+            }
+
+            Int2 GetTexel(Int2 probe, int rayID) const {
+                Int2 direction = GetDirection(rayID);
+                if (type == DIRECTION_FIRST) {
+                    return {direction.x * probeCount.x + probe.x, direction.y * probeCount.y + probe.y};
+                }
+                return {probe.x * probeSize + direction.x, probe.y * probeSize + direction.y};
+            }
+        };
+
+        LevelLayout GetLevelLayout(CascadeLayout type, int level, const Texture &cascade) {
+            LevelLayout layout{};
+            layout.type = type;
+            layout.probeSize = 1 << (level + 1);
+            layout.probeCount = {static_cast<int>(cascade.Width()) / layout.probeSize,
+                                 static_cast<int>(cascade.Height()) / layout.probeSize};
+            return layout;
+        }
+
+        float AspectRatio(const Texture &texture) {
+            return static_cast<float>(texture.Width()) / static_cast<float>(texture.Height());
+        }
+
+        Ray GetRay(const LevelLayout &layout, int level, uint32_t idX, uint32_t idY, float radius,
+                   float radiusMultiplier) {
+            Ray ray{};
+
+            ray.id = layout.GetRayID(static_cast<int>(idX), static_cast<int>(idY));
+
+            ray.length = radius * std::pow(radiusMultiplier, static_cast<float>(level));
+
+            ray.startOffset = 0;
+            for (int i = 0; i < level; i++) {
+                ray.startOffset += radius * std::pow(radiusMultiplier, static_cast<float>(i));
+            }
+
+            int probeRayCount = layout.probeSize * layout.probeSize;
+            // Jitter stays at the middle of the bin, the temporal mode is not mirrored
+            ray.angle = (ray.id + .5f) * 2 * 3.141592653589793f / probeRayCount;
+
+            ray.directionX = std::cos(ray.angle);
+            ray.directionY = std::sin(ray.angle);
+
+            Int2 probe = layout.GetProbe(static_cast<int>(idX), static_cast<int>(idY));
+            ray.originX = (static_cast<float>(probe.x) + 0.5f) / layout.probeCount.x;
+            ray.originY = (static_cast<float>(probe.y) + 0.5f) / layout.probeCount.y;
+
+            return ray;
+        }
+
+        Ray RayCorrection(Ray ray, const Texture &cascade, const Texture &sdf) {
+            float correction = AspectRatio(cascade) / AspectRatio(sdf);
+
+            ray.originX -= .5f;
+            ray.originX *= correction;
+            ray.originX += .5f;
+
+            ray.directionX *= correction;
+
+            return ray;
+        }
+
+        // BounceSource::Reflected, hit is the first sample inside the surface, outside the last one before it
+        Float4 Reflected(const BounceSource &bounce, float hitX, float hitY, float outsideX, float outsideY,
+                         float sdfAspectRatio) {
+            Float4 texelAlbedo = SampleNearest(*bounce.albedo, hitX, hitY);
+            Float4 reflectance = texelAlbedo.w > 0
+                                     ? texelAlbedo
+                                     : Float4{bounce.paintedAlbedo, bounce.paintedAlbedo, bounce.paintedAlbedo, 0};
+
+            float u = outsideX;
+            u -= .5f;
+            u *= sdfAspectRatio / AspectRatio(*bounce.previousGI);
+            u += .5f;
+
+            Float4 gi = SampleNearest(*bounce.previousGI, u, outsideY);
+
+            return {reflectance.x * gi.x, reflectance.y * gi.y, reflectance.z * gi.z, 0.0f};
+        }
+
+        Float4 Raymarch(const Ray &ray, float stepSize, float attenuation, const Texture &sdf,
+                        const BounceSource *bounce) {
+            Float4 result{0, 0, 0, 1.0f};
+            int i = 0;
+            for (float t = ray.startOffset; t < ray.startOffset + ray.length && i < MAX_RAY_STEPS; t += stepSize) {
+                i++;
+
+                float posX = ray.originX + ray.directionX * t;
+                float posY = ray.originY + ray.directionY * t;
+
+                Float4 color = SampleNearest(sdf, posX, posY);
+
+                if (color.w <= 0) {
+                    Float4 radiance{color.x, color.y, color.z, 0.0f};
+                    if (bounce != nullptr) {
+                        float outsideT = std::max(t - stepSize, 0.0f);
+                        radiance += Reflected(*bounce, posX, posY, ray.originX + ray.directionX * outsideT,
+                                              ray.originY + ray.directionY * outsideT, AspectRatio(sdf));
+                    }
+                    float scale = t * attenuation;
+                    result = {radiance.x / scale, radiance.y / scale, radiance.z / scale, 0.0f};
+                    break;
+                }
+            }
+
+            return result;
+        }
+
+        int WrapRay(int ray, const LevelLayout &input) {
+            int rayCount = input.probeSize * input.probeSize;
+            int rayIndex = ray % rayCount;
+            // The probe first layout keeps reading the texel left of the probe tile for the ray before angle 0
+            if (rayIndex < 0 && input.type != PROBE_FIRST) {
+                rayIndex += rayCount;
+            }
+            return rayIndex;
+        }
+
+        Float4 SampleProbe(const Texture &inputCascade, Int2 probe, const LevelLayout &input, const int rays[4]) {
+            int width = static_cast<int>(inputCascade.Width());
+            int height = static_cast<int>(inputCascade.Height());
+
+            Float4 result{};
+
+            for (int i = 0; i < 4; i++) {
+                Int2 texel = input.GetTexel(probe, WrapRay(rays[i], input));
+
+                bool outside = input.type == PROBE_FIRST
+                                   ? texel.x >= width || texel.y >= height
+                                   : probe.x < 0 || probe.y < 0 || probe.x >= input.probeCount.x ||
+                                     probe.y >= input.probeCount.y;
+                if (outside) continue;
+
+                result += inputCascade.Load(texel.x, texel.y);
+            }
+
+            return result / 4.0f;
+        }
+
+        Float4 SampleProbesFiltered(const Texture &inputCascade, float positionX, float positionY,
+                                    const LevelLayout &input, const int rays[4]) {
+            float width = static_cast<float>(inputCascade.Width());
+            float height = static_cast<float>(inputCascade.Height());
+
+            float probeX = std::clamp(positionX, 0.0f, static_cast<float>(input.probeCount.x - 1));
+            float probeY = std::clamp(positionY, 0.0f, static_cast<float>(input.probeCount.y - 1));
+
+            Float4 result{};
+
+            for (int i = 0; i < 4; i++) {
+                Int2 direction = input.GetDirection(WrapRay(rays[i], input));
+                float texelX = static_cast<float>(direction.x * input.probeCount.x) + probeX + 0.5f;
+                float texelY = static_cast<float>(direction.y * input.probeCount.y) + probeY + 0.5f;
+                result += SampleLinear(inputCascade, texelX / width, texelY / height);
+            }
+
+            return result / 4.0f;
+        }
+
+        // MergeCascades.slangi MergeRay, levelCascade holds the raymarch of the output level
+        Float4 MergeRay(const Texture &inputCascade, const Texture &levelCascade, int x, int y, int outputLevel,
+                        CascadeLayout layout, bool filterProbes) {
+            LevelLayout output = GetLevelLayout(layout, outputLevel, inputCascade);
+            LevelLayout input = GetLevelLayout(layout, outputLevel + 1, inputCascade);
+
+            int probeRayCount = output.probeSize * output.probeSize;
+            Int2 probePosition = output.GetProbe(x, y);
+
+            int rayID = output.GetRayID(x, y);
+
+            int inputProbeRayCount = input.probeSize * input.probeSize;
+
+            float angleNorm = (rayID + .5f) / (float) probeRayCount;
+            int angleIndex = static_cast<int>(std::floor(angleNorm * inputProbeRayCount));
+            int rays[4] = {
+                angleIndex - 1,
+                angleIndex,
+                angleIndex + 1,
+                angleIndex + 2
+            };
+
+            float positionX = ((float) probePosition.x / output.probeCount.x) * (float) input.probeCount.x - 0.25f;
+            float positionY = ((float) probePosition.y / output.probeCount.y) * (float) input.probeCount.y - 0.25f;
+
+            Float4 finalValue;
+            if (layout == DIRECTION_FIRST && filterProbes) {
+                finalValue = SampleProbesFiltered(inputCascade, positionX, positionY, input, rays);
+            } else {
+                int ceilX = static_cast<int>(std::ceil(positionX));
+                int ceilY = static_cast<int>(std::ceil(positionY));
+                int floorX = static_cast<int>(std::floor(positionX));
+                int floorY = static_cast<int>(std::floor(positionY));
+
+                // probe1 = ceil, probe2 = floor, probe3 = (ceil x, floor y), probe4 = (floor x, ceil y)
+                float lerpWeightX = positionX - floorX;
+                float lerpWeightY = positionY - floorY;
+                Float4 probe1Value = SampleProbe(inputCascade, {ceilX, ceilY}, input, rays);
+                Float4 probe2Value = SampleProbe(inputCascade, {floorX, floorY}, input, rays);
+                Float4 probe3Value = SampleProbe(inputCascade, {ceilX, floorY}, input, rays);
+                Float4 probe4Value = SampleProbe(inputCascade, {floorX, ceilY}, input, rays);
+
+                Float4 lerp1 = Lerp(probe1Value, probe2Value, lerpWeightY);
+                Float4 lerp2 = Lerp(probe3Value, probe4Value, lerpWeightY);
+
+                finalValue = Lerp(lerp1, lerp2, lerpWeightX);
+            }
+
+            const Float4 &value = levelCascade.At(x, y);
+            return value + finalValue * value.w;
+        }
+
+        // EvaluateSceneSDF.slang distance functions, in scene units
+        float DistanceToSegment(Float2 p, Float2 a, Float2 b) {
+            Float2 pa = p - a;
+            Float2 ba = b - a;
+            float lengthSquared = Dot(ba, ba);
+            float h = lengthSquared > 0.0f ? Saturate(Dot(pa, ba) / lengthSquared) : 0.0f;
+            return Length(pa - ba * h);
+        }
+
+        float DistanceToBox(Float2 p, Float2 center, Float2 halfExtents) {
+            Float2 d{std::abs(p.x - center.x) - halfExtents.x, std::abs(p.y - center.y) - halfExtents.y};
+            return Length({std::max(d.x, 0.0f), std::max(d.y, 0.0f)}) + std::min(std::max(d.x, d.y), 0.0f);
+        }
+
+        float DistanceToPolygon(Float2 p, const ScenePoint *points, uint32_t count) {
+            Float2 first{points[0].x, points[0].y};
+            float d = Dot(p - first, p - first);
+            float s = 1.0f;
+            for (uint32_t i = 0, j = count - 1; i < count; j = i, i++) {
+                Float2 vi{points[i].x, points[i].y};
+                Float2 vj{points[j].x, points[j].y};
+                Float2 e = vj - vi;
+                Float2 w = p - vi;
+                Float2 b = w - e * Saturate(Dot(w, e) / Dot(e, e));
+                d = std::min(d, Dot(b, b));
+
+                bool c0 = p.y >= vi.y;
+                bool c1 = p.y < vj.y;
+                bool c2 = e.x * w.y > e.y * w.x;
+                if ((c0 && c1 && c2) || (!c0 && !c1 && !c2)) s = -s;
+            }
+            return s * std::sqrt(d);
+        }
+
+        float DistanceToBezier(Float2 p, Float2 A, Float2 B, Float2 C) {
+            Float2 a = B - A;
+            Float2 b = A - B * 2.0f + C;
+            if (Dot(b, b) < 1e-10f) return DistanceToSegment(p, A, C);
+
+            Float2 c = a * 2.0f;
+            Float2 d = A - p;
+            float kk = 1.0f / Dot(b, b);
+            float kx = kk * Dot(a, b);
+            float ky = kk * (2.0f * Dot(a, a) + Dot(d, b)) / 3.0f;
+            float kz = kk * Dot(d, a);
+
+            auto pointAt = [&](float t) { return d + (c + b * t) * t; };
+
+            float res;
+            float q1 = ky - kx * kx;
+            float q3 = q1 * q1 * q1;
+            float q = kx * (2.0f * kx * kx - 3.0f * ky) + kz;
+            float h = q * q + 4.0f * q3;
+            if (h >= 0.0f) {
+                h = std::sqrt(h);
+                float x0 = (h - q) / 2.0f;
+                float x1 = (-h - q) / 2.0f;
+                float u0 = Sign(x0) * std::pow(std::abs(x0), 1.0f / 3.0f);
+                float u1 = Sign(x1) * std::pow(std::abs(x1), 1.0f / 3.0f);
+                float t = Saturate(u0 + u1 - kx);
+                res = Dot(pointAt(t), pointAt(t));
+            } else {
+                float z = std::sqrt(-q1);
+                float v = std::acos(q / (q1 * z * 2.0f)) / 3.0f;
+                float m = std::cos(v);
+                float n = std::sin(v) * 1.732050808f;
+                float t0 = Saturate((m + m) * z - kx);
+                float t1 = Saturate((-n - m) * z - kx);
+                res = std::min(Dot(pointAt(t0), pointAt(t0)), Dot(pointAt(t1), pointAt(t1)));
+            }
+            return std::sqrt(res);
+        }
+
+        float DistanceToPrimitive(Float2 p, const Scene::Primitive &primitive, const std::vector<ScenePoint> &points) {
+            const ScenePoint *o = points.data() + primitive.pointOffset;
+            auto point = [o](uint32_t i) { return Float2{o[i].x, o[i].y}; };
+            switch (primitive.type) {
+                case Scene::CIRCLE:
+                    return Length(p - point(0)) - primitive.radius;
+                case Scene::BOX:
+                    return DistanceToBox(p, point(0), point(1));
+                case Scene::CAPSULE:
+                    return DistanceToSegment(p, point(0), point(1)) - primitive.radius;
+                case Scene::POLYGON:
+                    return DistanceToPolygon(p, o, primitive.pointCount);
+                case Scene::BEZIER:
+                    return DistanceToBezier(p, point(0), point(1), point(2)) - primitive.radius;
+                default:
+                    return 1e6f;
+            }
+        }
+
+        // Storage write to an RGBA8 unorm image
+        float QuantizeUnorm8(float value) {
+            return std::round(Saturate(value) * 255.0f) / 255.0f;
+        }
+    }
+
+    Float4 SampleNearest(const Texture &texture, float u, float v) {
+        int x = static_cast<int>(std::floor(u * texture.Width()));
+        int y = static_cast<int>(std::floor(v * texture.Height()));
+        x = std::clamp(x, 0, static_cast<int>(texture.Width()) - 1);
+        y = std::clamp(y, 0, static_cast<int>(texture.Height()) - 1);
+        return texture.At(x, y);
+    }
+
+    Float4 SampleLinear(const Texture &texture, float u, float v) {
+        float x = u * texture.Width() - 0.5f;
+        float y = v * texture.Height() - 0.5f;
+        int x0 = static_cast<int>(std::floor(x));
+        int y0 = static_cast<int>(std::floor(y));
+        float weightX = x - x0;
+        float weightY = y - y0;
+
+        auto texel = [&texture](int tx, int ty) {
+            tx = std::clamp(tx, 0, static_cast<int>(texture.Width()) - 1);
+            ty = std::clamp(ty, 0, static_cast<int>(texture.Height()) - 1);
+            return texture.At(tx, ty);
+        };
+
+        Float4 top = Lerp(texel(x0, y0), texel(x0 + 1, y0), weightX);
+        Float4 bottom = Lerp(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), weightX);
+        return Lerp(top, bottom, weightY);
+    }
+
+    std::pair<uint32_t, uint32_t> GetCascadeExtent(uint32_t width, uint32_t height,
+                                                   const RadianceCascadeSettings &settings) {
+        uint32_t maxLevelCascadeProbeResolution = 1 << settings.maxLevel;
+        uint32_t aspectRatio = std::ceil((float) width / height);
+        uint32_t horizontalProbeCountAtMaxLevel = aspectRatio * settings.verticalProbeCountAtMaxLevel;
+        uint32_t cascadeWidth = horizontalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+        uint32_t cascadeHeight = settings.verticalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+
+        return {cascadeWidth, cascadeHeight};
+    }
+
+    void FillTextureFloat4(Texture &output, Float4 value) {
+        output.Fill(value);
+    }
+
+    void DrawToSDFTexture(Texture &output, std::span<const BrushSegment> segments) {
+        int width = static_cast<int>(output.Width());
+        int height = static_cast<int>(output.Height());
+
+        // Same bounding box as RadianceCascadeRenderer::WriteBrushParameters, rounded up to whole workgroups
+        float minX = width, minY = height, maxX = 0.0f, maxY = 0.0f;
+        for (const auto &segment: segments) {
+            minX = std::min({minX, segment.startX - segment.radius, segment.endX - segment.radius});
+            minY = std::min({minY, segment.startY - segment.radius, segment.endY - segment.radius});
+            maxX = std::max({maxX, segment.startX + segment.radius, segment.endX + segment.radius});
+            maxY = std::max({maxY, segment.startY + segment.radius, segment.endY + segment.radius});
+        }
+
+        int originX = std::max(0, (int) std::floor(minX));
+        int originY = std::max(0, (int) std::floor(minY));
+        int endX = std::min(width, (int) std::ceil(maxX) + 1);
+        int endY = std::min(height, (int) std::ceil(maxY) + 1);
+        if (segments.empty() || originX >= endX || originY >= endY) {
+            return;
+        }
+        endX = std::min(width, originX + (endX - originX + 7) / 8 * 8);
+        endY = std::min(height, originY + (endY - originY + 7) / 8 * 8);
+
+        for (int y = originY; y < endY; y++) {
+            for (int x = originX; x < endX; x++) {
+                Float4 value = output.At(x, y);
+                for (const auto &segment: segments) {
+                    Float2 pa{static_cast<float>(x) - segment.startX, static_cast<float>(y) - segment.startY};
+                    Float2 ba{segment.endX - segment.startX, segment.endY - segment.startY};
+                    float lengthSquared = Dot(ba, ba);
+                    float h = lengthSquared > 0.0f ? Saturate(Dot(pa, ba) / lengthSquared) : 0.0f;
+                    float dist = std::max(Length(pa - ba * h) - segment.radius, 0.0f);
+
+                    if ((value.w == 0 && dist == 0) || 1.0f / (dist + 0.00000001f) > 1.0f / (value.w + 0.00000001f)) {
+                        value = {segment.r, segment.g, segment.b, dist};
+                    }
+                }
+                output.At(x, y) = value;
+            }
+        }
+    }
+
+    void EvaluateSceneSDF(Texture &output, Texture &albedo, const Scene &scene, const Scene::Grid &grid,
+                          float scale) {
+        const auto &primitives = scene.GetPrimitives();
+        const auto &points = scene.GetPoints();
+
+        Float2 gridOrigin{grid.origin.x, grid.origin.y};
+        Float2 gridSize{grid.columns * grid.cellSize, grid.rows * grid.cellSize};
+
+        for (uint32_t y = 0; y < output.Height(); y++) {
+            for (uint32_t x = 0; x < output.Width(); x++) {
+                Float2 p{static_cast<float>(x) / scale, static_cast<float>(y) / scale};
+                Float2 local = p - gridOrigin;
+
+                // Primitives outside the cell list are at least band away, outside the grid add the distance to it
+                Float2 outside{std::max(std::max(-local.x, local.x - gridSize.x), 0.0f),
+                               std::max(std::max(-local.y, local.y - gridSize.y), 0.0f)};
+                float dist = grid.band + Length(outside);
+                int nearest = -1;
+
+                if (outside.x == 0.0f && outside.y == 0.0f) {
+                    uint32_t cellX = std::min(static_cast<uint32_t>(local.x / grid.cellSize), grid.columns - 1);
+                    uint32_t cellY = std::min(static_cast<uint32_t>(local.y / grid.cellSize), grid.rows - 1);
+                    const Scene::CellRange &range = grid.cellRanges[cellY * grid.columns + cellX];
+                    for (uint32_t i = range.offset; i < range.offset + range.count; i++) {
+                        uint32_t primitiveIndex = grid.cellPrimitives[i];
+                        float d = DistanceToPrimitive(p, primitives[primitiveIndex], points);
+                        if (d < dist) {
+                            dist = d;
+                            nearest = static_cast<int>(primitiveIndex);
+                        }
+                    }
+                }
+
+                dist = std::max(dist * scale, 0.0f);
+
+                Float4 &value = output.At(x, y);
+                if ((value.w == 0 && dist == 0) || 1.0f / (dist + 0.00000001f) > 1.0f / (value.w + 0.00000001f)) {
+                    // With no primitive in reach only the distance bound is kept, it never overestimates
+                    if (nearest >= 0) {
+                        const Scene::Primitive &primitive = primitives[nearest];
+                        value = {primitive.emission[0], primitive.emission[1], primitive.emission[2], dist};
+                        albedo.At(x, y) = {QuantizeUnorm8(primitive.albedo[0]), QuantizeUnorm8(primitive.albedo[1]),
+                                           QuantizeUnorm8(primitive.albedo[2]), QuantizeUnorm8(primitive.albedo[3])};
+                    } else {
+                        value.w = dist;
+                    }
+                }
+            }
+        }
+    }
+
+    void RaymarchSDF(const Texture &sdf, Texture &cascade, const RadianceCascadeSettings &settings,
+                     uint32_t currentLevel, CascadeLayout layout, const BounceSource *bounce) {
+        int level = static_cast<int>(currentLevel);
+        LevelLayout levelLayout = GetLevelLayout(layout, level, cascade);
+
+        for (uint32_t y = 0; y < cascade.Height(); y++) {
+            for (uint32_t x = 0; x < cascade.Width(); x++) {
+                Ray ray = GetRay(levelLayout, level, x, y, settings.radius, settings.radiusMultiplier);
+                ray = RayCorrection(ray, cascade, sdf);
+                cascade.At(x, y) = Raymarch(ray, settings.raymarchStepSize, settings.attenuation, sdf, bounce);
+            }
+        }
+    }
+
+    void MergeCascades(const Texture &inputCascade, Texture &outputCascade, uint32_t outputLevel,
+                       CascadeLayout layout, bool filterProbes) {
+        // Every texel only reads its own raymarch before overwriting it
+        for (uint32_t y = 0; y < outputCascade.Height(); y++) {
+            for (uint32_t x = 0; x < outputCascade.Width(); x++) {
+                outputCascade.At(x, y) = MergeRay(inputCascade, outputCascade, static_cast<int>(x),
+                                                  static_cast<int>(y), static_cast<int>(outputLevel), layout,
+                                                  filterProbes);
+            }
+        }
+    }
+
+    void MergeCascadesToGI(const Texture &inputCascade, Texture &outputCascade, Texture &output,
+                           CascadeLayout layout, bool filterProbes) {
+        LevelLayout level0 = GetLevelLayout(layout, 0, outputCascade);
+
+        for (uint32_t y = 0; y < output.Height(); y++) {
+            for (uint32_t x = 0; x < output.Width(); x++) {
+                Float4 sum{};
+                for (int i = 0; i < 4; i++) {
+                    Int2 ray = level0.GetTexel({static_cast<int>(x), static_cast<int>(y)}, i);
+                    Float4 merged = MergeRay(inputCascade, outputCascade, ray.x, ray.y, 0, layout, filterProbes);
+                    outputCascade.At(ray.x, ray.y) = merged;
+                    sum += merged;
+                }
+                output.At(x, y) = sum / 4.0f;
+            }
+        }
+    }
+
+    void BuildGITexture(const Texture &inputCascade, Texture &output, CascadeLayout layout) {
+        LevelLayout level0 = GetLevelLayout(layout, 0, inputCascade);
+
+        for (uint32_t y = 0; y < output.Height(); y++) {
+            for (uint32_t x = 0; x < output.Width(); x++) {
+                // Summed in ray order like the shader
+                Float4 sum{};
+                for (int i = 0; i < 4; i++) {
+                    Int2 texel = level0.GetTexel({static_cast<int>(x), static_cast<int>(y)}, i);
+                    sum += inputCascade.Load(texel.x, texel.y);
+                }
+                output.At(x, y) = sum / 4.0f;
+            }
+        }
+    }
+
+    void AccumulateBounce(const Texture &inputGI, Texture &bounce, float blend) {
+        for (uint32_t y = 0; y < bounce.Height(); y++) {
+            for (uint32_t x = 0; x < bounce.Width(); x++) {
+                Float4 gi = inputGI.At(x, y);
+                if (!std::isfinite(gi.x) || !std::isfinite(gi.y) || !std::isfinite(gi.z) || !std::isfinite(gi.w)) {
+                    gi = {};
+                }
+                bounce.At(x, y) = Lerp(bounce.At(x, y), gi, blend);
+            }
+        }
+    }
+
+    void FinalPass(const Texture &sdf, const Texture &inputGI, Texture &output) {
+        uint32_t width = output.Width();
+        uint32_t height = output.Height();
+
+        float giAspectRatio = (float) inputGI.Width() / inputGI.Height();
+        float outputAspectRatio = (float) width / height;
+
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                float u = (float) x / width;
+                float v = (float) y / height;
+
+                const Float4 &sdfValue = sdf.At(x, y);
+
+                // normalize UVs
+                u -= .5f;
+                u *= outputAspectRatio / giAspectRatio;
+                u += .5f;
+
+                Float4 giValue = SampleNearest(inputGI, u, v);
+
+                float backgroundColor = 0.1f;
+                float t = std::max(1 - sdfValue.w, 0.0f);
+
+                Float4 &texel = output.At(x, y);
+                texel.x = giValue.x * backgroundColor + (sdfValue.x - giValue.x * backgroundColor) * t;
+                texel.y = giValue.y * backgroundColor + (sdfValue.y - giValue.y * backgroundColor) * t;
+                texel.z = giValue.z * backgroundColor + (sdfValue.z - giValue.z * backgroundColor) * t;
+                texel.w = 1;
+            }
+        }
+    }
+
+    ReferencePipeline::ReferencePipeline(uint32_t width, uint32_t height, const RadianceCascadeSettings &settings)
+        : m_settings(settings), m_sdf(width, height), m_albedo(width, height), m_display(width, height) {
+        auto [cascadeWidth, cascadeHeight] = GetCascadeExtent(width, height, settings);
+
+        for (uint32_t i = 0; i < settings.maxLevel; i++) {
+            m_cascades.emplace_back(cascadeWidth, cascadeHeight);
+        }
+        m_globalIllumination = Texture(cascadeWidth / 2, cascadeHeight / 2);
+        m_bounce = Texture(cascadeWidth / 2, cascadeHeight / 2);
+
+        ResetSDF();
+    }
+
+    void ReferencePipeline::ResetSDF() {
+        FillTextureFloat4(m_sdf, {0.0f, 0.0f, 0.0f, 1000000.0f});
+        m_albedo.Fill({});
+        m_bounceInvalid = true;
+        m_sceneDirty = !m_scene.Empty();
+    }
+
+    void ReferencePipeline::Draw(std::span<const BrushSegment> segments) {
+        DrawToSDFTexture(m_sdf, segments);
+    }
+
+    void ReferencePipeline::SetScene(const Scene &scene, const Scene::Grid &grid) {
+        m_scene = scene;
+        m_sceneGrid = grid;
+        m_sceneDirty = !scene.Empty();
+    }
+
+    void ReferencePipeline::SetMultiBounce(const MultiBounceSettings &settings) {
+        if (settings.enabled && !m_multiBounce.enabled) {
+            m_bounceInvalid = true;
+        }
+        m_multiBounce = settings;
+    }
+
+    void ReferencePipeline::Render() {
+        if (m_sceneDirty) {
+            EvaluateSceneSDF(m_sdf, m_albedo, m_scene, m_sceneGrid, static_cast<float>(m_sdf.Height()));
+            m_sceneDirty = false;
+        }
+
+        if (m_multiBounce.enabled && m_bounceInvalid) {
+            m_bounce.Fill({});
+            m_bounceInvalid = false;
+        }
+
+        BounceSource bounce{&m_bounce, &m_albedo, m_multiBounce.paintedAlbedo};
+        for (uint32_t i = 0; i < m_settings.maxLevel; i++) {
+            RaymarchSDF(m_sdf, m_cascades[i], m_settings, i, m_cascadeLayout,
+                        m_multiBounce.enabled ? &bounce : nullptr);
+        }
+
+        bool fuseGI = m_fusedGIMerge && m_settings.maxLevel > 1;
+        int lastMergeLevel = fuseGI ? 1 : 0;
+
+        for (int i = static_cast<int>(m_settings.maxLevel) - 2; i >= lastMergeLevel; i--) {
+            MergeCascades(m_cascades[i + 1], m_cascades[i], i, m_cascadeLayout, m_filterProbes);
+        }
+
+        if (fuseGI) {
+            MergeCascadesToGI(m_cascades[1], m_cascades[0], m_globalIllumination, m_cascadeLayout, m_filterProbes);
+        } else {
+            BuildGITexture(m_cascades[0], m_globalIllumination, m_cascadeLayout);
+        }
+
+        if (m_multiBounce.enabled) {
+            AccumulateBounce(m_globalIllumination, m_bounce, m_multiBounce.blend);
+        }
+
+        FinalPass(m_sdf, m_globalIllumination, m_display);
+    }
+}
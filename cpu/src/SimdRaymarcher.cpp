@@ -0,0 +1,135 @@
+#include <SimdRaymarcher.h>
+#include <LaneSimd.h>
+
+#include <cmath>
+
+namespace cpu {
+    namespace {
+        constexpr int MAX_RAY_STEPS = 64;
+        constexpr uint32_t TILE_SIZE = 32;
+    }
+
+    void RaymarchSDF(const TiledSDF &sdf, reference::Texture &cascade, const RadianceCascadeSettings &settings,
+                     uint32_t currentLevel, ThreadPool *threadPool) {
+        const uint32_t width = cascade.Width();
+        const uint32_t height = cascade.Height();
+
+        // Same per level values as reference::GetCascadeInfo and GetRay, computed once
+        const int level = static_cast<int>(currentLevel);
+        const int probeSize = 1 << (level + 1);
+        const int probeRayCount = probeSize * probeSize;
+        const int probeCountX = static_cast<int>(static_cast<float>(width) / probeSize);
+        const int probeCountY = static_cast<int>(static_cast<float>(height) / probeSize);
+
+        const float length = settings.radius * std::pow(settings.radiusMultiplier, static_cast<float>(level));
+        float startOffset = 0;
+        for (int i = 0; i < level; i++) {
+            startOffset += settings.radius * std::pow(settings.radiusMultiplier, static_cast<float>(i));
+        }
+
+        const float cascadeAspectRatio = static_cast<float>(width) / static_cast<float>(height);
+        const float sdfAspectRatio = static_cast<float>(sdf.Width()) / static_cast<float>(sdf.Height());
+        const float correction = cascadeAspectRatio / sdfAspectRatio;
+
+        const float stepSize = settings.raymarchStepSize;
+        const float attenuation = settings.attenuation;
+        const lanes::Float sdfWidth(static_cast<float>(sdf.Width()));
+        const lanes::Float sdfHeight(static_cast<float>(sdf.Height()));
+        const lanes::Int maxX(static_cast<int>(sdf.Width()) - 1);
+        const lanes::Int maxY(static_cast<int>(sdf.Height()) - 1);
+
+        const uint32_t tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        const uint32_t tileCountY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+        auto marchTile = [&](uint32_t tile) {
+            uint32_t tileX0 = (tile % tileCountX) * TILE_SIZE;
+            uint32_t tileY0 = (tile / tileCountX) * TILE_SIZE;
+            uint32_t tileX1 = std::min(tileX0 + TILE_SIZE, width);
+            uint32_t tileY1 = std::min(tileY0 + TILE_SIZE, height);
+
+            alignas(32) float originX[lanes::WIDTH];
+            alignas(32) float originY[lanes::WIDTH];
+            alignas(32) float directionX[lanes::WIDTH];
+            alignas(32) float directionY[lanes::WIDTH];
+            alignas(32) float distances[lanes::WIDTH];
+            alignas(32) int texelX[lanes::WIDTH];
+            alignas(32) int texelY[lanes::WIDTH];
+            bool valid[lanes::WIDTH];
+            reference::Float4 results[lanes::WIDTH];
+
+            for (uint32_t y = tileY0; y < tileY1; y++) {
+                for (uint32_t x0 = tileX0; x0 < tileX1; x0 += lanes::WIDTH) {
+                    // Ray setup, in the exact same order of operations as the reference
+                    for (int lane = 0; lane < lanes::WIDTH; lane++) {
+                        valid[lane] = x0 + lane < tileX1;
+                        uint32_t x = valid[lane] ? x0 + lane : x0;
+
+                        int id = static_cast<int>(x % probeSize + (y % probeSize) * probeSize);
+                        float angle = (id + .5f) * 2 * 3.141592653589793f / probeRayCount;
+
+                        directionX[lane] = std::cos(angle) * correction;
+                        directionY[lane] = std::sin(angle);
+
+                        float rayOriginX = (static_cast<float>(x / probeSize) + 0.5f) / probeCountX;
+                        rayOriginX -= .5f;
+                        rayOriginX *= correction;
+                        rayOriginX += .5f;
+                        originX[lane] = rayOriginX;
+                        originY[lane] = (static_cast<float>(y / probeSize) + 0.5f) / probeCountY;
+
+                        results[lane] = {0, 0, 0, 1.0f};
+                    }
+
+                    const lanes::Float rayOriginX = lanes::Load(originX);
+                    const lanes::Float rayOriginY = lanes::Load(originY);
+                    const lanes::Float rayDirectionX = lanes::Load(directionX);
+                    const lanes::Float rayDirectionY = lanes::Load(directionY);
+                    lanes::Mask active = lanes::MaskFromBools(valid);
+
+                    int i = 0;
+                    for (float t = startOffset; t < startOffset + length && i < MAX_RAY_STEPS; t += stepSize) {
+                        i++;
+
+                        lanes::Float positionX = rayOriginX + rayDirectionX * lanes::Float(t);
+                        lanes::Float positionY = rayOriginY + rayDirectionY * lanes::Float(t);
+
+                        // Nearest sampling with clamp to edge
+                        lanes::Store(lanes::Clamp(lanes::FloorToInt(positionX * sdfWidth), 0, maxX), texelX);
+                        lanes::Store(lanes::Clamp(lanes::FloorToInt(positionY * sdfHeight), 0, maxY), texelY);
+
+                        for (int lane = 0; lane < lanes::WIDTH; lane++) {
+                            distances[lane] = sdf.Distance(texelX[lane], texelY[lane]);
+                        }
+
+                        lanes::Mask hit = lanes::LessEqualZero(lanes::Load(distances)) && active;
+                        if (lanes::Any(hit)) {
+                            for (int lane = 0; lane < lanes::WIDTH; lane++) {
+                                if (lanes::Lane(hit, lane)) {
+                                    const reference::Float4 &color = sdf.Texel(texelX[lane], texelY[lane]);
+                                    float scale = t * attenuation;
+                                    results[lane] = {color.x / scale, color.y / scale, color.z / scale, 0.0f};
+                                }
+                            }
+                            active = active && !hit;
+                            if (!lanes::Any(active)) {
+                                break;
+                            }
+                        }
+                    }
+
+                    for (int lane = 0; lane < lanes::WIDTH && valid[lane]; lane++) {
+                        cascade.At(x0 + lane, y) = results[lane];
+                    }
+                }
+            }
+        };
+
+        if (threadPool) {
+            threadPool->ParallelFor(tileCountX * tileCountY, marchTile);
+        } else {
+            for (uint32_t tile = 0; tile < tileCountX * tileCountY; tile++) {
+                marchTile(tile);
+            }
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#include <TiledSDF.h>
+
+namespace cpu {
+    void TiledSDF::Update(const reference::Texture &sdf) {
+        m_width = sdf.Width();
+        m_height = sdf.Height();
+        m_tileCountX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+        uint32_t tileCountY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+
+        size_t size = static_cast<size_t>(m_tileCountX) * tileCountY * TILE_SIZE * TILE_SIZE;
+        m_distances.assign(size, 0.0f);
+        m_texels.assign(size, {});
+
+        for (uint32_t y = 0; y < m_height; y++) {
+            for (uint32_t x = 0; x < m_width; x++) {
+                const reference::Float4 &texel = sdf.At(x, y);
+                m_distances[Offset(x, y)] = texel.w;
+                m_texels[Offset(x, y)] = texel;
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Common.h>
+#include <ThreadPool.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hands out command buffers from one command pool per thread and per frame in flight, so threads record without
+// locking and a whole frame is recycled with a single vkResetCommandPool per pool. Independent groups of passes are
+// recorded into secondary command buffers on the thread pool, then executed in order from the primary buffer.
+class CommandRecorder {
+public:
+    // The thread pool can be shared between recorders, the threads calling into the recorder count as one more
+    void Init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight, ThreadPool &threadPool);
+
+    // The device must be idle
+    void Destroy();
+
+    // Resets every pool of the slot, the fence of the frame that last used it must have been waited on
+    void BeginFrame(uint32_t frameIndex);
+
+    // From the calling thread's pool, valid until the slot comes around again. Not begun.
+    VkCommandBuffer AllocatePrimary();
+
+    // Records record(i, cmd) for every i in [0, count) on the thread pool, each into its own secondary buffer, and
+    // returns them in index order once all are recorded. inheritance may chain a VkCommandBufferInheritanceRenderingInfo
+    // for buffers executed inside dynamic rendering.
+    std::vector<VkCommandBuffer> RecordSecondary(uint32_t count,
+                                                 const std::function<void(uint32_t, VkCommandBuffer)> &record,
+                                                 const VkCommandBufferInheritanceInfo *inheritance = nullptr);
+
+    // Same for a single buffer, recorded in the background while the caller records something else. *commandBuffer
+    // is set once WaitSecondary returns, inheritance must stay alive until then.
+    void RecordSecondaryAsync(const std::function<void(VkCommandBuffer)> &record, VkCommandBuffer *commandBuffer,
+                              const VkCommandBufferInheritanceInfo *inheritance = nullptr);
+
+    void WaitSecondary();
+
+private:
+    struct ThreadCommands {
+        VkCommandPool pool{};
+        // Kept across resets, the used counts restart at zero every frame
+        std::vector<VkCommandBuffer> primaries;
+        std::vector<VkCommandBuffer> secondaries;
+        uint32_t usedPrimaries = 0;
+        uint32_t usedSecondaries = 0;
+    };
+
+    ThreadCommands &GetThreadCommands();
+
+    VkCommandBuffer Allocate(ThreadCommands &commands, VkCommandBufferLevel level);
+
+    VkCommandBuffer BeginSecondary(const VkCommandBufferInheritanceInfo *inheritance);
+
+    VkDevice m_device{};
+    uint32_t m_queueFamilyIndex = 0;
+    ThreadPool *m_threadPool = nullptr;
+    uint32_t m_currentFrameIndex = 0;
+    // [frame index][thread index]
+    std::vector<std::vector<ThreadCommands> > m_commands;
+
+    // Threads get an index the first time they record
+    std::mutex m_threadMutex;
+    std::unordered_map<std::thread::id, uint32_t> m_threadIndices;
+
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncCondition;
+    uint32_t m_pendingAsync = 0;
+};
@@ -31,10 +31,30 @@ struct Image {
     }
 };
 
-Image CreateImage(VkDevice device, VkImageCreateInfo imgCreateInfo, VmaAllocator allocator);
+// Allocates from pool when one is given, otherwise from the default VMA pools
+Image CreateImage(VkDevice device, VkImageCreateInfo imgCreateInfo, VmaAllocator allocator,
+                  VmaPool pool = VK_NULL_HANDLE);
+
+VkImageView CreateImageView(VkDevice device, VkImage image, const VkImageCreateInfo &imgCreateInfo);
 
 void DestroyImage(VkDevice device, VmaAllocator allocator, Image img);
 
+struct Buffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation memory{};
+    // Persistently mapped pointer when created with VMA_ALLOCATION_CREATE_MAPPED_BIT, null otherwise
+    void *mapped = nullptr;
+
+    bool Initialized() const {
+        return buffer != VK_NULL_HANDLE;
+    }
+};
+
+Buffer CreateBuffer(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+                    VmaAllocationCreateFlags flags = 0);
+
+void DestroyBuffer(VmaAllocator allocator, Buffer buffer);
+
 VkShaderModule CreateShaderModule(VkDevice device, const uint32_t* code, size_t size);
 
 void CmdWaitForPipelineStage(VkCommandBuffer cmd, VkPipelineStageFlags2 stage);
\ No newline at end of file
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <Common.h>
+#include <CommandRecorder.h>
+#include <LatencyTracker.h>
 #include <imgui_impl_glfw.h>
 
 #define REGISTER_COMPUTE_APP(ComputeAppImpl) \
@@ -14,12 +16,16 @@ class ComputeApp {
 public:
     virtual ~ComputeApp() = default;
 
-    void Setup(VkDevice dev, VkInstance inst, VmaAllocator all, GLFWwindow *win);
+    void Setup(VkDevice dev, VkInstance inst, VkPhysicalDevice physDev, uint32_t computeQueueFamily, VmaAllocator all,
+               GLFWwindow *win, CommandRecorder *computeRecorder, LatencyTracker *tracker);
 
     virtual void Init() = 0;
 
     virtual void Update(uint32_t frame) = 0;
 
+    // Called after the swapchain has been recreated, the device is idle
+    virtual void Resize(uint32_t width, uint32_t height) {}
+
     virtual void ComputeQueueInitCommands(VkCommandBuffer cmd) {}
 
     virtual void GraphicsQueueInitCommands(VkCommandBuffer cmd) {}
@@ -32,6 +38,17 @@ public:
 
     // Todo : do commands inside render pass
 
+    // Called right before the frame's command buffers are submitted, the last chance to update the host visible data
+    // they read
+    virtual void PreSubmit() {}
+
+    // Present mode the main loop should use, the swapchain is recreated when it changes. Unsupported modes fall back,
+    // to FIFO in the end.
+    VkPresentModeKHR GetRequestedPresentMode() const { return requestedPresentMode; }
+
+    // Called by the main loop with the mode the swapchain actually uses
+    void SetActivePresentMode(VkPresentModeKHR presentMode) { activePresentMode = presentMode; }
+
     virtual void Cleanup() = 0;
 
     static ComputeApp *GetInstance();
@@ -41,8 +58,16 @@ public:
 protected:
     VkDevice device{};
     VkInstance instance{};
+    VkPhysicalDevice physicalDevice{};
+    uint32_t computeQueueFamilyIndex{};
     VmaAllocator allocator{};
     GLFWwindow *window{};
+    // Records secondary compute command buffers in parallel, reset with the frame
+    CommandRecorder *computeCommandRecorder{};
+    // Input events are marked on it, the main loop marks the rest of the frame
+    LatencyTracker *latencyTracker{};
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkPresentModeKHR activePresentMode = VK_PRESENT_MODE_FIFO_KHR;
 
 private:
     static ComputeApp *s_instance;
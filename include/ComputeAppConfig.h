@@ -4,6 +4,7 @@
 
 #pragma once
 
+// Initial window size, the window can be resized at runtime
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 #define MAX_FRAMES_IN_FLIGHT 2
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// Destroys resources once the frames that may still use them are complete, instead of waiting for the device.
+// Entries run in push order, release frames are expected to never decrease.
+class DeletionQueue {
+public:
+    // deleter runs on the first Flush with frame >= releaseFrame
+    void Push(uint32_t releaseFrame, std::function<void()> deleter) {
+        m_entries.push_back({releaseFrame, std::move(deleter)});
+    }
+
+    void Flush(uint32_t frame) {
+        while (!m_entries.empty() && m_entries.front().releaseFrame <= frame) {
+            m_entries.front().deleter();
+            m_entries.pop_front();
+        }
+    }
+
+    // The device must be idle
+    void FlushAll() {
+        while (!m_entries.empty()) {
+            m_entries.front().deleter();
+            m_entries.pop_front();
+        }
+    }
+
+    bool Empty() const { return m_entries.empty(); }
+
+private:
+    struct Entry {
+        uint32_t releaseFrame;
+        std::function<void()> deleter;
+    };
+
+    std::deque<Entry> m_entries;
+};
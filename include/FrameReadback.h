@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Common.h>
+#include <ThreadPool.h>
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// Copies images into a ring of host visible buffers and writes them to disk without ever waiting for the device. A
+// copy is recorded into the frame's command buffer, picked up once that frame is known to be complete and encoded on
+// a background thread pool, after which its buffer goes back to the ring.
+class FrameReadback {
+public:
+    enum Encoding {
+        PNG,
+        EXR,
+        RAW
+    };
+
+    // framesInFlight follows the renderer convention: the frame recorded framesInFlight BeginFrame calls ago is
+    // complete. slotCount is the number of captures that can be pending at once.
+    void Init(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight, uint32_t slotCount = 4,
+              uint32_t encoderThreads = 2);
+
+    // The device must be idle, pending captures are still written
+    void Destroy();
+
+    // Called once before recording each frame, hands the completed copies to the encoders
+    void BeginFrame();
+
+    // image is RGBA32F or RGBA16F in general layout, written by compute shaders earlier in cmd. Returns false and
+    // counts a drop when every slot is still busy.
+    bool RecordCopy(VkCommandBuffer cmd, const Image &image, VkExtent2D extent, VkFormat format,
+                    const std::filesystem::path &path, Encoding encoding);
+
+    static const char *GetExtension(Encoding encoding);
+
+    // Copies recorded but not written yet
+    uint32_t GetPendingCount() const;
+
+    uint64_t GetWrittenCount() const { return m_written; }
+
+    uint64_t GetDroppedCount() const { return m_dropped; }
+
+    uint64_t GetFailedCount() const { return m_failed; }
+
+private:
+    enum SlotState : uint32_t {
+        FREE,
+        COPYING,
+        ENCODING
+    };
+
+    struct Slot {
+        Buffer buffer{};
+        VkDeviceSize capacity = 0;
+        // Only the encoder thread moves a slot from ENCODING back to FREE
+        std::atomic<uint32_t> state = FREE;
+        uint32_t readyFrame = 0;
+        VkExtent2D extent{};
+        VkFormat format{};
+        std::filesystem::path path;
+        Encoding encoding{};
+    };
+
+    void Encode(Slot &slot);
+
+    VkDevice m_device{};
+    VmaAllocator m_allocator{};
+    uint32_t m_framesInFlight = 1;
+    uint32_t m_frameNumber = 0;
+    std::vector<Slot> m_slots;
+    std::unique_ptr<ThreadPool> m_encoders;
+    std::atomic<uint64_t> m_written = 0;
+    std::atomic<uint64_t> m_failed = 0;
+    uint64_t m_dropped = 0;
+};
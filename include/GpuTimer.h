@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Common.h>
+
+#include <string>
+#include <vector>
+
+// Per pass GPU timings using timestamp queries, one query range per frame in flight.
+// Results of a frame slot are read back when the slot is reused, its fence has been waited on by then.
+class GpuTimer {
+public:
+    struct PassTiming {
+        std::string name;
+        double milliseconds;
+    };
+
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+              uint32_t maxPasses);
+
+    void Destroy();
+
+    // Collects the results of the previous use of the slot and resets its queries
+    void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Collects the results of a slot whose submission is known to be complete, without waiting for the slot to be
+    // reused. BeginFrame does it implicitly.
+    void Resolve(uint32_t frameIndex);
+
+    void BeginPass(VkCommandBuffer cmd, const std::string &name);
+
+    void EndPass(VkCommandBuffer cmd);
+
+    bool Supported() const { return m_supported; }
+
+    // Timings of the last completed frame
+    const std::vector<PassTiming> &GetPassTimings() const { return m_passTimings; }
+
+    // First pass start to last pass end of the last completed frame
+    double GetFrameMilliseconds() const { return m_frameMilliseconds; }
+
+private:
+    VkDevice m_device{};
+    VkQueryPool m_queryPool{};
+    bool m_supported = false;
+    double m_timestampPeriod = 0.0;
+    uint64_t m_timestampMask = 0;
+    uint32_t m_maxPasses = 0;
+
+    uint32_t m_currentFrameIndex = 0;
+    std::vector<std::vector<std::string> > m_passNames;
+    std::vector<PassTiming> m_passTimings;
+    double m_frameMilliseconds = 0.0;
+};
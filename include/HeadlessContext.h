@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Common.h>
+
+#include <VkBootstrap.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Vulkan device without window or swapchain, for the tests and benchmarks. Commands are submitted one batch at a time
+// on the compute queue and waited on, there is no frame pipelining.
+class HeadlessContext {
+public:
+    // preferCPU picks a software implementation such as lavapipe when one is installed. Prints the reason and
+    // returns false when no suitable device exists.
+    bool Init(bool preferCPU);
+
+    void Destroy();
+
+    // Records the commands, submits them and blocks until they are complete
+    void Submit(const std::function<void(VkCommandBuffer)> &record);
+
+    // Copies an RGBA32F image in general layout back to host memory, row major, 4 floats per texel
+    std::vector<float> ReadImage(const Image &image, VkExtent2D extent);
+
+    // Uploads row major RGBA32F texels into an image in general layout, after any previously submitted work
+    void WriteImage(const Image &image, VkExtent2D extent, const float *texels);
+
+    VkDevice GetDevice() const { return m_device.device; }
+
+    VkPhysicalDevice GetPhysicalDevice() const { return m_device.physical_device.physical_device; }
+
+    uint32_t GetQueueFamilyIndex() const { return m_queueFamilyIndex; }
+
+    VmaAllocator GetAllocator() const { return m_allocator; }
+
+    const std::string &GetDeviceName() const { return m_device.physical_device.name; }
+
+private:
+    vkb::Instance m_instance{};
+    vkb::Device m_device{};
+    VkQueue m_queue{};
+    uint32_t m_queueFamilyIndex = 0;
+    VmaAllocator m_allocator{};
+    VkCommandPool m_commandPool{};
+    VkCommandBuffer m_commandBuffer{};
+    VkFence m_fence{};
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// Writers for readbacks of the renderer images. Every input is row major RGBA32F, top row first, in linear light.
+
+// 8 bit sRGB encoded RGB, like the window shows it. Values are clamped to [0, 1] and the alpha is dropped.
+bool WritePng(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels);
+
+// Uncompressed scanline OpenEXR with four 32 bit float channels, lossless
+bool WriteExr(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels);
+
+// The texels as they are, without any header
+bool WriteRaw(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels);
+
+// IEEE 754 half to float, for readbacks of RGBA16F images
+float HalfToFloat(uint16_t half);
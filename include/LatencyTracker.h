@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Common.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Follows each frame from the input it draws to the moment it is on screen. The main loop marks recording and submit,
+// a thread waits on a timeline semaphore the frame's last submit signals for the GPU completion, and when
+// VK_KHR_present_wait is available the presents are polled for the time the image was actually displayed.
+class LatencyTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Stage : uint32_t {
+        // Earliest input event the frame draws
+        INPUT,
+        RECORD,
+        // The last submit of the frame returned
+        SUBMIT,
+        GPU_COMPLETE,
+        // Reported by vkWaitForPresentKHR, only with present wait
+        PRESENT,
+        STAGE_COUNT
+    };
+
+    // Milliseconds from the input to each stage, over the recent frames that drew input
+    struct Statistics {
+        std::array<double, STAGE_COUNT> median{};
+        std::array<double, STAGE_COUNT> p95{};
+        uint32_t frameCount = 0;
+    };
+
+    // presentWaitSupported when VK_KHR_present_id and VK_KHR_present_wait are enabled with their features. The
+    // timeline semaphore feature must be enabled.
+    void Init(VkDevice device, bool presentWaitSupported, uint32_t historySize = 240);
+
+    // The device must be idle
+    void Destroy();
+
+    // Signaled with frameId + 1 by the last submit of the frame
+    VkSemaphore GetCompletionSemaphore() const { return m_completionSemaphore; }
+
+    bool PresentWaitSupported() const { return m_presentWaitSupported; }
+
+    // Called once per frame before recording, after the frame is known to be submitted. Collects the frames whose
+    // every stage is known.
+    void BeginFrame(uint64_t frameId);
+
+    // Keeps the earliest time of the frame
+    void MarkInput(Clock::time_point time);
+
+    // Now, for RECORD and SUBMIT
+    void Mark(Stage stage);
+
+    // Called after vkQueuePresentKHR, the present id chained to the present must be frameId + 1
+    void TrackPresent(uint64_t frameId);
+
+    // Checks the tracked presents without waiting, on the thread presenting since the swapchain is externally
+    // synchronized
+    void PollPresents(VkSwapchainKHR swapchain);
+
+    // The swapchain is about to be recreated, the presents still tracked will never be reported
+    void ForgetPresents();
+
+    const Statistics &GetStatistics() const { return m_statistics; }
+
+private:
+    struct FrameRecord {
+        uint64_t id = 0;
+        // Zero while unknown
+        std::array<Clock::time_point, STAGE_COUNT> times{};
+        bool presentTracked = false;
+        bool presentLost = false;
+    };
+
+    FrameRecord *FindRecord(uint64_t frameId);
+
+    void WaiterLoop();
+
+    void UpdateStatistics();
+
+    VkDevice m_device{};
+    bool m_presentWaitSupported = false;
+    PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+    VkSemaphore m_completionSemaphore{};
+    uint32_t m_historySize = 0;
+    uint64_t m_currentFrameId = 0;
+
+    // Shared with the waiter thread
+    std::mutex m_mutex;
+    std::deque<FrameRecord> m_records;
+
+    std::thread m_waiter;
+    std::atomic<bool> m_waiterExit = false;
+
+    // Per stage, latencies of the last historySize frames with input
+    std::array<std::deque<double>, STAGE_COUNT> m_history;
+    Statistics m_statistics{};
+};
@@ -19,10 +19,12 @@ public:
         COMPUTE
     };
 
-    void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint);
+    // copy selects which of the descriptor set copies is bound or written, see
+    // PipelineBuilder::SetDescriptorSetCopies
+    void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, uint32_t copy = 0);
 
     void WriteToDescriptorSet(uint32_t set, uint32_t binding, VkDescriptorType type, VkDescriptorImageInfo *imageInfo,
-                              VkDescriptorBufferInfo *bufferInfo);
+                              VkDescriptorBufferInfo *bufferInfo, uint32_t copy = 0);
 
     template<typename T>
     void SetPushConstant(VkCommandBuffer cmd, VkShaderStageFlags stage, T* data) {
@@ -35,7 +37,7 @@ public:
 
 
     Pipeline(PipelineType type, VkDevice device, VkPipeline pipeline, VkPipelineLayout layout,
-             std::unordered_map<uint32_t, VkDescriptorSet> descriptorSets,
+             std::vector<std::unordered_map<uint32_t, VkDescriptorSet> > descriptorSets,
              std::unordered_map<uint32_t, VkDescriptorSetLayout> descriptorSetLayouts, VkDescriptorPool descriptorPool);
 private:
     bool m_valid = false;
@@ -44,7 +46,7 @@ private:
     VkPipeline m_pipeline{};
     VkPipelineLayout m_layout{};
     std::unordered_map<uint32_t, VkDescriptorSetLayout> m_descriptorSetLayouts{};
-    std::unordered_map<uint32_t, VkDescriptorSet> m_descriptorSets{};
+    std::vector<std::unordered_map<uint32_t, VkDescriptorSet> > m_descriptorSets{};
     VkDescriptorPool m_descriptorPool{};
 };
 
@@ -72,6 +74,10 @@ public:
 
     void SetPushConstantSize(VkShaderStageFlags stage, size_t size);
 
+    // Allocates several copies of every descriptor set, so one copy can be rewritten while command buffers using
+    // another are still pending
+    void SetDescriptorSetCopies(uint32_t copies);
+
     Pipeline Build();
 
     void Reset();
@@ -83,4 +89,5 @@ private:
     std::unordered_map<VkShaderStageFlagBits, VkPipelineShaderStageCreateInfo> m_stages;
     std::vector<VkShaderModule> m_shaderModules;
     std::unordered_map<VkShaderStageFlags, VkPushConstantRange> m_ranges;
+    uint32_t m_descriptorSetCopies = 1;
 };
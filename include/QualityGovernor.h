@@ -0,0 +1,114 @@
+#pragma once
+
+#include <GpuTimer.h>
+#include <RadianceCascadeSettings.h>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Adjusts the cascade quality to hold a GPU frame time budget.
+// Quality is a discrete level, level 0 being the base settings. Each level lowers one knob further, picked from the
+// passes that took most of the GPU time over the window: raymarch step size when tracing dominates, probe count then
+// cascade count when the merges do, render scale when the screen sized passes do. A knob without room left falls
+// through to the next one in the cycle, and without pass timings the knobs are cycled so no single knob collapses
+// first. Going up a level restores the knob lowered last.
+// A dead band around the target plus a settle period after each change keep it from reacting to its own
+// transitions, and upgrades that immediately had to be reverted are retried with an exponential backoff.
+class QualityGovernor {
+public:
+    struct Config {
+        float targetFrameMilliseconds = 8.0f;
+        // Fraction of the target on each side where no change happens
+        float hysteresis = 0.15f;
+        // Frames ignored after a change, the new settings need to reach the timings first
+        uint32_t settleFrames = 8;
+        // Frames the timing median is computed over
+        uint32_t windowFrames = 30;
+        // Frames to wait before retrying an upgrade that was reverted, doubled on each failure
+        uint32_t upgradeBackoffFrames = 120;
+        uint32_t maxUpgradeBackoffFrames = 3600;
+
+        float minRenderScale = 0.5f;
+        float maxRaymarchStepSize = 0.05f;
+        uint32_t minMaxLevel = 4;
+        uint32_t minVerticalProbeCount = 1;
+    };
+
+    struct Quality {
+        RadianceCascadeSettings settings;
+        float renderScale;
+    };
+
+    // Resets to full quality
+    void SetBase(const RadianceCascadeSettings &settings);
+
+    // Feeds the GPU time of a completed frame and its per pass timings from GpuTimer, returns true when the quality
+    // changed and must be applied. Passes RadianceCascadeRenderer does not record are ignored.
+    bool Update(double gpuFrameMilliseconds, std::span<const GpuTimer::PassTiming> passTimings = {});
+
+    const Quality &GetQuality() const { return m_quality; }
+
+    uint32_t GetQualityLevel() const { return m_level; }
+
+    // Median of the current window, 0 until enough frames were collected
+    double GetMedianFrameMilliseconds() const { return m_median; }
+
+    Config config;
+
+private:
+    // In the order they are cycled through
+    enum Knob : uint32_t {
+        RAYMARCH_STEP_SIZE,
+        RENDER_SCALE,
+        PROBE_COUNT,
+        MAX_LEVEL,
+        KNOB_COUNT
+    };
+
+    enum PassCategory : uint32_t {
+        // Raymarch or raycast of the cascade levels
+        TRACE,
+        // Merges, GI texture and bounce, they scale with the cascade texels
+        MERGE,
+        // Brush, scene, rescale and final pass, they scale with the render resolution
+        SCREEN,
+        PASS_CATEGORY_COUNT
+    };
+
+    using KnobSteps = std::array<uint32_t, KNOB_COUNT>;
+
+    // PASS_CATEGORY_COUNT for passes the quality knobs do not affect
+    static PassCategory GetPassCategory(const std::string &passName);
+
+    Quality ComputeQuality(const KnobSteps &steps) const;
+
+    // Knob to lower next, the preferred one or the first after it in the cycle that still has room
+    Knob PickKnob(Knob preferred) const;
+
+    void SetSteps(const KnobSteps &steps);
+
+    RadianceCascadeSettings m_base{};
+    Quality m_quality{};
+    // How many times each knob is lowered, m_level is their sum
+    KnobSteps m_steps{};
+    KnobSteps m_maxSteps{};
+    // Knobs in the order they were lowered, upgrades pop the last one
+    std::vector<Knob> m_lowered;
+    uint32_t m_level = 0;
+    uint32_t m_lowestLevel = 0;
+
+    std::vector<double> m_samples;
+    // Milliseconds per pass category of the frames in m_samples
+    std::vector<std::array<double, PASS_CATEGORY_COUNT> > m_passSamples;
+    double m_median = 0.0;
+    uint64_t m_frame = 0;
+    uint64_t m_lastChangeFrame = 0;
+    bool m_lastChangeWasUpgrade = false;
+
+    // Indexed by level, when an upgrade into that level is allowed again and the current backoff
+    std::vector<uint64_t> m_upgradeAllowedFrame;
+    std::vector<uint32_t> m_upgradeBackoff;
+};
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <Common.h>
+#include <CommandRecorder.h>
+#include <DeletionQueue.h>
+#include <GpuTimer.h>
+#include <PipelineBuilder.h>
+#include <RadianceCascadeSettings.h>
+#include <Scene.h>
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+#define MAX_LEVEL 10
+// Brush segments one frame can draw
+#define MAX_BRUSH_SEGMENTS 1024
+
+// GPU side of the radiance cascade pipeline. Owns the SDF, albedo, cascade, GI and display images and the compute
+// pipelines working on them, and records a frame into a command buffer. It knows nothing about windows or swapchains,
+// so the interactive app, the golden image tests and the benchmarks all run the exact same kernels.
+class RadianceCascadeRenderer {
+public:
+    // How the cascade rays find the nearest surface
+    enum TraceMode : uint32_t {
+        // Sphere steps through the SDF, sees everything painted or evaluated into it
+        RAYMARCH_SDF,
+        // Exact intersection with the outline segments of the scene, ignores the SDF and so the brush strokes
+        RAYCAST_SEGMENTS
+    };
+
+    // How FinalPass brings the GI up to the render resolution
+    enum GIUpsampling : uint32_t {
+        BILINEAR,
+        // Drops the GI texels whose probe is hidden behind a surface, so fewer probes are needed to keep edges clean
+        SDF_GUIDED
+    };
+
+    // Order of the texels in the cascade images, matches CASCADE_LAYOUT_* in Common.slangi. Each level holds
+    // (2^(level + 1))^2 rays per probe either way, only the addressing changes.
+    enum CascadeLayout : uint32_t {
+        // Each probe is a square tile of its rays
+        PROBE_FIRST,
+        // Each ray is a tile holding it for every probe, the merges let the hardware filter between probes
+        DIRECTION_FIRST,
+        // Probe first with the rays of a tile in Z-order, so the 4 consecutive angles a merge reads share a 2x2 quad
+        MORTON
+    };
+
+    // Capsule drawn into the SDF, matches BrushSegment in DrawToSDFTexture.slang. Coordinates and radius are in
+    // render texels.
+    struct BrushSegment {
+        float startX;
+        float startY;
+        float endX;
+        float endY;
+        float radius;
+        float r;
+        float g;
+        float b;
+    };
+
+    // Matches BrushParameters in DrawToSDFTexture.slang, starts with the indirect dispatch of the brush
+    struct BrushParameters {
+        VkDispatchIndirectCommand groupCount;
+        int32_t originX;
+        int32_t originY;
+        uint32_t segmentOffset;
+        uint32_t segmentCount;
+        uint32_t padding;
+    };
+
+    struct DrawToSDFTexturePushConstant {
+        uint32_t parameterIndex;
+    };
+
+    struct EvaluateSceneSDFPushConstant {
+        float gridOriginX;
+        float gridOriginY;
+        float cellSize;
+        float band;
+        uint32_t columns;
+        uint32_t rows;
+        float scale;
+    };
+
+    // TODO FIX ALIGNMENT ISSUES
+    struct FillTextureFloat4PushConstant {
+        float r;
+        float g;
+        float b;
+        float a;
+    };
+
+    // Feeds the GI of the previous frames back into the emission the raymarch sees, one more bounce per frame
+    struct MultiBounceSettings {
+        bool enabled = false;
+        // Weight of the newest GI in the moving average the bounce is read from
+        float blend = 0.1f;
+        // Albedo of painted texels, scene primitives have their own
+        float paintedAlbedo = 0.5f;
+    };
+
+    // Raymarches a rotating subset of each level per frame, with ray angles jittered inside their bin, and averages the
+    // results into the raymarch image of each level. Brush strokes trace the probes whose rays can reach them again,
+    // their averages start over. A reset, a scene change or a resize traces everything and restarts every average.
+    struct TemporalSettings {
+        bool enabled = false;
+        // Frames to trace every texel once
+        uint32_t period = 4;
+        // Lowest weight of a new result, the average stops converging there and keeps following slow changes
+        float minimumBlend = 0.1f;
+    };
+
+    // Raymarches the upper levels, which hold distant and smoother light, less often than the lower ones. A level that
+    // is not traced is not dispatched at all, the merges still run every frame from its last raymarch. Brush strokes
+    // trace, on every level, the probes whose rays can reach them in the frame that draws them. A reset, a scene
+    // change or a resize traces every level in full.
+    struct LevelScheduleSettings {
+        bool enabled = false;
+        // Levels below are traced every frame, the interval doubles at each level from this one
+        uint32_t firstStaggeredLevel = 2;
+        uint32_t maxInterval = 8;
+    };
+
+    struct RaymarchPushConstant {
+        RadianceCascadeSettings radianceCascadeSettings;
+        uint32_t currentLevel;
+        uint32_t multiBounce;
+        float paintedAlbedo;
+        uint32_t temporal;
+        uint32_t temporalPeriod;
+        uint32_t temporalPhase;
+        float jitter;
+        float historyBlend;
+        CascadeLayout cascadeLayout;
+        // Probes traced in full whatever the schedule, empty when the min is above the max
+        int32_t forcedProbeMinX;
+        int32_t forcedProbeMinY;
+        int32_t forcedProbeMaxX;
+        int32_t forcedProbeMaxY;
+    };
+
+    struct RaycastSegmentsPushConstant {
+        RadianceCascadeSettings radianceCascadeSettings;
+        uint32_t currentLevel;
+        float gridOriginX;
+        float gridOriginY;
+        float cellSize;
+        uint32_t columns;
+        uint32_t rows;
+        CascadeLayout cascadeLayout;
+    };
+
+    struct MergeCascadesPushConstant {
+        RadianceCascadeSettings radianceCascadeSettings;
+        uint32_t outputLevel;
+        CascadeLayout cascadeLayout;
+        // Lets the sampler filter between probes in the direction first layout
+        uint32_t filterProbes;
+    };
+
+    // Matches the entry point uniforms of MergeCascadesToGI.slang
+    struct MergeCascadesToGIPushConstant {
+        CascadeLayout cascadeLayout;
+        uint32_t filterProbes;
+    };
+
+    // Memory bound to one image, role is the name shown in the memory panel
+    struct MemoryUsage {
+        std::string role;
+        VkDeviceSize bytes;
+    };
+
+    // framesInFlight is how many frames can be recorded before the first one is known to be complete.
+    // cascadeFormat is the storage of the cascade and GI images, RGBA32F or RGBA16F. The physical device tells whether
+    // the cascade format can be filtered.
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice, VmaAllocator allocator, VkExtent2D renderExtent,
+              const RadianceCascadeSettings &settings, uint32_t framesInFlight,
+              VkFormat cascadeFormat = VK_FORMAT_R32G32B32A32_SFLOAT);
+
+    void Destroy();
+
+    // Recreates the extent dependent images if the extent changed, the drawn SDF is rescaled into the new one on the
+    // next frame, and always recreates the cascade images. Never waits for the device: the new images are used from
+    // the next recorded frame on while the frames in flight keep the old ones. When the previous change is still in
+    // flight, this one is deferred to the BeginFrame that can apply it.
+    void SetConfiguration(VkExtent2D renderExtent, const RadianceCascadeSettings &settings);
+
+    // SetConfiguration with the latest settings, including ones still waiting for the frames in flight
+    void SetRenderExtent(VkExtent2D renderExtent);
+
+    // Uploads the primitives and their grid, the scene is evaluated into the SDF on the next recorded frame and again
+    // after every reset or resize. Brush strokes drawn since stay, the nearest surface wins.
+    void SetScene(const Scene &scene);
+
+    // Back to a painted only SDF, the evaluated scene stays until the next reset
+    void ClearScene();
+
+    // Segment ray casting falls back to the SDF raymarch while no scene is loaded
+    void SetTraceMode(TraceMode mode) { traceMode = mode; }
+
+    TraceMode GetTraceMode() const { return traceMode; }
+
+    // Applied from the next recorded frame, which traces everything again since the kept raymarches are in the old
+    // order. The cascade images returned by GetCascadeImages are in this layout.
+    void SetCascadeLayout(CascadeLayout layout);
+
+    CascadeLayout GetCascadeLayout() const { return cascadeLayout; }
+
+    // With a recorder the cascade levels are traced from secondary command buffers recorded in parallel, and timed as
+    // one pass. Null records everything serially into the primary buffer.
+    void SetCommandRecorder(CommandRecorder *recorder) { commandRecorder = recorder; }
+
+    // Merges level 0 and averages it into the GI image in one pass instead of merging then running BuildGITexture.
+    // On by default, both paths give the same images.
+    void SetFusedGIMerge(bool fused) { fusedGIMerge = fused; }
+
+    bool GetFusedGIMerge() const { return fusedGIMerge; }
+
+    void SetGIUpsampling(GIUpsampling upsampling) { giUpsampling = upsampling; }
+
+    GIUpsampling GetGIUpsampling() const { return giUpsampling; }
+
+    // Only the SDF raymarch gathers the bounce, segment ray casting stays single bounce. Turning it on starts the
+    // average over from black.
+    void SetMultiBounce(const MultiBounceSettings &settings);
+
+    const MultiBounceSettings &GetMultiBounce() const { return multiBounce; }
+
+    // Only the SDF raymarch is amortized, segment ray casting traces every texel. Turning it on or off recreates the
+    // cascade images like a settings change, to allocate or release the merged images.
+    void SetTemporal(const TemporalSettings &settings);
+
+    const TemporalSettings &GetTemporal() const { return temporal; }
+
+    // Turning it on or off recreates the cascade images like SetTemporal, both keep the raymarch of each level
+    void SetLevelSchedule(const LevelScheduleSettings &settings);
+
+    const LevelScheduleSettings &GetLevelSchedule() const { return levelSchedule; }
+
+    // Frames between two raymarches of the level, 1 without the schedule. Levels are offset from each other so the
+    // upper ones do not all land on the same frame.
+    uint32_t GetLevelInterval(uint32_t level) const;
+
+    // Called once before recording each frame, the frame recorded framesInFlight frames ago must be complete.
+    // Destroys the resources the GPU no longer uses and applies a deferred configuration.
+    void BeginFrame();
+
+    // Replaces the brush segments of the frame recorded last with newer input, before its command buffer is submitted.
+    // At most MAX_BRUSH_SEGMENTS are drawn.
+    void LatchBrushSegments(std::span<const BrushSegment> brushSegments);
+
+    // Transitions the screen images and clears the SDF, recorded once before the first frame
+    void RecordInitCommands(VkCommandBuffer cmd);
+
+    // Draws the brush segments into the SDF in one dispatch over their bounding box, nothing when there are none,
+    // evaluates the scene if needed, then runs every pass up to displayImage. At most MAX_BRUSH_SEGMENTS are drawn.
+    // The caller begins the timer frame. The brush dispatch is indirect, LatchBrushSegments can still replace the
+    // segments until the command buffer is submitted.
+    void RecordFrameCommands(VkCommandBuffer cmd, std::span<const BrushSegment> brushSegments, bool resetSDF,
+                             GpuTimer &gpuTimer);
+
+    VkExtent2D GetRenderExtent() const { return renderExtent; }
+
+    VkExtent2D GetCascadeExtent() const;
+
+    static VkExtent2D GetCascadeExtent(VkExtent2D renderExtent, const RadianceCascadeSettings &settings);
+
+    const RadianceCascadeSettings &GetSettings() const { return radianceCascadeSettings; }
+
+    VkFormat GetCascadeFormat() const { return cascadeFormat; }
+
+    // Whether the direction first merges let the sampler filter between probes, set when the device can filter
+    // the cascade format
+    bool GetProbeFiltering() const { return cascadeFilterSupported; }
+
+    // Memory bound to each image the renderer owns: SDF, albedo, display, the SDF waiting to be rescaled, every
+    // cascade level and GI
+    std::vector<MemoryUsage> GetMemoryUsage() const;
+
+    // Sum of GetMemoryUsage
+    VkDeviceSize GetImageMemoryBytes() const;
+
+    // Memory the images would need with this configuration and the current temporal mode, without the previous SDF
+    // kept for the rescale
+    VkDeviceSize PredictImageMemoryBytes(VkExtent2D renderExtent, const RadianceCascadeSettings &settings) const;
+
+    // Every image is in general layout once a frame has been recorded. The SDF and display images are RGBA32F, the
+    // cascade and GI images use the cascade format.
+    const Image &GetSDFImage() const { return sdfImage; }
+
+    // RGBA8 reflectance of the nearest scene surface wherever the scene won over the SDF content, alpha 1 there and zero
+    // elsewhere
+    const Image &GetAlbedoImage() const { return albedoImage; }
+
+    const Image &GetDisplayImage() const { return displayImage; }
+
+    // Holds the merged radiance of each level after a frame, except the last level which is only raymarched
+    const std::vector<Image> &GetCascadeImages() const { return mergedLevelImages; }
+
+    // Half the cascade extent
+    const Image &GetGlobalIlluminationImage() const { return globalIlluminationImage; }
+
+    // Moving average of the GI read by the multi-bounce raymarch, same extent and format as the GI
+    const Image &GetBounceImage() const { return bounceImage; }
+
+private:
+    void CreateScreenImages();
+
+    void CreateCascadeImages();
+
+    void ApplyConfiguration(VkExtent2D renderExtent, const RadianceCascadeSettings &settings);
+
+    // Destroys the image once the frames recorded so far are complete
+    void RetireImage(const Image &image);
+
+    void RetireBuffer(const Buffer &buffer);
+
+    // From the cascade pool, or a separate allocation when the image is larger than a pool block
+    Image CreateCascadeImage(const VkImageCreateInfo &imgCreateInfo);
+
+    void WriteDescriptors();
+
+    // Both return the region of the SDF the segments are drawn in, empty when there are none
+    VkRect2D RecordBrushCommands(VkCommandBuffer cmd, std::span<const BrushSegment> brushSegments,
+                                 GpuTimer &gpuTimer);
+
+    VkRect2D WriteBrushParameters(std::span<const BrushSegment> brushSegments);
+
+    void RecordSceneCommands(VkCommandBuffer cmd, GpuTimer &gpuTimer);
+
+    // Temporal and scheduled modes keep the raymarch of each level from one frame to the next, the merges write to
+    // separate images
+    bool KeepsHistory() const { return temporal.enabled || levelSchedule.enabled; }
+
+    // Image holding the merged radiance of the level after a frame
+    const Image &GetMergedLevelImage(uint32_t level) const;
+
+    void UpdateMergedLevelImages();
+
+    // Picks the levels and texels this frame traces and how they blend with the previous raymarch. On top of the
+    // schedule, every level traces the probes whose rays can reach changedRegion of the SDF.
+    void FillLevelPushConstants(bool restartHistory, VkRect2D changedRegion);
+
+    void RecordTraceLevel(VkCommandBuffer cmd, uint32_t level, bool raycast);
+
+    Buffer CreateSceneBuffer(const void *data, VkDeviceSize size);
+
+    void RecordClearAlbedo(VkCommandBuffer cmd);
+
+    void RecordClearBounce(VkCommandBuffer cmd);
+
+    void DefragmentCascadePool();
+
+    VkDeviceSize GetRequiredBytes(const VkImageCreateInfo &imgCreateInfo) const;
+
+    VkDevice device{};
+    VmaAllocator allocator{};
+    uint32_t framesInFlight = 1;
+    VkFormat cascadeFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+    VkExtent2D renderExtent{};
+    RadianceCascadeSettings radianceCascadeSettings{};
+    Image sdfImage{};
+    Image displayImage{};
+    Image albedoImage{};
+    // Kept alive until its content has been rescaled into the new sdfImage
+    Image previousSDFImage{};
+    VkExtent2D previousSDFExtent{};
+    bool screenImagesRecreated = false;
+    uint32_t frameNumber = 0;
+    DeletionQueue deletionQueue{};
+    // Descriptor set copy bound by the recorded frames, the other one is rewritten by the next configuration change
+    // once the frames using it are complete
+    uint32_t descriptorSlot = 0;
+    uint32_t spareDescriptorSlotReleaseFrame = 0;
+    bool pendingConfiguration = false;
+    VkExtent2D pendingRenderExtent{};
+    RadianceCascadeSettings pendingSettings{};
+    // Holds the cascade and GI images, which live until the next settings change
+    VmaPool cascadePool{};
+    uint32_t settingsChangesSinceDefragmentation = 0;
+    std::vector<Image> raymarchImages{};
+    // Set when the cascade images were created for temporal or scheduled mode. The raymarch images then keep the
+    // raymarch of each level and the merges write to mergedImages, one per level below the last.
+    bool raymarchesKept = false;
+    std::vector<Image> mergedImages{};
+    // What GetCascadeImages returns, copies of the raymarch or merged image of each level
+    std::vector<Image> mergedLevelImages{};
+    TemporalSettings temporal{};
+    LevelScheduleSettings levelSchedule{};
+    // Times each level was traced since the history was last restarted, 0 traces every texel of the level
+    std::array<uint32_t, MAX_LEVEL> levelTraceCounts{};
+    // Frames since the history was last restarted, 0 traces every level
+    uint32_t scheduleFrame = 0;
+    // Drawn by segments latched after the frame was recorded, the next frame traces the probes that see it
+    VkRect2D lateBrushRegion{};
+    // Filled before the levels are traced, a level that is not traced this frame is not dispatched
+    std::array<RaymarchPushConstant, MAX_LEVEL> levelPushConstants{};
+    std::array<bool, MAX_LEVEL> levelTraced{};
+    Image globalIlluminationImage{};
+    Image bounceImage{};
+    // Cleared before the next multi-bounce frame reads it
+    bool bounceInvalid = true;
+    MultiBounceSettings multiBounce{};
+    VkSampler linearSampler{};
+    // Bilinear, for the merges of the direction first layout
+    VkSampler probeFilterSampler{};
+    // Linear filtering of RGBA32F is optional, the merges fall back to interpolating by hand without it
+    bool cascadeFilterSupported = false;
+    // Host visible, MAX_BRUSH_SEGMENTS per frame in flight
+    Buffer brushSegmentBuffer{};
+    // Host visible, one BrushParameters per frame in flight, also the indirect dispatch buffer
+    Buffer brushParameterBuffer{};
+    // Host visible copies of the scene, replaced as a whole by SetScene
+    Buffer scenePrimitiveBuffer{};
+    Buffer scenePointBuffer{};
+    Buffer sceneCellRangeBuffer{};
+    Buffer sceneCellPrimitiveBuffer{};
+    Scene::Grid sceneGrid{};
+    bool sceneDirty = false;
+    // Outline of the scene for RAYCAST_SEGMENTS
+    Buffer sceneSegmentBuffer{};
+    Buffer sceneSegmentCellRangeBuffer{};
+    Buffer sceneSegmentCellBuffer{};
+    Scene::Grid sceneSegmentGrid{};
+    TraceMode traceMode = RAYMARCH_SDF;
+    CascadeLayout cascadeLayout = PROBE_FIRST;
+    CommandRecorder *commandRecorder = nullptr;
+    bool fusedGIMerge = true;
+    GIUpsampling giUpsampling = BILINEAR;
+    VkImageLayout raymarchImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout outputGIImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    Pipeline drawToSDFTexturePipeline{};
+    // One descriptor set copy per frame in flight, written when recording since the scene buffers change on their own
+    Pipeline evaluateSceneSDFPipeline{};
+    Pipeline fillTextureFloat4Pipeline{};
+    Pipeline finalPassPipeline{};
+    Pipeline finalPassEdgeAwarePipeline{};
+    std::vector<Pipeline> raymarchPipelines{};
+    // One descriptor set copy per frame in flight, written when recording like the scene evaluation
+    std::vector<Pipeline> raycastSegmentsPipelines{};
+    std::vector<Pipeline> mergeCascadesPipelines{};
+    Pipeline mergeCascadesToGIPipeline{};
+    Pipeline buildGITexturePipeline{};
+    Pipeline accumulateBouncePipeline{};
+    Pipeline rescaleSDFTexturePipeline{};
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Mirrors the push constant layout expected by the cascade shaders, keep in sync with the slang side
+struct RadianceCascadeSettings {
+    uint32_t maxLevel;
+    uint32_t verticalProbeCountAtMaxLevel;
+    float radius;
+    float radiusMultiplier;
+    float raymarchStepSize;
+    float attenuation;
+};
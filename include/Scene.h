@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ScenePoint {
+    float x;
+    float y;
+};
+
+struct SceneMaterial {
+    float emission[3];
+    float albedo[3];
+};
+
+// Vector scene made of analytic primitives, evaluated into the SDF on the GPU instead of being painted.
+// Coordinates are in scene units where the render height is 1 and x goes from 0 to the aspect ratio, so a scene keeps
+// its shape at every render resolution.
+class Scene {
+public:
+    // Matches the primitive types in EvaluateSceneSDF.slang
+    enum PrimitiveType : uint32_t {
+        CIRCLE,
+        BOX,
+        CAPSULE,
+        POLYGON,
+        BEZIER
+    };
+
+    void AddCircle(ScenePoint center, float radius, const SceneMaterial &material);
+
+    // Axis aligned
+    void AddBox(ScenePoint center, ScenePoint halfExtents, const SceneMaterial &material);
+
+    void AddCapsule(ScenePoint start, ScenePoint end, float radius, const SceneMaterial &material);
+
+    // Closed, any winding, may be concave
+    void AddPolygon(const std::vector<ScenePoint> &points, const SceneMaterial &material);
+
+    // Quadratic Bézier curve of the given half thickness
+    void AddBezier(ScenePoint start, ScenePoint control, ScenePoint end, float thickness,
+                   const SceneMaterial &material);
+
+    // One primitive per line, '#' starts a comment. Geometry comes first, then the material:
+    //   circle <x> <y> <radius>
+    //   box <x> <y> <half width> <half height>
+    //   capsule <x0> <y0> <x1> <y1> <radius>
+    //   polygon <count> <x0> <y0> ... <xn> <yn>
+    //   bezier <x0> <y0> <cx> <cy> <x1> <y1> <thickness>
+    // followed by "emission <r> <g> <b> albedo <r> <g> <b>". Prints the error and returns false on malformed input,
+    // the scene is left untouched.
+    bool Load(const std::string &path);
+
+    static Scene CreateDemo();
+
+    bool Empty() const { return m_primitives.empty(); }
+
+    // GPU side layout of a primitive, std430
+    struct Primitive {
+        PrimitiveType type;
+        uint32_t pointOffset;
+        uint32_t pointCount;
+        // Circle and capsule radius, Bézier half thickness
+        float radius;
+        float emission[4];
+        float albedo[4];
+    };
+
+    struct CellRange {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Uniform grid over the scene bounds. Every cell lists the primitives closer than band to it, any other
+    // primitive is at least band away from the whole cell, which is what texels in it get as a distance bound.
+    struct Grid {
+        ScenePoint origin;
+        float cellSize;
+        float band;
+        uint32_t columns;
+        uint32_t rows;
+        std::vector<CellRange> cellRanges;
+        std::vector<uint32_t> cellPrimitives;
+    };
+
+    // cellsPerUnit is the number of cells along one scene unit, the band is bandCells cells wide
+    Grid BuildGrid(uint32_t cellsPerUnit = 32, uint32_t bandCells = 2) const;
+
+    // GPU side layout of a segment for exact ray casting, std430
+    struct Segment {
+        float startX;
+        float startY;
+        float endX;
+        float endY;
+        float emission[4];
+    };
+
+    // Outline of every primitive as segments. Curved outlines are flattened to stay within tolerance of the true
+    // shape, zero radius capsules and zero thickness curves stay open lines.
+    std::vector<Segment> BuildSegments(float tolerance = 0.001f) const;
+
+    // Grid whose cells list the segments actually crossing them, without a band, for DDA traversal
+    static Grid BuildSegmentGrid(const std::vector<Segment> &segments, uint32_t cellsPerUnit = 32);
+
+    const std::vector<Primitive> &GetPrimitives() const { return m_primitives; }
+
+    const std::vector<ScenePoint> &GetPoints() const { return m_points; }
+
+private:
+    struct Bounds {
+        ScenePoint min;
+        ScenePoint max;
+    };
+
+    // Sizes the grid over the union of the bounds and fills every cell the bounds grown by the band overlap, for
+    // which overlaps(item, cellBounds) also holds
+    static Grid BuildGrid(const std::vector<Bounds> &itemBounds, uint32_t cellsPerUnit, uint32_t bandCells,
+                          const std::function<bool(uint32_t, const Bounds &)> &overlaps);
+
+    void AddPrimitive(PrimitiveType type, const std::vector<ScenePoint> &points, float radius,
+                      const SceneMaterial &material);
+
+    std::vector<Primitive> m_primitives;
+    std::vector<ScenePoint> m_points;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+// Fixed capacity lock free ring for exactly one producer thread and one consumer thread. Push fails instead of
+// blocking when the ring is full.
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool Push(const T &value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        m_items[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> Pop() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+
+        T value = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    std::array<T, Capacity> m_items{};
+    // Producer and consumer indices on separate cache lines, they only ever increase
+    alignas(64) std::atomic<size_t> m_head = 0;
+    alignas(64) std::atomic<size_t> m_tail = 0;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Minimal fixed size thread pool. Tasks are fire and forget, ParallelFor blocks until its range is done and
+// has the calling thread take part in the work.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        for (uint32_t i = 0; i < threadCount; i++) {
+            m_threads.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto &thread: m_threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    uint32_t GetThreadCount() const { return m_threads.size(); }
+
+    void Submit(std::function<void()> task) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_tasks.push(std::move(task));
+            m_pendingTasks++;
+        }
+        m_condition.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void Wait() {
+        std::unique_lock lock(m_mutex);
+        m_idleCondition.wait(lock, [this] { return m_pendingTasks == 0; });
+    }
+
+    // Runs task(i) for every i in [0, count), indices are handed out dynamically. Returns once every index is
+    // done, helpers that get scheduled late simply find nothing left to do.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &task) {
+        if (count == 0) {
+            return;
+        }
+
+        struct Range {
+            std::function<void(uint32_t)> task;
+            uint32_t count;
+            std::atomic<uint32_t> next = 0;
+            std::atomic<uint32_t> done = 0;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+        auto range = std::make_shared<Range>();
+        range->task = task;
+        range->count = count;
+
+        auto work = [range] {
+            uint32_t completed = 0;
+            for (uint32_t i = range->next++; i < range->count; i = range->next++) {
+                range->task(i);
+                completed++;
+            }
+            if (completed > 0 && range->done.fetch_add(completed) + completed == range->count) {
+                std::lock_guard lock(range->mutex);
+                range->condition.notify_all();
+            }
+        };
+
+        uint32_t helpers = std::min<uint32_t>(count - 1, m_threads.size());
+        for (uint32_t i = 0; i < helpers; i++) {
+            Submit(work);
+        }
+        work();
+
+        std::unique_lock lock(range->mutex);
+        range->condition.wait(lock, [&] { return range->done == count; });
+    }
+
+private:
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+
+            task();
+
+            {
+                std::lock_guard lock(m_mutex);
+                m_pendingTasks--;
+                if (m_pendingTasks == 0) {
+                    m_idleCondition.notify_all();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::queue<std::function<void()> > m_tasks;
+    uint32_t m_pendingTasks = 0;
+    bool m_stopping = false;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_idleCondition;
+};
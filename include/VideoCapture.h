@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Common.h>
+#include <PipelineBuilder.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams every frame of the display image as Y4M or raw RGB24 to a file or to the stdin of a command. A compute pass
+// converts the frame straight into one of a ring of persistently mapped buffers, which a writer thread drains in order
+// once the frame is complete. Like the renderer it never waits for the device.
+class VideoCapture {
+public:
+    enum Format {
+        // 4:2:0 BT.601 limited range, with the stream header, plays anywhere
+        Y4M,
+        // Packed 8 bit sRGB without any header, for ffmpeg -f rawvideo -pix_fmt rgb24
+        RGB24
+    };
+
+    // What happens to a frame when the writer still holds every buffer
+    enum LagPolicy {
+        // Skip the frame, the video loses it but the app keeps its frame rate
+        DROP,
+        // Wait for the writer, the app slows down to the consumer
+        BLOCK
+    };
+
+    // framesInFlight follows the renderer convention, slotCount must be larger
+    void Init(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight, uint32_t slotCount = 4);
+
+    // The device must be idle, a running capture is finished first
+    void Destroy();
+
+    // target is a file path, or a shell command starting with '|' that gets the stream on stdin. The video keeps the
+    // extent it starts with, rounded down to a multiple of 8 wide and 2 high, and is rescaled when the display
+    // image changes size. Prints the reason and returns false when the target cannot be opened.
+    bool Start(const std::string &target, VkExtent2D extent, Format format, uint32_t framesPerSecond,
+               LagPolicy lagPolicy);
+
+    // The frames already recorded are still written, the stream is closed once they are
+    void Stop();
+
+    // Called once before recording each frame, hands the completed frames to the writer
+    void BeginFrame();
+
+    // displayImage is in general layout, written by compute shaders earlier in cmd
+    void RecordFrame(VkCommandBuffer cmd, const Image &displayImage);
+
+    bool IsRecording() const { return m_recording; }
+
+    uint64_t GetWrittenCount() const { return m_written; }
+
+    uint64_t GetDroppedCount() const { return m_dropped; }
+
+    // Time RecordFrame spent waiting for the writer under BLOCK
+    double GetBlockedMilliseconds() const { return m_blockedMilliseconds; }
+
+    struct PushConstant {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+    };
+
+private:
+    enum SlotState : uint32_t {
+        FREE,
+        RECORDED,
+        WRITING
+    };
+
+    struct Slot {
+        Buffer buffer{};
+        std::atomic<uint32_t> state = FREE;
+        uint32_t readyFrame = 0;
+    };
+
+    void WriterLoop();
+
+    // Closes the stream once every recorded frame has been written
+    void Finish();
+
+    VkDeviceSize GetFrameBytes() const;
+
+    VkDevice m_device{};
+    VmaAllocator m_allocator{};
+    uint32_t m_framesInFlight = 1;
+    uint32_t m_frameNumber = 0;
+    Pipeline m_convertPipeline{};
+    std::vector<Slot> m_slots;
+    // Frames go out in ring order
+    uint32_t m_nextSlot = 0;
+
+    bool m_recording = false;
+    bool m_stopping = false;
+    FILE *m_stream = nullptr;
+    bool m_streamIsPipe = false;
+    VkExtent2D m_extent{};
+    Format m_format{};
+    LagPolicy m_lagPolicy{};
+    bool m_lagging = false;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_writerCondition;
+    // Signaled when the writer frees a slot
+    std::condition_variable m_freeCondition;
+    std::deque<uint32_t> m_writeQueue;
+    bool m_writerExit = false;
+
+    std::atomic<uint64_t> m_written = 0;
+    uint64_t m_dropped = 0;
+    double m_blockedMilliseconds = 0.0;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <Common.h>
+#include <DeletionQueue.h>
+#include <GpuTimer.h>
+#include <PipelineBuilder.h>
+#include <RadianceCascadeSettings.h>
+
+#include <span>
+#include <vector>
+
+// Cascade levels of the volume, the memory of a level shrinks by half at each level
+#define MAX_VOLUME_LEVEL 8
+
+// 3D counterpart of RadianceCascadeRenderer, to evaluate radiance cascades on voxel scenes. The scene is a unit cube
+// SDF volume evaluated from spheres and boxes. Every cascade level is a 3D image where each probe owns a square tile of
+// octahedrally mapped directions, 2^(level + 1) on a side like the 2D probes, and a slice per probe layer. Directions
+// nest between levels, so a texel merges the 2x2 texels of the level above that cover the same octahedral bin.
+// Level 0 is averaged into a GI volume, which the final pass samples where camera rays hit the scene.
+//
+// The settings mean the same as in 2D, in units of the volume side, except attenuation which is unused: radiance does
+// not fall off along a ray in 3D.
+class VolumeCascadeRenderer {
+public:
+    // Matches VolumePrimitive in EvaluateVolumeSDF.slang. Coordinates are in the unit cube, y up.
+    struct Primitive {
+        enum Type : uint32_t {
+            SPHERE,
+            BOX
+        };
+
+        float center[3];
+        Type type;
+        // Radius of a sphere in x, half extents of a box
+        float size[3];
+        float padding0;
+        float emission[3];
+        float padding1;
+        float albedo[3];
+        float padding2;
+    };
+
+    // Orbits the centre of the volume
+    struct Camera {
+        // Radians
+        float yaw = 0.0f;
+        float pitch = 0.3f;
+        // In units of the volume side, from the centre
+        float distance = 1.8f;
+        // Vertical, radians
+        float fieldOfView = 0.9f;
+    };
+
+    struct EvaluateVolumeSDFPushConstant {
+        uint32_t primitiveCount;
+    };
+
+    struct RaymarchVolumePushConstant {
+        RadianceCascadeSettings radianceCascadeSettings;
+        uint32_t currentLevel;
+    };
+
+    struct MergeVolumeCascadesPushConstant {
+        RadianceCascadeSettings radianceCascadeSettings;
+        uint32_t outputLevel;
+    };
+
+    // Matches PushConstants in FinalPassVolume.slang
+    struct FinalPassVolumePushConstant {
+        float eye[3];
+        float tanHalfFieldOfView;
+        float forward[3];
+        float aspectRatio;
+        float right[3];
+        float padding0;
+        float up[3];
+        float padding1;
+    };
+
+    // volumeResolution is the SDF voxel count on each side
+    void Init(VkDevice device, VmaAllocator allocator, uint32_t volumeResolution,
+              const RadianceCascadeSettings &settings, uint32_t framesInFlight);
+
+    void Destroy();
+
+    // Recreates the cascade and GI volumes, the old ones are destroyed once the frames in flight are done
+    void SetSettings(const RadianceCascadeSettings &settings);
+
+    const RadianceCascadeSettings &GetSettings() const { return radianceCascadeSettings; }
+
+    // Evaluated into the SDF volume on the next recorded frame, the volume starts empty
+    void SetPrimitives(std::span<const Primitive> primitives);
+
+    // Light panel, coloured walls and a few blockers in an open box facing the default camera
+    static std::vector<Primitive> CreateDemoScene();
+
+    // Called once before recording each frame, the frame recorded framesInFlight frames ago must be complete
+    void BeginFrame();
+
+    // Runs every pass and renders the scene seen from camera into output, a general layout RGBA32F storage image of
+    // outputExtent. The output is bound when recording, it can change from one frame to the next.
+    void RecordFrameCommands(VkCommandBuffer cmd, const Image &output, VkExtent2D outputExtent, const Camera &camera,
+                             GpuTimer &gpuTimer);
+
+    // Side of every cascade level and of the GI volume in texels, the depth of level L is this over 2^(L + 1)
+    uint32_t GetCascadeWidth() const;
+
+    static uint32_t GetCascadeWidth(const RadianceCascadeSettings &settings);
+
+    // Memory bound to the volumes, the cascade levels and GI
+    VkDeviceSize GetImageMemoryBytes() const;
+
+private:
+    void CreateCascadeImages();
+
+    void RetireImage(const Image &image);
+
+    // Writes the copy of the descriptor sets this frame binds
+    void WriteDescriptors(uint32_t copy, const Image &output);
+
+    VkDevice device{};
+    VmaAllocator allocator{};
+    uint32_t framesInFlight = 1;
+    uint32_t volumeResolution = 0;
+    RadianceCascadeSettings radianceCascadeSettings{};
+    uint32_t frameNumber = 0;
+    DeletionQueue deletionQueue{};
+    // RGB emission of the nearest surface and its distance in units of the volume side
+    Image sdfVolume{};
+    Image albedoVolume{};
+    std::vector<Image> cascadeVolumes{};
+    // One texel per level 0 probe
+    Image globalIlluminationVolume{};
+    // Set when the images above were created and are still in undefined layout
+    bool sdfVolumesCreated = false;
+    bool cascadeVolumesCreated = false;
+    VkSampler linearSampler{};
+    // Host visible, replaced as a whole by SetPrimitives, never empty
+    Buffer primitiveBuffer{};
+    uint32_t primitiveCount = 0;
+    bool sceneDirty = false;
+    // Every pipeline has one descriptor set copy per frame in flight, all written when recording
+    Pipeline evaluateVolumeSDFPipeline{};
+    std::vector<Pipeline> raymarchPipelines{};
+    std::vector<Pipeline> mergeCascadesPipelines{};
+    Pipeline buildGIVolumePipeline{};
+    Pipeline finalPassPipeline{};
+};
@@ -1,6 +1,9 @@
 #include <Common.h>
 #include <ComputeApp.h>
 #include <ComputeAppConfig.h>
+#include <CommandRecorder.h>
+#include <LatencyTracker.h>
+#include <ThreadPool.h>
 
 #include <VkBootstrap.h>
 #include <GLFW/glfw3.h>
@@ -8,11 +11,21 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 
+// vk-bootstrap takes the first supported mode of the list, and FIFO when none is
+void SetPresentMode(vkb::SwapchainBuilder &builder, VkPresentModeKHR presentMode) {
+    builder.set_desired_present_mode(presentMode);
+    if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+        // Still not waiting for the vertical blank, without tearing
+        builder.add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
+    }
+    builder.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+}
+
 int main() {
     // Window creation
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     GLFWwindow *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan window", nullptr, nullptr);
 
     vkb::InstanceBuilder instanceBuilder;
@@ -47,6 +60,8 @@ int main() {
     vulkan12Features.storagePushConstant8 = VK_TRUE;
     vulkan12Features.shaderInt8 = VK_TRUE;
     vulkan12Features.shaderFloat16 = VK_TRUE;
+    // Frame completion for the latency measurement
+    vulkan12Features.timelineSemaphore = VK_TRUE;
     VkPhysicalDeviceFeatures features{};
     features.shaderInt16 = VK_TRUE;
 
@@ -64,7 +79,37 @@ int main() {
         return 1;
     }
 
+    // Lets VMA report the real per heap budget, including what other processes use
+    bool memoryBudgetSupported = physicalDeviceSelectorResult.value().enable_extension_if_present(
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Present ids and waiting on them tell when a frame actually reached the screen
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+    bool presentWaitSupported = false;
+    if (physicalDeviceSelectorResult.value().is_extension_present(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        physicalDeviceSelectorResult.value().is_extension_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDeviceSelectorResult.value().physical_device, &features2);
+        presentWaitSupported = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    }
+    if (presentWaitSupported) {
+        physicalDeviceSelectorResult.value().enable_extensions_if_present(
+            {VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME});
+    }
+
     vkb::DeviceBuilder deviceBuilder{physicalDeviceSelectorResult.value()};
+    if (presentWaitSupported) {
+        // vk-bootstrap builds the chain itself
+        presentIdFeatures.pNext = nullptr;
+        deviceBuilder.add_pNext(&presentIdFeatures);
+        deviceBuilder.add_pNext(&presentWaitFeatures);
+    }
     // automatically propagate needed data from instance & physical device
     auto deviceBuilderResult = deviceBuilder.build();
     if (!deviceBuilderResult) {
@@ -92,16 +137,26 @@ int main() {
     }
     VkQueue computeQueue = computeQueueResult.value();
 
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+
     vkb::SwapchainBuilder swapchainBuilder{device};
+    SetPresentMode(swapchainBuilder, requestedPresentMode);
     auto swapchainBuilderResult = swapchainBuilder.use_default_format_selection()
-            .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-            .set_desired_extent(WINDOW_WIDTH, WINDOW_HEIGHT)
+            .set_desired_extent(framebufferWidth, framebufferHeight)
             .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
             .build();
 
+    if (!swapchainBuilderResult) {
+        std::print("Failed to create swapchain. Error: {}\n", swapchainBuilderResult.error().message());
+        return 1;
+    }
+
     vkb::Swapchain swapchain = swapchainBuilderResult.value();
 
-    auto imageViews = swapchainBuilderResult->get_image_views().value();
+    auto imageViews = swapchain.get_image_views().value();
     auto images = swapchain.get_images().value();
 
     // Synchronization
@@ -129,39 +184,16 @@ int main() {
         VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]));
     }
 
-    // Compute Command Pools
-    VkCommandPool computeCommandPool;
-    VkCommandPoolCreateInfo computeCommandPoolCreateInfo{};
-    computeCommandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    computeCommandPoolCreateInfo.queueFamilyIndex = device.get_queue_index(vkb::QueueType::compute).value();
-    computeCommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-    VK_CHECK(vkCreateCommandPool(device, &computeCommandPoolCreateInfo, nullptr, &computeCommandPool));
-
-    std::vector<VkCommandBuffer> computeCommandBuffers;
-    computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = computeCommandPool;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(computeCommandBuffers.size());
+    // Command pools, one per recording thread and frame in flight, reset as a whole once the frame's fence is waited on
+    ThreadPool recordingThreads(2);
 
-    VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, computeCommandBuffers.data()));
+    CommandRecorder computeRecorder;
+    computeRecorder.Init(device, device.get_queue_index(vkb::QueueType::compute).value(), MAX_FRAMES_IN_FLIGHT,
+                         recordingThreads);
 
-    // Graphics Command Pools
-    VkCommandPool graphicsCommandPool;
-    VkCommandPoolCreateInfo graphicsCommandPoolCreateInfo{};
-    graphicsCommandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    graphicsCommandPoolCreateInfo.queueFamilyIndex = device.get_queue_index(vkb::QueueType::graphics).value();
-    graphicsCommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-    VK_CHECK(vkCreateCommandPool(device, &graphicsCommandPoolCreateInfo, nullptr, &graphicsCommandPool));
-
-    std::vector<VkCommandBuffer> graphicsCommandBuffers;
-    graphicsCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.commandPool = graphicsCommandPool;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(graphicsCommandBuffers.size());
-
-    VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, graphicsCommandBuffers.data()));
+    CommandRecorder graphicsRecorder;
+    graphicsRecorder.Init(device, device.get_queue_index(vkb::QueueType::graphics).value(), MAX_FRAMES_IN_FLIGHT,
+                          recordingThreads);
 
     // Imgui
     VkDescriptorPoolSize poolSizes[] =
@@ -219,13 +251,65 @@ int main() {
     allocatorInfo.device = device.device;
     allocatorInfo.instance = instance.instance;
     allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+    if (memoryBudgetSupported) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
 
     VmaAllocator allocator;
     VK_CHECK(vmaCreateAllocator(&allocatorInfo, &allocator));
 
-    ComputeApp::GetInstance()->Setup(device.device, instance.instance, allocator, window);
+    LatencyTracker latencyTracker;
+    latencyTracker.Init(device, presentWaitSupported);
+
+    ComputeApp::GetInstance()->Setup(device.device, instance.instance, device.physical_device.physical_device,
+                                     device.get_queue_index(vkb::QueueType::compute).value(), allocator, window,
+                                     &computeRecorder, &latencyTracker);
+    ComputeApp::GetInstance()->SetActivePresentMode(swapchain.present_mode);
     ComputeApp::GetInstance()->Init();
 
+    // Rebuild the swapchain for the current framebuffer size and let the app reallocate its
+    // extent dependent resources. Blocks while the window is minimized.
+    auto recreateSwapchain = [&]() {
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        while (framebufferWidth == 0 || framebufferHeight == 0) {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        }
+
+        vkDeviceWaitIdle(device);
+        latencyTracker.ForgetPresents();
+
+        requestedPresentMode = ComputeApp::GetInstance()->GetRequestedPresentMode();
+        vkb::SwapchainBuilder swapchainRebuilder{device};
+        SetPresentMode(swapchainRebuilder, requestedPresentMode);
+        auto swapchainRebuildResult = swapchainRebuilder.use_default_format_selection()
+                .set_desired_extent(framebufferWidth, framebufferHeight)
+                .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+                .set_old_swapchain(swapchain)
+                .build();
+
+        if (!swapchainRebuildResult) {
+            throw std::runtime_error(std::format("Failed to recreate swapchain. Error: {}",
+                                                 swapchainRebuildResult.error().message()));
+        }
+
+        for (auto &image_view: imageViews) {
+            vkDestroyImageView(device, image_view, nullptr);
+        }
+        destroy_swapchain(swapchain);
+
+        swapchain = swapchainRebuildResult.value();
+        imageViews = swapchain.get_image_views().value();
+        images = swapchain.get_images().value();
+
+        if (swapchain.present_mode != requestedPresentMode) {
+            std::print("Present mode {} not supported, using {}\n", string_VkPresentModeKHR(requestedPresentMode),
+                       string_VkPresentModeKHR(swapchain.present_mode));
+        }
+        ComputeApp::GetInstance()->SetActivePresentMode(swapchain.present_mode);
+        ComputeApp::GetInstance()->Resize(swapchain.extent.width, swapchain.extent.height);
+    };
+
     uint32_t frame = 0;
     uint32_t currentFrame = 0;
     uint32_t imageIndex = 0;
@@ -234,42 +318,83 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        latencyTracker.PollPresents(swapchain);
+
+        // Some platforms (wayland) never report out of date swapchains, so compare against the framebuffer too
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if ((uint32_t) framebufferWidth != swapchain.extent.width ||
+            (uint32_t) framebufferHeight != swapchain.extent.height ||
+            ComputeApp::GetInstance()->GetRequestedPresentMode() != requestedPresentMode) {
+            recreateSwapchain();
+        }
+
+        VkResult acquireResult = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX,
+                                                       imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE,
+                                                       &imageIndex);
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            // The semaphore was not signaled and the fence is still signaled, we can simply retry
+            recreateSwapchain();
+            continue;
+        }
+        if (acquireResult != VK_SUBOPTIMAL_KHR) {
+            VK_CHECK(acquireResult);
+        }
+
+        // Only reset the fence once we know work will be submitted for this frame
+        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+        latencyTracker.BeginFrame(frame);
+        computeRecorder.BeginFrame(currentFrame);
+        graphicsRecorder.BeginFrame(currentFrame);
+        VkCommandBuffer computeCommandBuffer = computeRecorder.AllocatePrimary();
+        VkCommandBuffer graphicsCommandBuffer = graphicsRecorder.AllocatePrimary();
+
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        ComputeApp::GetInstance()->Update(frame);
 
-        vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE,
-                              &imageIndex);
+        // Render imgui. Nothing touches ImGui for the rest of the frame, so its draw data is recorded on a worker
+        // while this thread records the compute commands.
+        ImGui::Render();
 
-        ComputeApp::GetInstance()->Update(frame);
+        VkCommandBufferInheritanceRenderingInfo uiRenderingInfo{};
+        uiRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        uiRenderingInfo.colorAttachmentCount = 1;
+        uiRenderingInfo.pColorAttachmentFormats = &swapchain.image_format;
+        uiRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-        vkResetCommandBuffer(computeCommandBuffers[currentFrame], 0);
+        VkCommandBufferInheritanceInfo uiInheritance{};
+        uiInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        uiInheritance.pNext = &uiRenderingInfo;
+
+        VkCommandBuffer uiCommandBuffer;
+        graphicsRecorder.RecordSecondaryAsync([](VkCommandBuffer cmd) {
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+        }, &uiCommandBuffer, &uiInheritance);
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
+        latencyTracker.Mark(LatencyTracker::RECORD);
+
         //
         //
         // Begin recording compute
-        vkBeginCommandBuffer(computeCommandBuffers[currentFrame], &beginInfo);
+        vkBeginCommandBuffer(computeCommandBuffer, &beginInfo);
         if (init) {
-            ComputeApp::GetInstance()->ComputeQueueInitCommands(computeCommandBuffers[currentFrame]);
+            ComputeApp::GetInstance()->ComputeQueueInitCommands(computeCommandBuffer);
         }
 
-        TransitionImage(computeCommandBuffers[currentFrame], images[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_GENERAL);
+        TransitionImage(computeCommandBuffer, images[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
         // RECORD COMPUTE COMMANDS HERE
-        ComputeApp::GetInstance()->ComputeQueueCommands(computeCommandBuffers[currentFrame], images[imageIndex],
+        ComputeApp::GetInstance()->ComputeQueueCommands(computeCommandBuffer, images[imageIndex],
                                                         imageViews[imageIndex], swapchain.extent);
         // STOP
-        vkEndCommandBuffer(computeCommandBuffers[currentFrame]);
-
-        // Render imgui
-        ImGui::Render();
+        vkEndCommandBuffer(computeCommandBuffer);
 
         VkRenderingAttachmentInfo colorAttachment{};
         colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
@@ -282,28 +407,30 @@ int main() {
 
         VkRenderingInfo renderInfo{};
         renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
         renderInfo.layerCount = 1;
         renderInfo.colorAttachmentCount = 1;
         renderInfo.pColorAttachments = &colorAttachment;
         renderInfo.renderArea.extent = swapchain.extent;
 
-        vkBeginCommandBuffer(graphicsCommandBuffers[currentFrame], &beginInfo);
+        vkBeginCommandBuffer(graphicsCommandBuffer, &beginInfo);
         if (init) {
-            ComputeApp::GetInstance()->GraphicsQueueInitCommands(graphicsCommandBuffers[currentFrame]);
+            ComputeApp::GetInstance()->GraphicsQueueInitCommands(graphicsCommandBuffer);
         }
 
-        ComputeApp::GetInstance()->GraphicsQueueCommands(graphicsCommandBuffers[currentFrame], images[imageIndex],
+        ComputeApp::GetInstance()->GraphicsQueueCommands(graphicsCommandBuffer, images[imageIndex],
                                                          imageViews[imageIndex], swapchain.extent);
-        TransitionImage(graphicsCommandBuffers[currentFrame], images[imageIndex], VK_IMAGE_LAYOUT_GENERAL,
+        TransitionImage(graphicsCommandBuffer, images[imageIndex], VK_IMAGE_LAYOUT_GENERAL,
                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        vkCmdBeginRendering(graphicsCommandBuffers[currentFrame], &renderInfo);
+        vkCmdBeginRendering(graphicsCommandBuffer, &renderInfo);
 
-        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), graphicsCommandBuffers[currentFrame]);
+        graphicsRecorder.WaitSecondary();
+        vkCmdExecuteCommands(graphicsCommandBuffer, 1, &uiCommandBuffer);
 
-        vkCmdEndRendering(graphicsCommandBuffers[currentFrame]);
-        TransitionImage(graphicsCommandBuffers[currentFrame], images[imageIndex],
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-        vkEndCommandBuffer(graphicsCommandBuffers[currentFrame]);
+        vkCmdEndRendering(graphicsCommandBuffer);
+        TransitionImage(graphicsCommandBuffer, images[imageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        vkEndCommandBuffer(graphicsCommandBuffer);
 
         VkSemaphore computeWaitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkSemaphore computeSignalSemaphore[] = {computeFinishedSemaphores[currentFrame]};
@@ -312,29 +439,43 @@ int main() {
         VkSubmitInfo computeSubmitInfo{};
         computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         computeSubmitInfo.commandBufferCount = 1;
-        computeSubmitInfo.pCommandBuffers = &computeCommandBuffers[currentFrame];
+        computeSubmitInfo.pCommandBuffers = &computeCommandBuffer;
         computeSubmitInfo.waitSemaphoreCount = 1;
         computeSubmitInfo.pWaitSemaphores = computeWaitSemaphores;
         computeSubmitInfo.pWaitDstStageMask = waitStages;
         computeSubmitInfo.signalSemaphoreCount = 1;
         computeSubmitInfo.pSignalSemaphores = computeSignalSemaphore;
 
+        // Input only arrives while polling, the events since the start of the frame are handed to PreSubmit
+        glfwPollEvents();
+        ComputeApp::GetInstance()->PreSubmit();
         VK_CHECK(vkQueueSubmit(computeQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
 
         VkSemaphore graphicsWaitSemaphores[] = {computeFinishedSemaphores[currentFrame]};
-        VkSemaphore graphicsSignalSemaphores[] = {graphicsFinishedSemaphores[currentFrame]};
+        // The present only waits on the binary semaphore, the timeline one tells the latency tracker
+        VkSemaphore graphicsSignalSemaphores[] = {
+            graphicsFinishedSemaphores[currentFrame], latencyTracker.GetCompletionSemaphore()
+        };
+        uint64_t graphicsSignalValues[] = {0, (uint64_t) frame + 1};
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.signalSemaphoreValueCount = 2;
+        timelineSubmitInfo.pSignalSemaphoreValues = graphicsSignalValues;
 
         VkSubmitInfo graphicsSubmitInfo{};
         graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        graphicsSubmitInfo.pNext = &timelineSubmitInfo;
         graphicsSubmitInfo.commandBufferCount = 1;
-        graphicsSubmitInfo.pCommandBuffers = &graphicsCommandBuffers[currentFrame];
+        graphicsSubmitInfo.pCommandBuffers = &graphicsCommandBuffer;
         graphicsSubmitInfo.waitSemaphoreCount = 1;
         graphicsSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores;
         graphicsSubmitInfo.pWaitDstStageMask = waitStages;
-        graphicsSubmitInfo.signalSemaphoreCount = 1;
+        graphicsSubmitInfo.signalSemaphoreCount = 2;
         graphicsSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores;
 
         VK_CHECK(vkQueueSubmit(graphicsQueue, 1, &graphicsSubmitInfo, inFlightFences[currentFrame]));
+        latencyTracker.Mark(LatencyTracker::SUBMIT);
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -347,7 +488,25 @@ int main() {
         presentInfo.pSwapchains = swapChains;
         presentInfo.pImageIndices = &imageIndex;
 
-        vkQueuePresentKHR(graphicsQueue, &presentInfo);
+        uint64_t presentId = (uint64_t) frame + 1;
+        VkPresentIdKHR presentIdInfo{};
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &presentId;
+        if (latencyTracker.PresentWaitSupported()) {
+            presentInfo.pNext = &presentIdInfo;
+        }
+
+        VkResult presentResult = vkQueuePresentKHR(graphicsQueue, &presentInfo);
+        if (presentResult == VK_SUCCESS || presentResult == VK_SUBOPTIMAL_KHR) {
+            latencyTracker.TrackPresent(frame);
+            latencyTracker.PollPresents(swapchain);
+        }
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+            recreateSwapchain();
+        } else {
+            VK_CHECK(presentResult);
+        }
 
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
         frame++;
@@ -361,12 +520,14 @@ int main() {
     ComputeApp::GetInstance()->Cleanup();
     ComputeApp::DestroyInstance();
 
+    latencyTracker.Destroy();
+
     ImGui_ImplVulkan_Shutdown();
 
     vkDestroyDescriptorPool(device, imguiPool, nullptr);
 
-    vkDestroyCommandPool(device, computeCommandPool, nullptr);
-    vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
+    computeRecorder.Destroy();
+    graphicsRecorder.Destroy();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(device, computeFinishedSemaphores[i], nullptr);
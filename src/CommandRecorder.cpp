@@ -0,0 +1,136 @@
+#include <CommandRecorder.h>
+
+void CommandRecorder::Init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+                           ThreadPool &threadPool) {
+    m_device = device;
+    m_queueFamilyIndex = queueFamilyIndex;
+    m_threadPool = &threadPool;
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo{};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    // Buffers are never reset one by one, only whole pools
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_commands.resize(framesInFlight);
+    for (auto &frameCommands: m_commands) {
+        frameCommands.resize(threadPool.GetThreadCount() + 1);
+        for (auto &threadCommands: frameCommands) {
+            VK_CHECK(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &threadCommands.pool));
+        }
+    }
+}
+
+void CommandRecorder::Destroy() {
+    for (auto &frameCommands: m_commands) {
+        for (auto &threadCommands: frameCommands) {
+            // Frees its command buffers
+            vkDestroyCommandPool(m_device, threadCommands.pool, nullptr);
+        }
+    }
+    m_commands.clear();
+    m_threadIndices.clear();
+}
+
+void CommandRecorder::BeginFrame(uint32_t frameIndex) {
+    m_currentFrameIndex = frameIndex;
+    for (auto &threadCommands: m_commands[frameIndex]) {
+        VK_CHECK(vkResetCommandPool(m_device, threadCommands.pool, 0));
+        threadCommands.usedPrimaries = 0;
+        threadCommands.usedSecondaries = 0;
+    }
+}
+
+CommandRecorder::ThreadCommands &CommandRecorder::GetThreadCommands() {
+    std::lock_guard lock(m_threadMutex);
+    auto [it, inserted] = m_threadIndices.try_emplace(std::this_thread::get_id(), m_threadIndices.size());
+    if (it->second >= m_commands[m_currentFrameIndex].size()) {
+        m_threadIndices.erase(it);
+        throw std::runtime_error("More threads are recording than the command recorder has pools for");
+    }
+    return m_commands[m_currentFrameIndex][it->second];
+}
+
+VkCommandBuffer CommandRecorder::Allocate(ThreadCommands &commands, VkCommandBufferLevel level) {
+    bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    auto &buffers = primary ? commands.primaries : commands.secondaries;
+    uint32_t &used = primary ? commands.usedPrimaries : commands.usedSecondaries;
+
+    if (used == buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commands.pool;
+        allocInfo.level = level;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer));
+        buffers.push_back(commandBuffer);
+    }
+
+    return buffers[used++];
+}
+
+VkCommandBuffer CommandRecorder::AllocatePrimary() {
+    return Allocate(GetThreadCommands(), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+VkCommandBuffer CommandRecorder::BeginSecondary(const VkCommandBufferInheritanceInfo *inheritance) {
+    VkCommandBuffer commandBuffer = Allocate(GetThreadCommands(), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+    VkCommandBufferInheritanceInfo computeInheritance{};
+    computeInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = inheritance != nullptr ? inheritance : &computeInheritance;
+    if (inheritance != nullptr && inheritance->pNext != nullptr) {
+        // Only dynamic rendering is chained, the buffer runs entirely inside the primary's rendering
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+
+    VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    return commandBuffer;
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::RecordSecondary(
+    uint32_t count, const std::function<void(uint32_t, VkCommandBuffer)> &record,
+    const VkCommandBufferInheritanceInfo *inheritance) {
+    std::vector<VkCommandBuffer> commandBuffers(count);
+
+    m_threadPool->ParallelFor(count, [&](uint32_t i) {
+        VkCommandBuffer commandBuffer = BeginSecondary(inheritance);
+        record(i, commandBuffer);
+        VK_CHECK(vkEndCommandBuffer(commandBuffer));
+        commandBuffers[i] = commandBuffer;
+    });
+
+    return commandBuffers;
+}
+
+void CommandRecorder::RecordSecondaryAsync(const std::function<void(VkCommandBuffer)> &record,
+                                           VkCommandBuffer *commandBuffer,
+                                           const VkCommandBufferInheritanceInfo *inheritance) {
+    {
+        std::lock_guard lock(m_asyncMutex);
+        m_pendingAsync++;
+    }
+
+    m_threadPool->Submit([this, record, commandBuffer, inheritance] {
+        VkCommandBuffer recorded = BeginSecondary(inheritance);
+        record(recorded);
+        VK_CHECK(vkEndCommandBuffer(recorded));
+        *commandBuffer = recorded;
+
+        std::lock_guard lock(m_asyncMutex);
+        if (--m_pendingAsync == 0) {
+            m_asyncCondition.notify_all();
+        }
+    });
+}
+
+void CommandRecorder::WaitSecondary() {
+    std::unique_lock lock(m_asyncMutex);
+    m_asyncCondition.wait(lock, [this] { return m_pendingAsync == 0; });
+}
@@ -35,19 +35,24 @@ void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout
     vkCmdPipelineBarrier2(cmd, &depInfo);
 }
 
-Image CreateImage(VkDevice device, VkImageCreateInfo imgCreateInfo, VmaAllocator allocator) {
+Image CreateImage(VkDevice device, VkImageCreateInfo imgCreateInfo, VmaAllocator allocator, VmaPool pool) {
+    // VMA still gives the image its own memory when the driver prefers or requires it
     VmaAllocationCreateInfo allocCreateInfo = {};
     allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    allocCreateInfo.pool = pool;
     allocCreateInfo.priority = 1.0f;
 
     VkImage img;
     VmaAllocation alloc;
     VK_CHECK(vmaCreateImage(allocator, &imgCreateInfo, &allocCreateInfo, &img, &alloc, nullptr));
 
+    return {img, CreateImageView(device, img, imgCreateInfo), alloc};
+}
+
+VkImageView CreateImageView(VkDevice device, VkImage image, const VkImageCreateInfo &imgCreateInfo) {
     VkImageViewCreateInfo viewCreateInfo{};
     viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewCreateInfo.image = img;
+    viewCreateInfo.image = image;
     viewCreateInfo.viewType = imgCreateInfo.imageType == VK_IMAGE_TYPE_2D ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_3D;
     viewCreateInfo.format = imgCreateInfo.format;
     viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -60,7 +65,7 @@ Image CreateImage(VkDevice device, VkImageCreateInfo imgCreateInfo, VmaAllocator
 
     VK_CHECK(vkCreateImageView(device, &viewCreateInfo, nullptr, &view));
 
-    return {img, view, alloc};
+    return view;
 }
 
 void DestroyImage(VkDevice device, VmaAllocator allocator, Image img) {
@@ -68,6 +73,30 @@ void DestroyImage(VkDevice device, VmaAllocator allocator, Image img) {
     vmaDestroyImage(allocator, img.image, img.memory);
 }
 
+Buffer CreateBuffer(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+                    VmaAllocationCreateFlags flags) {
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.flags = flags;
+
+    Buffer buffer{};
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBuffer(allocator, &bufferCreateInfo, &allocCreateInfo, &buffer.buffer, &buffer.memory,
+                             &allocationInfo));
+    buffer.mapped = allocationInfo.pMappedData;
+
+    return buffer;
+}
+
+void DestroyBuffer(VmaAllocator allocator, Buffer buffer) {
+    vmaDestroyBuffer(allocator, buffer.buffer, buffer.memory);
+}
+
 VkShaderModule CreateShaderModule(VkDevice device, const uint32_t *code, size_t size) {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
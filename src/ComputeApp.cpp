@@ -4,11 +4,17 @@
 
 #include <ComputeApp.h>
 
-void ComputeApp::Setup(VkDevice dev, VkInstance inst, VmaAllocator all, GLFWwindow *win) {
+void ComputeApp::Setup(VkDevice dev, VkInstance inst, VkPhysicalDevice physDev, uint32_t computeQueueFamily,
+                       VmaAllocator all, GLFWwindow *win, CommandRecorder *computeRecorder,
+                       LatencyTracker *tracker) {
     device = dev;
     instance = inst;
+    physicalDevice = physDev;
+    computeQueueFamilyIndex = computeQueueFamily;
     allocator = all;
     window = win;
+    computeCommandRecorder = computeRecorder;
+    latencyTracker = tracker;
 }
 
 ComputeApp * ComputeApp::GetInstance() {
@@ -5,283 +5,160 @@
 #include <ComputeApp.h>
 #include <ComputeAppConfig.h>
 #include <Common.h>
+#include <FrameReadback.h>
+#include <GpuTimer.h>
+#include <QualityGovernor.h>
+#include <RadianceCascadeRenderer.h>
+#include <RadianceCascadeSettings.h>
+#include <Scene.h>
+#include <SpscQueue.h>
+#include <VideoCapture.h>
+#include <VolumeCascadeRenderer.h>
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
+#include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 
 #include <algorithm>
-
-// Generated by shader compilation
-// Avoid loading shaders through the filesystem, because i'm lazy
-#include <PipelineBuilder.h>
-#include <Shaders/DrawToSDFTexture.h>
-#include <Shaders/FillTextureFloat4.h>
-#include <Shaders/FinalPass.h>
-#include <Shaders/RaymarchSDF.h>
-#include <Shaders/MergeCascades.h>
-#include <Shaders/BuildGITexture.h>
-
-#define MAX_LEVEL 10
+#include <fstream>
+#include <string>
+#include <vector>
 
 class ComputeAppImpl : public ComputeApp {
 public:
     ComputeAppImpl() = default;
 
-    // TODO FIX ALIGNMENT ISSUES
-    struct ComputeDrawToSDFTexturePushConstant {
-        uint16_t mousePosX;
-        uint16_t mousePosY;
-        uint8_t radius;
-        uint8_t r;
-        uint8_t g;
-        uint8_t b;
-    };
-
-    // TODO FIX ALIGNMENT ISSUES
-    struct FillTextureFloat4PushConstant {
-        float r;
-        float g;
-        float b;
-        float a;
-    };
-
-    struct RadianceCascadeSettings {
-        uint32_t maxLevel;
-        uint32_t verticalProbeCountAtMaxLevel;
-        float radius;
-        float radiusMultiplier;
-        float raymarchStepSize;
-        float attenuation;
-    };
-
-    struct RaymarchPushConstant {
-        RadianceCascadeSettings radianceCascadeSettings;
-        uint32_t currentLevel;
-    };
+    void Init() override {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        windowExtent = {(uint32_t) framebufferWidth, (uint32_t) framebufferHeight};
+
+        gpuTimer.Init(device, physicalDevice, computeQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, 32);
+        qualityGovernor.SetBase(newRadianceCascadeSettings);
+
+        renderer.Init(device, physicalDevice, allocator, windowExtent, newRadianceCascadeSettings,
+                      MAX_FRAMES_IN_FLIGHT);
+        renderer.SetCommandRecorder(computeCommandRecorder);
+        readback.Init(device, allocator, MAX_FRAMES_IN_FLIGHT);
+        videoCapture.Init(device, allocator, MAX_FRAMES_IN_FLIGHT);
+        volumeRenderer.Init(device, allocator, VOLUME_RESOLUTION, newVolumeSettings, MAX_FRAMES_IN_FLIGHT);
+        volumeRenderer.SetPrimitives(VolumeCascadeRenderer::CreateDemoScene());
+
+        // Replaces the callbacks ImGui installed, they forward to it. GLFW reports every cursor move between two
+        // polls, so fast strokes stay continuous instead of being sampled once per frame.
+        glfwSetWindowUserPointer(window, this);
+        glfwSetCursorPosCallback(window, CursorPosCallback);
+        glfwSetMouseButtonCallback(window, MouseButtonCallback);
+    }
 
-    struct MergeCascadesPushConstant {
-        RadianceCascadeSettings radianceCascadeSettings;
-        uint32_t outputLevel;
+    struct PointerEvent {
+        enum Type : uint8_t {
+            MOVE,
+            PRESS,
+            RELEASE
+        };
+
+        Type type;
+        // Window coordinates
+        double x;
+        double y;
+        // When GLFW reported it, where the input latency starts
+        LatencyTracker::Clock::time_point time;
     };
 
-    void Init() override {
-        VkImageCreateInfo imgCreateInfo{};
-        imgCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imgCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-        imgCreateInfo.extent.width = WINDOW_WIDTH;
-        imgCreateInfo.extent.height = WINDOW_HEIGHT;
-        imgCreateInfo.extent.depth = 1;
-        imgCreateInfo.mipLevels = 1;
-        imgCreateInfo.arrayLayers = 1;
-        imgCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-        imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imgCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        imgCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-
-        sdfImage = CreateImage(device, imgCreateInfo, allocator);
-        displayImage = CreateImage(device, imgCreateInfo, allocator);
-
-        VkSamplerCreateInfo sdfSamplerCreateInfo{};
-        sdfSamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        sdfSamplerCreateInfo.magFilter = VK_FILTER_NEAREST; //VK_FILTER_LINEAR;
-        sdfSamplerCreateInfo.minFilter = VK_FILTER_NEAREST; //VK_FILTER_LINEAR;
-        sdfSamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST; // VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        sdfSamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        sdfSamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        sdfSamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        sdfSamplerCreateInfo.mipLodBias = 0.0f;
-        sdfSamplerCreateInfo.anisotropyEnable = VK_FALSE;
-        sdfSamplerCreateInfo.maxAnisotropy = 1.0f;
-        sdfSamplerCreateInfo.compareEnable = VK_FALSE;
-        sdfSamplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-        sdfSamplerCreateInfo.minLod = 0.0f;
-        sdfSamplerCreateInfo.maxLod = 0.0f;
-        sdfSamplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        sdfSamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
-
-        VK_CHECK(vkCreateSampler(device, &sdfSamplerCreateInfo, nullptr, &linearSampler));
-
-        PipelineBuilder pipelineBuilder(device);
-
-        pipelineBuilder.AddShaderStage(DrawToSDFTexture, sizeof(DrawToSDFTexture), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        // Draw to SDF pipeline
-        VkDescriptorSetLayoutBinding drawToSDFTextureDescriptorSetLayoutBinding{};
-        drawToSDFTextureDescriptorSetLayoutBinding.binding = 0;
-        drawToSDFTextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        drawToSDFTextureDescriptorSetLayoutBinding.descriptorCount = 1;
-        drawToSDFTextureDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        drawToSDFTextureDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, drawToSDFTextureDescriptorSetLayoutBinding);
-
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-
-        pipelineBuilder.SetPushConstantSize<ComputeDrawToSDFTexturePushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
-
-        drawToSDFTexturePipeline = pipelineBuilder.Build();
-
-        // Set descriptor set
-        VkDescriptorImageInfo descriptorImageInfoSDFImage{};
-        descriptorImageInfoSDFImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoSDFImage.imageView = sdfImage.view;
-        descriptorImageInfoSDFImage.sampler = VK_NULL_HANDLE;
-        drawToSDFTexturePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                      &descriptorImageInfoSDFImage, nullptr);
-
-        pipelineBuilder.Reset();
-
-        pipelineBuilder.AddShaderStage(FillTextureFloat4, sizeof(FillTextureFloat4), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        // Draw to SDF pipeline
-        VkDescriptorSetLayoutBinding fillTextureFloat4DescriptorSetLayoutBinding{};
-        fillTextureFloat4DescriptorSetLayoutBinding.binding = 0;
-        fillTextureFloat4DescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        fillTextureFloat4DescriptorSetLayoutBinding.descriptorCount = 1;
-        fillTextureFloat4DescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        fillTextureFloat4DescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, fillTextureFloat4DescriptorSetLayoutBinding);
-
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-        pipelineBuilder.SetPushConstantSize<FillTextureFloat4PushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
-
-        fillTextureFloat4Pipeline = pipelineBuilder.Build();
-
-        fillTextureFloat4Pipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                       &descriptorImageInfoSDFImage, nullptr);
-
-        pipelineBuilder.Reset();
-
-        pipelineBuilder.AddShaderStage(FinalPass, sizeof(FinalPass), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        VkDescriptorSetLayoutBinding convertSDFDescriptorSetLayoutBinding{};
-        convertSDFDescriptorSetLayoutBinding.binding = 0;
-        convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        convertSDFDescriptorSetLayoutBinding.descriptorCount = 1;
-        convertSDFDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        convertSDFDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
-        convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        convertSDFDescriptorSetLayoutBinding.binding = 1;
-        pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
-        convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        convertSDFDescriptorSetLayoutBinding.binding = 2;
-        pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
-
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-
-        finalPassPipeline = pipelineBuilder.Build();
-
-        finalPassPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfoSDFImage,
-                                               nullptr);
-
-        VkDescriptorImageInfo descriptorImageInfoDisplayImage{};
-        descriptorImageInfoDisplayImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoDisplayImage.imageView = displayImage.view;
-        descriptorImageInfoDisplayImage.sampler = VK_NULL_HANDLE;
-
-        finalPassPipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfoDisplayImage,
-                                               nullptr);
-
-        pipelineBuilder.Reset();
-
-        pipelineBuilder.AddShaderStage(RaymarchSDF, sizeof(RaymarchSDF), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        VkDescriptorSetLayoutBinding raymarchDescriptorSetLayoutBinding{};
-        raymarchDescriptorSetLayoutBinding.binding = 0;
-        raymarchDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        raymarchDescriptorSetLayoutBinding.descriptorCount = 1;
-        raymarchDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        raymarchDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, raymarchDescriptorSetLayoutBinding);
-        raymarchDescriptorSetLayoutBinding.binding = 1;
-        raymarchDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        pipelineBuilder.AddBinding(0, raymarchDescriptorSetLayoutBinding);
+    static void CursorPosCallback(GLFWwindow *window, double x, double y) {
+        ImGui_ImplGlfw_CursorPosCallback(window, x, y);
 
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-        pipelineBuilder.SetPushConstantSize<RaymarchPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+        auto *app = static_cast<ComputeAppImpl *>(glfwGetWindowUserPointer(window));
+        app->pointerEvents.Push({PointerEvent::MOVE, x, y, LatencyTracker::Clock::now()});
+    }
 
-        // Create sampler
+    static void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
+        ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
 
-        VkDescriptorImageInfo descriptorImageInfoSDFImageSampler{};
-        descriptorImageInfoSDFImageSampler.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoSDFImageSampler.imageView = sdfImage.view;
-        descriptorImageInfoSDFImageSampler.sampler = linearSampler;
-        for (int i = 0; i < MAX_LEVEL; i++) {
-            raymarchPipelines.push_back(pipelineBuilder.Build());
-            raymarchPipelines.back().WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                          &descriptorImageInfoSDFImageSampler, nullptr);
+        if (button != GLFW_MOUSE_BUTTON_LEFT) {
+            return;
         }
 
-        pipelineBuilder.Reset();
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
 
-        pipelineBuilder.AddShaderStage(MergeCascades, sizeof(MergeCascades), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        VkDescriptorSetLayoutBinding mergeCascadeDescriptorSetLayoutBinding{};
-        mergeCascadeDescriptorSetLayoutBinding.binding = 0;
-        mergeCascadeDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        mergeCascadeDescriptorSetLayoutBinding.descriptorCount = 1;
-        mergeCascadeDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        mergeCascadeDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
-        mergeCascadeDescriptorSetLayoutBinding.binding = 1;
-        pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+        auto *app = static_cast<ComputeAppImpl *>(glfwGetWindowUserPointer(window));
+        app->pointerEvents.Push({
+            action == GLFW_PRESS ? PointerEvent::PRESS : PointerEvent::RELEASE, x, y, LatencyTracker::Clock::now()
+        });
+    }
 
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-        pipelineBuilder.SetPushConstantSize<MergeCascadesPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+    // Turns the pointer events since the last frame into capsules between consecutive cursor positions
+    void ConsumePointerEvents() {
+        VkExtent2D renderExtent = renderer.GetRenderExtent();
+
+        // Cursor is in screen coordinates, which can differ from the framebuffer on high dpi displays
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        float scaleX = windowWidth > 0 ? (float) renderExtent.width / windowWidth : 1.0f;
+        float scaleY = windowHeight > 0 ? (float) renderExtent.height / windowHeight : 1.0f;
+
+        while (auto event = pointerEvents.Pop()) {
+            float x = event->x * scaleX;
+            float y = event->y * scaleY;
+
+            switch (event->type) {
+                case PointerEvent::PRESS:
+                    // Clicks on the UI don't draw
+                    isDrawing = !ImGui::GetIO().WantCaptureMouse;
+                    lastPointerX = x;
+                    lastPointerY = y;
+                    break;
+                case PointerEvent::RELEASE:
+                    isDrawing = false;
+                    continue;
+                case PointerEvent::MOVE:
+                    break;
+            }
 
-        for (int i = 0; i < MAX_LEVEL; i++) {
-            mergeCascadesPipelines.push_back(pipelineBuilder.Build());
+            if (isDrawing) {
+                brushSegments.push_back({
+                    lastPointerX, lastPointerY, x, y, (float) radius, color[0], color[1], color[2]
+                });
+                latencyTracker->MarkInput(event->time);
+            }
+            lastPointerX = x;
+            lastPointerY = y;
         }
+    }
 
-        pipelineBuilder.Reset();
-
-        pipelineBuilder.AddShaderStage(BuildGITexture, sizeof(BuildGITexture), VK_SHADER_STAGE_COMPUTE_BIT);
-
-        VkDescriptorSetLayoutBinding buildGITextureDescriptorSetLayoutBinding{};
-        buildGITextureDescriptorSetLayoutBinding.binding = 0;
-        buildGITextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        buildGITextureDescriptorSetLayoutBinding.descriptorCount = 1;
-        buildGITextureDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        buildGITextureDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-        pipelineBuilder.AddBinding(0, buildGITextureDescriptorSetLayoutBinding);
-        buildGITextureDescriptorSetLayoutBinding.binding = 1;
-        pipelineBuilder.AddBinding(0, buildGITextureDescriptorSetLayoutBinding);
-
-        pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
-
-        buildGITexturePipeline = pipelineBuilder.Build();
+    void Resize(uint32_t width, uint32_t height) override {
+        windowExtent = {width, height};
+        renderer.SetRenderExtent(GetScaledExtent());
+    }
 
-        ApplySettings();
+    VkExtent2D GetScaledExtent() const {
+        return {
+            std::max(1u, (uint32_t) (windowExtent.width * renderScale)),
+            std::max(1u, (uint32_t) (windowExtent.height * renderScale))
+        };
     }
 
     void ComputeQueueInitCommands(VkCommandBuffer cmd) override {
-        TransitionImage(cmd, sdfImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-        TransitionImage(cmd, displayImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-        fillTextureFloat4Pipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
-        FillTextureFloat4PushConstant pushConstant{};
-        // pushConstant.width = WINDOW_WIDTH;
-        // pushConstant.height = WINDOW_HEIGHT;
-        pushConstant.r = 0.0f;
-        pushConstant.g = 0.0f;
-        pushConstant.b = 0.0f;
-        pushConstant.a = 1000000.0f;
-
-        fillTextureFloat4Pipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
-
-        fillTextureFloat4Pipeline.Dispatch(cmd, WINDOW_WIDTH / 8, WINDOW_HEIGHT / 8, 1);
+        renderer.RecordInitCommands(cmd);
     }
 
     void Update(uint32_t frame) override {
-        if (!ImGui::GetIO().WantCaptureMouse) {
-            isLeftMouseButtonPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-        } else {
-            isLeftMouseButtonPressed = false;
+        frameNumber = frame;
+        renderer.BeginFrame();
+        readback.BeginFrame();
+        videoCapture.BeginFrame();
+        volumeRenderer.BeginFrame();
+
+        if (governorEnabled && gpuTimer.Supported() &&
+            qualityGovernor.Update(gpuTimer.GetFrameMilliseconds(), gpuTimer.GetPassTimings())) {
+            ApplyGovernorQuality();
         }
 
+        ConsumePointerEvents();
+
         // Update stuff here
         ImGui::Begin("Radiance Cascade GI Settings");
         ImGui::Text("Max level");
@@ -308,9 +185,90 @@ public:
         ImGui::InputFloat("##attei", &newRadianceCascadeSettings.attenuation);
         ImGui::SliderFloat("##atte", &newRadianceCascadeSettings.attenuation, .1f, 100.0f);
 
+        VkExtent2D cascadeExtent = renderer.GetCascadeExtent();
+        ImGui::Text("Cascade resolution: %ux%u", cascadeExtent.width, cascadeExtent.height);
+
+        // Applied right away, it only changes the final pass
+        bool sdfGuidedUpsampling = renderer.GetGIUpsampling() == RadianceCascadeRenderer::SDF_GUIDED;
+        if (ImGui::Checkbox("SDF guided GI upsampling", &sdfGuidedUpsampling)) {
+            renderer.SetGIUpsampling(sdfGuidedUpsampling ? RadianceCascadeRenderer::SDF_GUIDED
+                                                         : RadianceCascadeRenderer::BILINEAR);
+        }
+
+        // Applied right away, turning it on starts the bounce over from black
+        RadianceCascadeRenderer::MultiBounceSettings multiBounce = renderer.GetMultiBounce();
+        bool multiBounceChanged = ImGui::Checkbox("Multi-bounce", &multiBounce.enabled);
+        multiBounceChanged |= ImGui::SliderFloat("Bounce blend", &multiBounce.blend, 0.01f, 1.0f);
+        multiBounceChanged |= ImGui::SliderFloat("Painted albedo", &multiBounce.paintedAlbedo, 0.0f, 1.0f);
+        if (multiBounceChanged) {
+            renderer.SetMultiBounce(multiBounce);
+        }
+
+        // Turning it on or off recreates the cascades, the period and blend apply right away
+        RadianceCascadeRenderer::TemporalSettings temporal = renderer.GetTemporal();
+        bool temporalChanged = ImGui::Checkbox("Temporal amortization", &temporal.enabled);
+        temporalChanged |= ImGui::SliderInt("Temporal period", (int *) &temporal.period, 1, 16);
+        temporalChanged |= ImGui::SliderFloat("Minimum history blend", &temporal.minimumBlend, 0.01f, 1.0f);
+        if (temporalChanged) {
+            renderer.SetTemporal(temporal);
+        }
+
+        // Applied right away, only the order of the cascade texels changes
+        int cascadeLayout = renderer.GetCascadeLayout();
+        if (ImGui::Combo("Cascade layout", &cascadeLayout, "Probe first\0Direction first\0Morton\0")) {
+            renderer.SetCascadeLayout(static_cast<RadianceCascadeRenderer::CascadeLayout>(cascadeLayout));
+        }
+
+        RadianceCascadeRenderer::LevelScheduleSettings levelSchedule = renderer.GetLevelSchedule();
+        bool levelScheduleChanged = ImGui::Checkbox("Staggered level updates", &levelSchedule.enabled);
+        levelScheduleChanged |= ImGui::SliderInt("First staggered level", (int *) &levelSchedule.firstStaggeredLevel,
+                                                 0, MAX_LEVEL - 1);
+        levelScheduleChanged |= ImGui::SliderInt("Max level interval", (int *) &levelSchedule.maxInterval, 1, 32);
+        if (levelScheduleChanged) {
+            renderer.SetLevelSchedule(levelSchedule);
+        }
+
         if (ImGui::Button("Apply settings")) {
             ApplySettings();
         }
+        if (!settingsRefusedMessage.empty()) {
+            ImGui::TextWrapped("%s", settingsRefusedMessage.c_str());
+        }
+        ImGui::End();
+
+        DrawMemoryWindow();
+
+        ImGui::Begin("Performance");
+        if (!gpuTimer.Supported()) {
+            ImGui::Text("GPU timings not supported on this device");
+        } else {
+            ImGui::Text("GPU frame: %.3f ms", gpuTimer.GetFrameMilliseconds());
+            for (const auto &passTiming: gpuTimer.GetPassTimings()) {
+                ImGui::Text("%s: %.3f ms", passTiming.name.c_str(), passTiming.milliseconds);
+            }
+
+            bool fusedGIMerge = renderer.GetFusedGIMerge();
+            if (ImGui::Checkbox("Fuse level 0 merge and GI", &fusedGIMerge)) {
+                renderer.SetFusedGIMerge(fusedGIMerge);
+            }
+
+            ImGui::Separator();
+            if (ImGui::Checkbox("Quality governor", &governorEnabled)) {
+                // Start over from the user settings, whether it was just turned on or off
+                qualityGovernor.SetBase(newRadianceCascadeSettings);
+                ApplyGovernorQuality();
+            }
+            ImGui::SliderFloat("Target (ms)", &qualityGovernor.config.targetFrameMilliseconds, 1.0f, 33.0f);
+            ImGui::SliderFloat("Hysteresis", &qualityGovernor.config.hysteresis, 0.05f, 0.5f);
+            if (governorEnabled) {
+                const auto &quality = qualityGovernor.GetQuality();
+                ImGui::Text("Quality level %u, median %.3f ms", qualityGovernor.GetQualityLevel(),
+                            qualityGovernor.GetMedianFrameMilliseconds());
+                ImGui::Text("Max level %u, probes %u, step %.4f, scale %.2f", quality.settings.maxLevel,
+                            quality.settings.verticalProbeCountAtMaxLevel, quality.settings.raymarchStepSize,
+                            quality.renderScale);
+            }
+        }
         ImGui::End();
 
         ImGui::Begin("Pen settings");
@@ -318,287 +276,414 @@ public:
         ImGui::SliderInt("Radius", &radius, 1, 256);
         resetSDF = ImGui::Button("Reset SDF");
         ImGui::End();
+
+        DrawSceneWindow();
+        DrawCaptureWindow();
+        DrawVideoWindow();
+        DrawLatencyWindow();
+        DrawVolumeWindow();
     }
 
-    void ApplySettings() {
-        vkDeviceWaitIdle(device);
-        for (auto &raymarchImage: raymarchImages) {
-            if (raymarchImage.Initialized()) {
-                DestroyImage(device, allocator, raymarchImage);
-            }
+    void DrawVolumeWindow() {
+        ImGui::Begin("Volume");
+        ImGui::Checkbox("3D volume mode", &volumeMode);
+        ImGui::TextWrapped("Replaces the 2D scene on screen, brush strokes are ignored meanwhile");
+
+        ImGui::SliderAngle("Yaw", &volumeCamera.yaw, -180.0f, 180.0f);
+        ImGui::SliderAngle("Pitch", &volumeCamera.pitch, -89.0f, 89.0f);
+        ImGui::SliderFloat("Distance", &volumeCamera.distance, 0.5f, 4.0f);
+        ImGui::SliderAngle("Field of view", &volumeCamera.fieldOfView, 10.0f, 120.0f);
+
+        ImGui::Separator();
+        // Every level holds half the texels of the one below, level 0 is cascade width^3 / 2 texels
+        ImGui::SliderInt("Max level", (int *) &newVolumeSettings.maxLevel, 1, 6);
+        ImGui::SliderInt("Probes per side (max level)", (int *) &newVolumeSettings.verticalProbeCountAtMaxLevel, 1, 8);
+        ImGui::SliderFloat("First level radius", &newVolumeSettings.radius, .001f, .5f);
+        ImGui::SliderFloat("Radius multiplier", &newVolumeSettings.radiusMultiplier, .1f, 10.0f);
+        ImGui::SliderFloat("Minimum step", &newVolumeSettings.raymarchStepSize, .0005f, .05f);
+        uint32_t cascadeWidth = VolumeCascadeRenderer::GetCascadeWidth(newVolumeSettings);
+        ImGui::Text("Level 0: %u probes per side, 4 directions each", cascadeWidth / 2);
+        if (ImGui::Button("Apply volume settings")) {
+            volumeRenderer.SetSettings(newVolumeSettings);
         }
-        if (globalIlluminationImage.Initialized()) {
-            DestroyImage(device, allocator, globalIlluminationImage);
-        }
-        raymarchImages.clear();
-
-        radianceCascadeSettings = newRadianceCascadeSettings;
-
-        // size of cascades
-        // first we need to know the resolution the max level cascade
-        uint32_t maxLevelCascadeProbeResolution = 1 << radianceCascadeSettings.maxLevel;
-        uint32_t aspectRatio = std::ceil((float) WINDOW_WIDTH / WINDOW_HEIGHT);
-        uint32_t horizontalProbeCountAtMaxLevel = aspectRatio * radianceCascadeSettings.verticalProbeCountAtMaxLevel;
-        uint32_t cascadeWidth = horizontalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
-        uint32_t cascadeHeight = radianceCascadeSettings.verticalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
-
-        std::print("Cascade resolution: {}x{}\n", cascadeWidth, cascadeHeight);
-
-        VkImageCreateInfo imgCreateInfo{};
-        imgCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imgCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-        imgCreateInfo.extent.width = cascadeWidth;
-        imgCreateInfo.extent.height = cascadeHeight;
-        imgCreateInfo.extent.depth = 1;
-        imgCreateInfo.mipLevels = 1;
-        imgCreateInfo.arrayLayers = 1;
-        imgCreateInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-        imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imgCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        imgCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-
-        for (int i = 0; i < radianceCascadeSettings.maxLevel; i++) {
-            Image raymarchImage = CreateImage(device, imgCreateInfo, allocator);
-            raymarchImages.push_back(raymarchImage);
-
-            VkDescriptorImageInfo descriptorImageInfo{};
-            descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-            descriptorImageInfo.imageView = raymarchImage.view;
-            descriptorImageInfo.sampler = VK_NULL_HANDLE;
-            raymarchPipelines[i].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfo,
-                                                      nullptr);
-        }
-
-        raymarchImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-        for (int i = 0; i < radianceCascadeSettings.maxLevel - 1; i++) {
-            VkDescriptorImageInfo descriptorImageInfoInput{};
-            descriptorImageInfoInput.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-            descriptorImageInfoInput.imageView = raymarchImages[i + 1].view;
-            descriptorImageInfoInput.sampler = VK_NULL_HANDLE;
-            VkDescriptorImageInfo descriptorImageInfoOutput{};
-            descriptorImageInfoOutput.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-            descriptorImageInfoOutput.imageView = raymarchImages[i].view;
-            descriptorImageInfoOutput.sampler = VK_NULL_HANDLE;
-            mergeCascadesPipelines[i].WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                           &descriptorImageInfoInput, nullptr);
-            mergeCascadesPipelines[i].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                           &descriptorImageInfoOutput, nullptr);
-        }
-
-        VkImageCreateInfo imgCreateInfoOutputGI{};
-        imgCreateInfoOutputGI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imgCreateInfoOutputGI.imageType = VK_IMAGE_TYPE_2D;
-        imgCreateInfoOutputGI.extent.width = cascadeWidth / 2;
-        imgCreateInfoOutputGI.extent.height = cascadeHeight / 2;
-        imgCreateInfoOutputGI.extent.depth = 1;
-        imgCreateInfoOutputGI.mipLevels = 1;
-        imgCreateInfoOutputGI.arrayLayers = 1;
-        imgCreateInfoOutputGI.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-        imgCreateInfoOutputGI.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imgCreateInfoOutputGI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imgCreateInfoOutputGI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
-                                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        imgCreateInfoOutputGI.samples = VK_SAMPLE_COUNT_1_BIT;
-
-        globalIlluminationImage = CreateImage(device, imgCreateInfoOutputGI, allocator);
-
-        outputGIImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-        VkDescriptorImageInfo descriptorImageInfoOutputGI{};
-        descriptorImageInfoOutputGI.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoOutputGI.imageView = globalIlluminationImage.view;
-        descriptorImageInfoOutputGI.sampler = VK_NULL_HANDLE;
-        buildGITexturePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                    &descriptorImageInfoOutputGI, nullptr);
-
-        VkDescriptorImageInfo descriptorImageInfoInputCascade{};
-        descriptorImageInfoInputCascade.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoInputCascade.imageView = raymarchImages[0].view;
-        descriptorImageInfoInputCascade.sampler = VK_NULL_HANDLE;
-        buildGITexturePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                    &descriptorImageInfoInputCascade, nullptr);
-
-        VkDescriptorImageInfo descriptorImageInfoInputGI{};
-        descriptorImageInfoInputGI.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        descriptorImageInfoInputGI.imageView = globalIlluminationImage.view;
-        descriptorImageInfoInputGI.sampler = linearSampler;
-        finalPassPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                               &descriptorImageInfoInputGI, nullptr);
+        ImGui::Text("Volume memory: %.2f MiB", volumeRenderer.GetImageMemoryBytes() / MIB);
+        ImGui::End();
     }
 
-    void ComputeQueueCommands(VkCommandBuffer cmd, VkImage swapchainImage, VkImageView swapchainImageView,
-                              VkExtent2D swapchainExtent) override {
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
+    void DrawLatencyWindow() {
+        static constexpr VkPresentModeKHR PRESENT_MODES[] = {
+            VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+            VK_PRESENT_MODE_IMMEDIATE_KHR
+        };
+
+        ImGui::Begin("Latency");
+        int presentModeIndex = std::find(std::begin(PRESENT_MODES), std::end(PRESENT_MODES), requestedPresentMode) -
+                               std::begin(PRESENT_MODES);
+        if (ImGui::Combo("Present mode", &presentModeIndex, "FIFO\0FIFO relaxed\0Mailbox\0Immediate\0")) {
+            requestedPresentMode = PRESENT_MODES[presentModeIndex];
+        }
+        ImGui::Text("Active: %s", string_VkPresentModeKHR(activePresentMode));
+
+        // Only frames that drew brush input are measured
+        const auto &statistics = latencyTracker->GetStatistics();
+        ImGui::Text("Input to, over %u frames:", statistics.frameCount);
+        ImGui::Text("  record start  %6.2f ms median, %6.2f ms p95", statistics.median[LatencyTracker::RECORD],
+                    statistics.p95[LatencyTracker::RECORD]);
+        ImGui::Text("  submit        %6.2f ms median, %6.2f ms p95", statistics.median[LatencyTracker::SUBMIT],
+                    statistics.p95[LatencyTracker::SUBMIT]);
+        ImGui::Text("  GPU complete  %6.2f ms median, %6.2f ms p95",
+                    statistics.median[LatencyTracker::GPU_COMPLETE], statistics.p95[LatencyTracker::GPU_COMPLETE]);
+        if (latencyTracker->PresentWaitSupported()) {
+            ImGui::Text("  on screen     %6.2f ms median, %6.2f ms p95", statistics.median[LatencyTracker::PRESENT],
+                        statistics.p95[LatencyTracker::PRESENT]);
+        } else {
+            ImGui::Text("  on screen     unknown, no present wait");
+        }
+        ImGui::End();
+    }
 
-        // Update push constants
-        ComputeDrawToSDFTexturePushConstant pushConstant{};
-        pushConstant.mousePosX = isLeftMouseButtonPressed ? xpos : -1;
-        pushConstant.mousePosY = isLeftMouseButtonPressed ? ypos : -1;
-        pushConstant.radius = std::clamp(radius, 0, 255);
-        pushConstant.r = std::clamp((int) (255 * color[0]), 0, 255);
-        pushConstant.g = std::clamp((int) (255 * color[1]), 0, 255);
-        pushConstant.b = std::clamp((int) (255 * color[2]), 0, 255);
+    void DrawVideoWindow() {
+        ImGui::Begin("Video");
+        bool recording = videoCapture.IsRecording();
+        ImGui::BeginDisabled(recording);
+        ImGui::InputText("Target", videoTarget, sizeof(videoTarget));
+        ImGui::Combo("Format", &videoFormat, "Y4M\0Raw RGB24\0");
+        ImGui::SliderInt("FPS", &videoFramesPerSecond, 1, 240);
+        ImGui::Combo("When lagging", &videoLagPolicy, "Drop frames\0Wait for the writer\0");
+        ImGui::EndDisabled();
+        ImGui::TextWrapped("Start the target with | to pipe into a command, e.g. | ffmpeg -i - out.mp4");
+
+        if (!recording && ImGui::Button("Start")) {
+            videoCapture.Start(videoTarget, renderer.GetRenderExtent(), (VideoCapture::Format) videoFormat,
+                               videoFramesPerSecond, (VideoCapture::LagPolicy) videoLagPolicy);
+        } else if (recording && ImGui::Button("Stop")) {
+            videoCapture.Stop();
+        }
+
+        ImGui::Text("Written %llu, dropped %llu, blocked %.1f ms",
+                    (unsigned long long) videoCapture.GetWrittenCount(),
+                    (unsigned long long) videoCapture.GetDroppedCount(), videoCapture.GetBlockedMilliseconds());
+        ImGui::End();
+    }
 
-        drawToSDFTexturePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+    void DrawCaptureWindow() {
+        ImGui::Begin("Capture");
+        ImGui::Combo("Image", &captureSource, "Display\0GI\0Cascade level\0");
+        if (captureSource == CAPTURE_CASCADE) {
+            ImGui::SliderInt("Level", &captureLevel, 0, (int) renderer.GetSettings().maxLevel - 1);
+        }
+        ImGui::Combo("Encoding", &captureEncoding, "PNG\0EXR\0Raw RGBA32F\0");
 
-        drawToSDFTexturePipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+        captureRequested = ImGui::Button("Capture");
+        ImGui::SameLine();
+        ImGui::Checkbox("Every frame", &captureEveryFrame);
 
-        drawToSDFTexturePipeline.Dispatch(cmd, WINDOW_WIDTH / 8, WINDOW_HEIGHT / 8, 1);
+        ImGui::Text("Pending %u, written %llu, dropped %llu, failed %llu", readback.GetPendingCount(),
+                    (unsigned long long) readback.GetWrittenCount(), (unsigned long long) readback.GetDroppedCount(),
+                    (unsigned long long) readback.GetFailedCount());
+        ImGui::End();
+    }
 
-        if (resetSDF) {
-            CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // Recorded after the frame so the copy sees its final content
+    void RecordCapture(VkCommandBuffer cmd) {
+        if (!captureRequested && !captureEveryFrame) {
+            return;
+        }
 
-            fillTextureFloat4Pipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
-            FillTextureFloat4PushConstant fillTextureFloat4PushConstant{};
-            fillTextureFloat4PushConstant.r = 0.0f;
-            fillTextureFloat4PushConstant.g = 0.0f;
-            fillTextureFloat4PushConstant.b = 0.0f;
-            fillTextureFloat4PushConstant.a = 1000000.0f;
+        const Image *image = &renderer.GetDisplayImage();
+        VkExtent2D extent = renderer.GetRenderExtent();
+        VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        std::string name = "display";
+        if (captureSource != CAPTURE_DISPLAY) {
+            VkExtent2D cascadeExtent = renderer.GetCascadeExtent();
+            format = renderer.GetCascadeFormat();
+            if (captureSource == CAPTURE_GI) {
+                image = &renderer.GetGlobalIlluminationImage();
+                extent = {cascadeExtent.width / 2, cascadeExtent.height / 2};
+                name = "gi";
+            } else {
+                // The level slider may be past a lower max level set since
+                captureLevel = std::min(captureLevel, (int) renderer.GetCascadeImages().size() - 1);
+                image = &renderer.GetCascadeImages()[captureLevel];
+                extent = cascadeExtent;
+                name = std::format("cascade{}", captureLevel);
+            }
+        }
 
-            fillTextureFloat4Pipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &fillTextureFloat4PushConstant);
+        auto encoding = (FrameReadback::Encoding) captureEncoding;
+        readback.RecordCopy(cmd, *image, extent, format,
+                            std::format("capture_{:06}_{}.{}", frameNumber, name, FrameReadback::GetExtension(encoding)),
+                            encoding);
+    }
 
-            fillTextureFloat4Pipeline.Dispatch(cmd, WINDOW_WIDTH / 8, WINDOW_HEIGHT / 8, 1);
+    // Loading a scene resets the SDF so only the scene is left, strokes can be drawn over it afterwards
+    void DrawSceneWindow() {
+        ImGui::Begin("Scene");
+        if (ImGui::Button("Load demo scene")) {
+            renderer.SetScene(Scene::CreateDemo());
+            resetSDF = true;
         }
 
-        if (raymarchImageLayout != VK_IMAGE_LAYOUT_GENERAL) {
-            for (auto &raymarchImage: raymarchImages) {
-                TransitionImage(cmd, raymarchImage.image, raymarchImageLayout, VK_IMAGE_LAYOUT_GENERAL);
+        ImGui::InputText("##scenepath", scenePath, sizeof(scenePath));
+        ImGui::SameLine();
+        if (ImGui::Button("Load scene")) {
+            Scene scene;
+            if (scene.Load(scenePath)) {
+                renderer.SetScene(scene);
+                resetSDF = true;
+                sceneMessage.clear();
+            } else {
+                sceneMessage = std::string("Could not load ") + scenePath + ", see the console";
             }
-            raymarchImageLayout = VK_IMAGE_LAYOUT_GENERAL;
         }
 
-        if (outputGIImageLayout != VK_IMAGE_LAYOUT_GENERAL) {
-            TransitionImage(cmd, globalIlluminationImage.image, outputGIImageLayout, VK_IMAGE_LAYOUT_GENERAL);
-            outputGIImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        if (ImGui::Button("Clear scene")) {
+            renderer.ClearScene();
+            resetSDF = true;
         }
 
-        // Raymarch
-        RaymarchPushConstant raymarchPushConstant{};
-        raymarchPushConstant.radianceCascadeSettings = radianceCascadeSettings;
+        bool raycastSegments = renderer.GetTraceMode() == RadianceCascadeRenderer::RAYCAST_SEGMENTS;
+        if (ImGui::Checkbox("Ray cast scene outlines", &raycastSegments)) {
+            renderer.SetTraceMode(raycastSegments ? RadianceCascadeRenderer::RAYCAST_SEGMENTS
+                                                  : RadianceCascadeRenderer::RAYMARCH_SDF);
+        }
+        ImGui::TextWrapped("Exact hits against the scene without the SDF, brush strokes are not seen");
+        if (!sceneMessage.empty()) {
+            ImGui::TextWrapped("%s", sceneMessage.c_str());
+        }
+        ImGui::End();
+    }
 
-        // size of cascades
-        // first we need to know the resolution the max level cascade
-        uint32_t maxLevelCascadeProbeResolution = 1 << radianceCascadeSettings.maxLevel;
-        uint32_t aspectRatio = std::ceil((float) WINDOW_WIDTH / WINDOW_HEIGHT);
-        uint32_t horizontalProbeCountAtMaxLevel = aspectRatio * radianceCascadeSettings.verticalProbeCountAtMaxLevel;
-        uint32_t cascadeWidth = horizontalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
-        uint32_t cascadeHeight = radianceCascadeSettings.verticalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+    void ApplySettings() {
+        // The governor only ever lowers the quality below these settings, so they are the worst case either way. The
+        // current images stay alive until the frames in flight are done, the new ones have to fit next to them.
+        VkDeviceSize predictedBytes = renderer.PredictImageMemoryBytes(GetScaledExtent(), newRadianceCascadeSettings);
+        VkDeviceSize availableBytes = GetAvailableDeviceLocalBytes();
+        if (predictedBytes > availableBytes) {
+            settingsRefusedMessage = std::format("Settings refused: they need {:.1f} MiB but only {:.1f} MiB fit in "
+                                                 "the memory budget", predictedBytes / MIB, availableBytes / MIB);
+            return;
+        }
+        settingsRefusedMessage.clear();
 
-        for (int i = 0; i < radianceCascadeSettings.maxLevel; i++) {
-            // CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT); // No need, can be done in parallel
-            raymarchPushConstant.currentLevel = i;
-            raymarchPipelines[i].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
-            raymarchPipelines[i].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &raymarchPushConstant);
-            raymarchPipelines[i].Dispatch(cmd, cascadeWidth / 8, cascadeHeight / 8, 1);
+        if (governorEnabled) {
+            qualityGovernor.SetBase(newRadianceCascadeSettings);
+            ApplyGovernorQuality();
+            return;
         }
 
-        MergeCascadesPushConstant mergeCascadesPushConstant{};
-        mergeCascadesPushConstant.radianceCascadeSettings = radianceCascadeSettings;
+        renderer.SetConfiguration(GetScaledExtent(), newRadianceCascadeSettings);
+    }
+
+    void ApplyGovernorQuality() {
+        const auto &quality = qualityGovernor.GetQuality();
+        renderScale = governorEnabled ? quality.renderScale : 1.0f;
+
+        renderer.SetConfiguration(GetScaledExtent(), quality.settings);
+    }
+
+    // Budget left in the device local heaps, the renderer images live there
+    VkDeviceSize GetAvailableDeviceLocalBytes() const {
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
 
-        for (int i = radianceCascadeSettings.maxLevel - 2; i >= 0; i--) {
-            CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            mergeCascadesPushConstant.outputLevel = i;
-            mergeCascadesPipelines[i].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
-            mergeCascadesPipelines[i].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &mergeCascadesPushConstant);
-            mergeCascadesPipelines[i].Dispatch(cmd, cascadeWidth / 8, cascadeHeight / 8, 1);
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(allocator, budgets);
+
+        VkDeviceSize availableBytes = 0;
+        for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+            if ((memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+                budgets[i].budget > budgets[i].usage) {
+                availableBytes += budgets[i].budget - budgets[i].usage;
+            }
         }
 
-        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        buildGITexturePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+        return availableBytes;
+    }
+
+    void DrawMemoryWindow() {
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(allocator, budgets);
+
+        VmaTotalStatistics statistics;
+        vmaCalculateStatistics(allocator, &statistics);
 
-        buildGITexturePipeline.Dispatch(cmd, cascadeWidth / 16, cascadeHeight / 16, 1);
+        ImGui::Begin("Memory");
+        for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+            bool deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            ImGui::Text("Heap %u%s: %.1f / %.1f MiB", i, deviceLocal ? " (device local)" : "",
+                        budgets[i].usage / MIB, budgets[i].budget / MIB);
+        }
 
-        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        ImGui::Separator();
+        ImGui::Text("VMA: %u allocations, %.1f MiB in %u blocks of %.1f MiB",
+                    statistics.total.statistics.allocationCount,
+                    statistics.total.statistics.allocationBytes / MIB, statistics.total.statistics.blockCount,
+                    statistics.total.statistics.blockBytes / MIB);
 
-        finalPassPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+        ImGui::Separator();
+        for (const auto &usage: renderer.GetMemoryUsage()) {
+            ImGui::Text("%s: %.2f MiB", usage.role.c_str(), usage.bytes / MIB);
+        }
+        ImGui::Text("Total: %.2f MiB", renderer.GetImageMemoryBytes() / MIB);
 
-        finalPassPipeline.Dispatch(cmd, WINDOW_WIDTH / 8, WINDOW_HEIGHT / 8, 1);
+        if (ImGui::Button("Dump memory JSON")) {
+            DumpMemoryJson("memory.json");
+        }
+        ImGui::End();
+    }
+
+    // Per role usage, heap budgets and the detailed VMA statistics in one file
+    void DumpMemoryJson(const std::string &path) const {
+        const VkPhysicalDeviceMemoryProperties *memoryProperties;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(allocator, budgets);
+
+        std::ofstream file(path);
+        if (!file) {
+            std::print("Failed to open {}\n", path);
+            return;
+        }
+
+        file << "{\n  \"roles\": [";
+        auto memoryUsage = renderer.GetMemoryUsage();
+        for (size_t i = 0; i < memoryUsage.size(); i++) {
+            file << std::format("{}\n    {{\"role\": \"{}\", \"bytes\": {}}}", i == 0 ? "" : ",",
+                                memoryUsage[i].role, memoryUsage[i].bytes);
+        }
+
+        file << "\n  ],\n  \"heaps\": [";
+        for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+            file << std::format("{}\n    {{\"index\": {}, \"device_local\": {}, \"size\": {}, \"budget\": {}, "
+                                "\"usage\": {}, \"block_bytes\": {}, \"allocation_bytes\": {}}}",
+                                i == 0 ? "" : ",", i,
+                                (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+                                memoryProperties->memoryHeaps[i].size, budgets[i].budget, budgets[i].usage,
+                                budgets[i].statistics.blockBytes, budgets[i].statistics.allocationBytes);
+        }
+
+        char *vmaStats;
+        vmaBuildStatsString(allocator, &vmaStats, VK_TRUE);
+        file << "\n  ],\n  \"vma\": " << vmaStats << "\n}\n";
+        vmaFreeStatsString(allocator, vmaStats);
+
+        std::print("Memory statistics written to {}\n", path);
+    }
+
+    void ComputeQueueCommands(VkCommandBuffer cmd, VkImage swapchainImage, VkImageView swapchainImageView,
+                              VkExtent2D swapchainExtent) override {
+        gpuTimer.BeginFrame(cmd, frameNumber % MAX_FRAMES_IN_FLIGHT);
+
+        if (volumeMode) {
+            // The volume pass overwrites the whole display image, its content can be discarded
+            TransitionImage(cmd, renderer.GetDisplayImage().image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            volumeRenderer.RecordFrameCommands(cmd, renderer.GetDisplayImage(), renderer.GetRenderExtent(),
+                                               volumeCamera, gpuTimer);
+        } else {
+            renderer.RecordFrameCommands(cmd, brushSegments, resetSDF, gpuTimer);
+        }
+        RecordCapture(cmd);
+        videoCapture.RecordFrame(cmd, renderer.GetDisplayImage());
+    }
+
+    // The input that arrived while the frame was being recorded still makes it into the frame
+    void PreSubmit() override {
+        ConsumePointerEvents();
+        renderer.LatchBrushSegments(brushSegments);
+
+        // Whatever did not fit this frame is drawn by the next ones
+        brushSegments.erase(brushSegments.begin(),
+                            brushSegments.begin() + std::min<size_t>(brushSegments.size(), MAX_BRUSH_SEGMENTS));
     }
 
     void GraphicsQueueCommands(VkCommandBuffer cmd, VkImage swapchainImage, VkImageView swapchainImageView,
                                VkExtent2D swapchainExtent) override {
-        // size of cascades
-        // first we need to know the resolution the max level cascade
-        // uint32_t maxLevelCascadeProbeResolution = 1 << radianceCascadeSettings.maxLevel;
-        // uint32_t aspectRatio = std::ceil((float) WINDOW_WIDTH / WINDOW_HEIGHT);
-        // uint32_t horizontalProbeCountAtMaxLevel = aspectRatio * radianceCascadeSettings.verticalProbeCountAtMaxLevel;
-        // uint32_t cascadeWidth = horizontalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
-        // uint32_t cascadeHeight = radianceCascadeSettings.verticalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+        VkExtent2D renderExtent = renderer.GetRenderExtent();
 
         VkImageBlit region{};
         region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         region.dstSubresource.layerCount = 1;
         region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         region.srcSubresource.layerCount = 1;
-        region.srcOffsets[1].x = WINDOW_WIDTH;
-        region.srcOffsets[1].y = WINDOW_HEIGHT;
+        region.srcOffsets[1].x = renderExtent.width;
+        region.srcOffsets[1].y = renderExtent.height;
         region.srcOffsets[1].z = 1;
         region.dstOffsets[1].x = swapchainExtent.width;
         region.dstOffsets[1].y = swapchainExtent.height;
         region.dstOffsets[1].z = 1;
 
-        vkCmdBlitImage(cmd, displayImage.image, VK_IMAGE_LAYOUT_GENERAL, swapchainImage, VK_IMAGE_LAYOUT_GENERAL, 1,
-                       &region, VK_FILTER_LINEAR);
+        vkCmdBlitImage(cmd, renderer.GetDisplayImage().image, VK_IMAGE_LAYOUT_GENERAL, swapchainImage,
+                       VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_LINEAR);
     }
 
     void Cleanup() override {
-        fillTextureFloat4Pipeline.Destroy();
-        drawToSDFTexturePipeline.Destroy();
-        finalPassPipeline.Destroy();
-        for (auto &raymarchPipeline: raymarchPipelines) {
-            raymarchPipeline.Destroy();
-        }
-        for (auto &mergeCascadesPipeline: mergeCascadesPipelines) {
-            mergeCascadesPipeline.Destroy();
-        }
-        buildGITexturePipeline.Destroy();
-        // ImGui_ImplVulkan_RemoveTexture(imguiImageDescriptorSet);
-        // vkDestroySampler(device, imguiSampler, nullptr);
-        for (auto &raymarchImage: raymarchImages) {
-            if (raymarchImage.Initialized()) {
-                DestroyImage(device, allocator, raymarchImage);
-            }
-        }
-        if (globalIlluminationImage.Initialized()) {
-            DestroyImage(device, allocator, globalIlluminationImage);
-        }
-        vkDestroySampler(device, linearSampler, nullptr);
-        DestroyImage(device, allocator, displayImage);
-        DestroyImage(device, allocator, sdfImage);
+        videoCapture.Destroy();
+        readback.Destroy();
+        gpuTimer.Destroy();
+        volumeRenderer.Destroy();
+        renderer.Destroy();
     }
 
 private:
-    Image sdfImage{};
-    Image displayImage{};
-    std::vector<Image> raymarchImages{};
-    Image globalIlluminationImage{};
-    VkSampler linearSampler{};
-    VkImageLayout raymarchImageLayout;
-    VkImageLayout outputGIImageLayout;
-    VkSampler imguiSampler{};
-    VkDescriptorSet imguiImageDescriptorSet{};
-    Pipeline drawToSDFTexturePipeline{};
-    Pipeline fillTextureFloat4Pipeline{};
-    Pipeline finalPassPipeline{};
-    std::vector<Pipeline> raymarchPipelines{};
-    std::vector<Pipeline> mergeCascadesPipelines{};
-    Pipeline buildGITexturePipeline{};
-    bool isLeftMouseButtonPressed = false;
+    // Swapchain extent, the renderer extent is scaled from it
+    VkExtent2D windowExtent{};
+    float renderScale = 1.0f;
+    uint32_t frameNumber = 0;
+    RadianceCascadeRenderer renderer{};
+    GpuTimer gpuTimer{};
+    QualityGovernor qualityGovernor{};
+    bool governorEnabled = false;
+    // Filled by the GLFW callbacks, drained once per frame
+    SpscQueue<PointerEvent, 4096> pointerEvents{};
+    bool isDrawing = false;
+    float lastPointerX = 0.0f;
+    float lastPointerY = 0.0f;
+    std::vector<RadianceCascadeRenderer::BrushSegment> brushSegments{};
     bool resetSDF = false;
+    std::string settingsRefusedMessage;
+    char scenePath[256] = "scene.txt";
+    std::string sceneMessage;
+
+    enum CaptureSource {
+        CAPTURE_DISPLAY,
+        CAPTURE_GI,
+        CAPTURE_CASCADE
+    };
 
-    RadianceCascadeSettings radianceCascadeSettings{
-        .maxLevel = 8,
+    FrameReadback readback{};
+    int captureSource = CAPTURE_DISPLAY;
+    int captureLevel = 0;
+    int captureEncoding = FrameReadback::PNG;
+    bool captureRequested = false;
+    bool captureEveryFrame = false;
+
+    VideoCapture videoCapture{};
+    char videoTarget[256] = "capture.y4m";
+    int videoFormat = VideoCapture::Y4M;
+    int videoFramesPerSecond = 60;
+    int videoLagPolicy = VideoCapture::DROP;
+
+    static constexpr float MIB = 1024.0f * 1024.0f;
+
+    // Voxels on each side of the SDF volume
+    static constexpr uint32_t VOLUME_RESOLUTION = 64;
+    VolumeCascadeRenderer volumeRenderer{};
+    bool volumeMode = false;
+    VolumeCascadeRenderer::Camera volumeCamera{};
+    RadianceCascadeSettings newVolumeSettings{
+        .maxLevel = 4,
         .verticalProbeCountAtMaxLevel = 4,
-        .radius = .01f,
-        .radiusMultiplier = 1.5f,
-        .raymarchStepSize = 0.01f,
-        .attenuation = 100.f
+        .radius = .03f,
+        .radiusMultiplier = 2.5f,
+        .raymarchStepSize = 0.002f,
+        .attenuation = 0.0f
     };
+
     RadianceCascadeSettings newRadianceCascadeSettings{
         .maxLevel = 8,
         .verticalProbeCountAtMaxLevel = 4,
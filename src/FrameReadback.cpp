@@ -0,0 +1,172 @@
+#include <FrameReadback.h>
+#include <ImageEncoding.h>
+
+#include <format>
+
+void FrameReadback::Init(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight, uint32_t slotCount,
+                         uint32_t encoderThreads) {
+    m_device = device;
+    m_allocator = allocator;
+    m_framesInFlight = framesInFlight;
+    m_slots = std::vector<Slot>(slotCount);
+    m_encoders = std::make_unique<ThreadPool>(encoderThreads);
+}
+
+void FrameReadback::Destroy() {
+    // Every copy is complete once the device is idle
+    m_frameNumber += m_framesInFlight;
+    BeginFrame();
+    m_encoders->Wait();
+    m_encoders.reset();
+
+    for (auto &slot: m_slots) {
+        if (slot.buffer.Initialized()) {
+            DestroyBuffer(m_allocator, slot.buffer);
+        }
+    }
+    m_slots.clear();
+}
+
+void FrameReadback::BeginFrame() {
+    m_frameNumber++;
+
+    for (auto &slot: m_slots) {
+        if (slot.state.load(std::memory_order_acquire) != COPYING || slot.readyFrame > m_frameNumber) {
+            continue;
+        }
+
+        VK_CHECK(vmaInvalidateAllocation(m_allocator, slot.buffer.memory, 0, VK_WHOLE_SIZE));
+        slot.state.store(ENCODING, std::memory_order_relaxed);
+        m_encoders->Submit([this, &slot] { Encode(slot); });
+    }
+}
+
+bool FrameReadback::RecordCopy(VkCommandBuffer cmd, const Image &image, VkExtent2D extent, VkFormat format,
+                               const std::filesystem::path &path, Encoding encoding) {
+    if (format != VK_FORMAT_R32G32B32A32_SFLOAT && format != VK_FORMAT_R16G16B16A16_SFLOAT) {
+        throw std::runtime_error(std::format("Unsupported readback format: {}", string_VkFormat(format)));
+    }
+
+    Slot *freeSlot = nullptr;
+    for (auto &slot: m_slots) {
+        if (slot.state.load(std::memory_order_acquire) == FREE) {
+            freeSlot = &slot;
+            break;
+        }
+    }
+    if (freeSlot == nullptr) {
+        m_dropped++;
+        return false;
+    }
+    Slot &slot = *freeSlot;
+
+    VkDeviceSize texelSize = format == VK_FORMAT_R32G32B32A32_SFLOAT ? 4 * sizeof(float) : 4 * sizeof(uint16_t);
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * texelSize;
+    if (slot.capacity < size) {
+        // A free slot is neither read by the GPU nor by an encoder
+        if (slot.buffer.Initialized()) {
+            DestroyBuffer(m_allocator, slot.buffer);
+        }
+        slot.buffer = CreateBuffer(m_allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        slot.capacity = size;
+    }
+
+    // Compute writes -> transfer read
+    VkMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {extent.width, extent.height, 1};
+
+    vkCmdCopyImageToBuffer(cmd, image.image, VK_IMAGE_LAYOUT_GENERAL, slot.buffer.buffer, 1, &region);
+
+    // Transfer write -> host read, made visible by the fence the frame loop waits on
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    slot.readyFrame = m_frameNumber + m_framesInFlight;
+    slot.extent = extent;
+    slot.format = format;
+    slot.path = path;
+    slot.encoding = encoding;
+    slot.state.store(COPYING, std::memory_order_relaxed);
+
+    return true;
+}
+
+// Runs on an encoder thread
+void FrameReadback::Encode(Slot &slot) {
+    uint32_t width = slot.extent.width;
+    uint32_t height = slot.extent.height;
+
+    const float *texels = static_cast<const float *>(slot.buffer.mapped);
+    std::vector<float> converted;
+    if (slot.format == VK_FORMAT_R16G16B16A16_SFLOAT) {
+        const auto *halves = static_cast<const uint16_t *>(slot.buffer.mapped);
+        converted.resize(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < converted.size(); i++) {
+            converted[i] = HalfToFloat(halves[i]);
+        }
+        texels = converted.data();
+    }
+
+    bool written = false;
+    switch (slot.encoding) {
+        case PNG:
+            written = WritePng(slot.path, width, height, texels);
+            break;
+        case EXR:
+            written = WriteExr(slot.path, width, height, texels);
+            break;
+        case RAW:
+            written = WriteRaw(slot.path, width, height, texels);
+            break;
+    }
+
+    if (written) {
+        m_written++;
+    } else {
+        std::print("Failed to write {}\n", slot.path.string());
+        m_failed++;
+    }
+
+    slot.state.store(FREE, std::memory_order_release);
+}
+
+const char *FrameReadback::GetExtension(Encoding encoding) {
+    switch (encoding) {
+        case PNG:
+            return "png";
+        case EXR:
+            return "exr";
+        case RAW:
+            return "raw";
+    }
+    return "";
+}
+
+uint32_t FrameReadback::GetPendingCount() const {
+    uint32_t pending = 0;
+    for (const auto &slot: m_slots) {
+        pending += slot.state.load(std::memory_order_relaxed) != FREE;
+    }
+    return pending;
+}
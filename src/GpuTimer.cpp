@@ -0,0 +1,111 @@
+#include <GpuTimer.h>
+
+#include <algorithm>
+
+void GpuTimer::Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex,
+                    uint32_t framesInFlight, uint32_t maxPasses) {
+    m_device = device;
+    m_maxPasses = maxPasses;
+    m_passNames.resize(framesInFlight);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    if (!m_supported) {
+        std::print("Timestamp queries are not supported on this queue, GPU timings are disabled\n");
+        return;
+    }
+
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo{};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = framesInFlight * maxPasses * 2;
+
+    VK_CHECK(vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &m_queryPool));
+}
+
+void GpuTimer::Destroy() {
+    if (m_queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+}
+
+void GpuTimer::Resolve(uint32_t frameIndex) {
+    if (!m_supported) {
+        return;
+    }
+
+    uint32_t firstQuery = frameIndex * m_maxPasses * 2;
+    auto &names = m_passNames[frameIndex];
+
+    if (names.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> timestamps(names.size() * 2);
+    VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, firstQuery, timestamps.size(),
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        m_passTimings.clear();
+        uint64_t frameBegin = UINT64_MAX;
+        uint64_t frameEnd = 0;
+        for (size_t i = 0; i < names.size(); i++) {
+            uint64_t begin = timestamps[i * 2] & m_timestampMask;
+            uint64_t end = timestamps[i * 2 + 1] & m_timestampMask;
+            frameBegin = std::min(frameBegin, begin);
+            frameEnd = std::max(frameEnd, end);
+            m_passTimings.push_back({names[i], (end - begin) * m_timestampPeriod / 1e6});
+        }
+        m_frameMilliseconds = (frameEnd - frameBegin) * m_timestampPeriod / 1e6;
+    }
+    names.clear();
+}
+
+void GpuTimer::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+    if (!m_supported) {
+        return;
+    }
+
+    Resolve(frameIndex);
+
+    m_currentFrameIndex = frameIndex;
+    vkCmdResetQueryPool(cmd, m_queryPool, frameIndex * m_maxPasses * 2, m_maxPasses * 2);
+}
+
+void GpuTimer::BeginPass(VkCommandBuffer cmd, const std::string &name) {
+    if (!m_supported) {
+        return;
+    }
+
+    auto &names = m_passNames[m_currentFrameIndex];
+    if (names.size() >= m_maxPasses) {
+        throw std::runtime_error("GpuTimer: too many passes in a single frame");
+    }
+
+    uint32_t query = (m_currentFrameIndex * m_maxPasses + names.size()) * 2;
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, query);
+    names.push_back(name);
+}
+
+void GpuTimer::EndPass(VkCommandBuffer cmd) {
+    if (!m_supported) {
+        return;
+    }
+
+    auto &names = m_passNames[m_currentFrameIndex];
+    uint32_t query = (m_currentFrameIndex * m_maxPasses + names.size() - 1) * 2 + 1;
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, query);
+}
@@ -0,0 +1,263 @@
+#include <HeadlessContext.h>
+
+#include <cstring>
+
+bool HeadlessContext::Init(bool preferCPU) {
+    vkb::InstanceBuilder instanceBuilder;
+    auto instanceBuilderResult = instanceBuilder.set_app_name("Radiance Cascades headless")
+#ifndef NDEBUG
+            .enable_validation_layers()
+            .use_default_debug_messenger()
+#endif
+            .set_headless(true)
+            .require_api_version(1, 3, 0)
+            .build();
+
+    if (!instanceBuilderResult) {
+        std::print("Failed to create Vulkan instance. Error: {}\n", instanceBuilderResult.error().message());
+        return false;
+    }
+
+    m_instance = instanceBuilderResult.value();
+
+    // Same requirements as the windowed app
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13Features.synchronization2 = VK_TRUE;
+    vulkan13Features.dynamicRendering = VK_TRUE;
+    VkPhysicalDeviceVulkan11Features vulkan11Features{};
+    vulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    vulkan11Features.storagePushConstant16 = VK_TRUE;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.storagePushConstant8 = VK_TRUE;
+    vulkan12Features.shaderInt8 = VK_TRUE;
+    vulkan12Features.shaderFloat16 = VK_TRUE;
+    VkPhysicalDeviceFeatures features{};
+    features.shaderInt16 = VK_TRUE;
+
+    vkb::PhysicalDeviceSelector physicalDeviceSelector{m_instance};
+    auto physicalDeviceSelectorResult = physicalDeviceSelector.set_minimum_version(1, 3)
+            .prefer_gpu_device_type(preferCPU ? vkb::PreferredDeviceType::cpu : vkb::PreferredDeviceType::discrete)
+            .set_required_features_13(vulkan13Features)
+            .set_required_features_12(vulkan12Features)
+            .set_required_features_11(vulkan11Features)
+            .set_required_features(features)
+            .select();
+
+    if (!physicalDeviceSelectorResult) {
+        std::print("Failed to select Vulkan physical device. Error: {}\n",
+                   physicalDeviceSelectorResult.error().message());
+        return false;
+    }
+
+    bool memoryBudgetSupported = physicalDeviceSelectorResult.value().enable_extension_if_present(
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    vkb::DeviceBuilder deviceBuilder{physicalDeviceSelectorResult.value()};
+    auto deviceBuilderResult = deviceBuilder.build();
+    if (!deviceBuilderResult) {
+        std::print("Failed to create Vulkan device. Error: {}\n", deviceBuilderResult.error().message());
+        return false;
+    }
+    m_device = deviceBuilderResult.value();
+
+    auto computeQueueResult = m_device.get_queue(vkb::QueueType::compute);
+    if (!computeQueueResult) {
+        std::print("Failed to get compute queue. Error: {}\n", computeQueueResult.error().message());
+        return false;
+    }
+    m_queue = computeQueueResult.value();
+    m_queueFamilyIndex = m_device.get_queue_index(vkb::QueueType::compute).value();
+
+    VmaAllocatorCreateInfo allocatorInfo{};
+    allocatorInfo.physicalDevice = m_device.physical_device.physical_device;
+    allocatorInfo.device = m_device.device;
+    allocatorInfo.instance = m_instance.instance;
+    allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+    if (memoryBudgetSupported) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
+
+    VK_CHECK(vmaCreateAllocator(&allocatorInfo, &m_allocator));
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo{};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VK_CHECK(vkCreateCommandPool(m_device.device, &commandPoolCreateInfo, nullptr, &m_commandPool));
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VK_CHECK(vkAllocateCommandBuffers(m_device.device, &allocInfo, &m_commandBuffer));
+
+    VkFenceCreateInfo fenceCreateInfo{};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VK_CHECK(vkCreateFence(m_device.device, &fenceCreateInfo, nullptr, &m_fence));
+
+    std::print("Using {}\n", m_device.physical_device.name);
+
+    return true;
+}
+
+void HeadlessContext::Destroy() {
+    if (m_device.device == VK_NULL_HANDLE) {
+        vkb::destroy_instance(m_instance);
+        return;
+    }
+
+    vkDeviceWaitIdle(m_device.device);
+    vkDestroyFence(m_device.device, m_fence, nullptr);
+    vkDestroyCommandPool(m_device.device, m_commandPool, nullptr);
+    vmaDestroyAllocator(m_allocator);
+    vkb::destroy_device(m_device);
+    vkb::destroy_instance(m_instance);
+    m_device = {};
+    m_instance = {};
+}
+
+void HeadlessContext::Submit(const std::function<void(VkCommandBuffer)> &record) {
+    VK_CHECK(vkResetCommandBuffer(m_commandBuffer, 0));
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK(vkBeginCommandBuffer(m_commandBuffer, &beginInfo));
+    record(m_commandBuffer);
+    VK_CHECK(vkEndCommandBuffer(m_commandBuffer));
+
+    VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+    commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBufferSubmitInfo.commandBuffer = m_commandBuffer;
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &commandBufferSubmitInfo;
+
+    VK_CHECK(vkQueueSubmit2(m_queue, 1, &submitInfo, m_fence));
+    VK_CHECK(vkWaitForFences(m_device.device, 1, &m_fence, VK_TRUE, UINT64_MAX));
+    VK_CHECK(vkResetFences(m_device.device, 1, &m_fence));
+}
+
+std::vector<float> HeadlessContext::ReadImage(const Image &image, VkExtent2D extent) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4 * sizeof(float);
+
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VkBuffer buffer;
+    VmaAllocation allocation;
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBuffer(m_allocator, &bufferCreateInfo, &allocCreateInfo, &buffer, &allocation,
+                             &allocationInfo));
+
+    Submit([&](VkCommandBuffer cmd) {
+        // Compute writes -> transfer read
+        VkMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+
+        VkDependencyInfo depInfo{};
+        depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        depInfo.memoryBarrierCount = 1;
+        depInfo.pMemoryBarriers = &barrier;
+
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+
+        vkCmdCopyImageToBuffer(cmd, image.image, VK_IMAGE_LAYOUT_GENERAL, buffer, 1, &region);
+
+        // Transfer write -> host read
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+    });
+
+    VK_CHECK(vmaInvalidateAllocation(m_allocator, allocation, 0, VK_WHOLE_SIZE));
+
+    std::vector<float> texels(static_cast<size_t>(extent.width) * extent.height * 4);
+    std::memcpy(texels.data(), allocationInfo.pMappedData, size);
+
+    vmaDestroyBuffer(m_allocator, buffer, allocation);
+
+    return texels;
+}
+
+void HeadlessContext::WriteImage(const Image &image, VkExtent2D extent, const float *texels) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4 * sizeof(float);
+
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VkBuffer buffer;
+    VmaAllocation allocation;
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBuffer(m_allocator, &bufferCreateInfo, &allocCreateInfo, &buffer, &allocation,
+                             &allocationInfo));
+
+    std::memcpy(allocationInfo.pMappedData, texels, size);
+    VK_CHECK(vmaFlushAllocation(m_allocator, allocation, 0, VK_WHOLE_SIZE));
+
+    Submit([&](VkCommandBuffer cmd) {
+        // Previous accesses to the image -> transfer write
+        VkMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+        VkDependencyInfo depInfo{};
+        depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        depInfo.memoryBarrierCount = 1;
+        depInfo.pMemoryBarriers = &barrier;
+
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+
+        vkCmdCopyBufferToImage(cmd, buffer, image.image, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+        // Transfer write -> any later access
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+    });
+
+    vmaDestroyBuffer(m_allocator, buffer, allocation);
+}
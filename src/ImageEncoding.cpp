@@ -0,0 +1,222 @@
+#include <ImageEncoding.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace {
+    // PNG and zlib store their integers big endian
+    void AppendBigEndian(std::vector<uint8_t> &bytes, uint32_t value) {
+        bytes.push_back(value >> 24);
+        bytes.push_back(value >> 16);
+        bytes.push_back(value >> 8);
+        bytes.push_back(value);
+    }
+
+    // EXR stores its integers little endian
+    template<typename T>
+    void AppendLittleEndian(std::vector<uint8_t> &bytes, T value) {
+        auto raw = std::bit_cast<std::array<uint8_t, sizeof(T)> >(value);
+        if constexpr (std::endian::native == std::endian::big) {
+            std::reverse(raw.begin(), raw.end());
+        }
+        bytes.insert(bytes.end(), raw.begin(), raw.end());
+    }
+
+    uint32_t Crc32(const uint8_t *data, size_t size) {
+        static const auto TABLE = [] {
+            std::array<uint32_t, 256> table{};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+            }
+            return table;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            crc = TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void AppendPngChunk(std::vector<uint8_t> &png, const char type[4], const std::vector<uint8_t> &data) {
+        AppendBigEndian(png, data.size());
+        size_t typeOffset = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        AppendBigEndian(png, Crc32(png.data() + typeOffset, png.size() - typeOffset));
+    }
+
+    uint8_t LinearToSrgb8(float value) {
+        value = std::clamp(value, 0.0f, 1.0f);
+        float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return (uint8_t) std::lround(encoded * 255.0f);
+    }
+
+    bool WriteFile(const std::filesystem::path &path, const void *data, size_t size) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::print("Failed to open {}\n", path.string());
+            return false;
+        }
+
+        file.write(static_cast<const char *>(data), size);
+        return file.good();
+    }
+}
+
+// Stored deflate blocks only: readbacks are written often and compressing them would cost more than the disk space
+bool WritePng(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels) {
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve(static_cast<size_t>(width * 3 + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        // No filter
+        scanlines.push_back(0);
+        for (uint32_t x = 0; x < width; x++) {
+            const float *texel = texels + (static_cast<size_t>(y) * width + x) * 4;
+            scanlines.push_back(LinearToSrgb8(texel[0]));
+            scanlines.push_back(LinearToSrgb8(texel[1]));
+            scanlines.push_back(LinearToSrgb8(texel[2]));
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    constexpr size_t MAX_STORED_BLOCK = 65535;
+    for (size_t offset = 0; offset < scanlines.size() || offset == 0; offset += MAX_STORED_BLOCK) {
+        uint16_t length = std::min(MAX_STORED_BLOCK, scanlines.size() - offset);
+        bool last = offset + length == scanlines.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(length & 0xFF);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xFF);
+        zlib.push_back((~length >> 8) & 0xFF);
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+        if (last) {
+            break;
+        }
+    }
+
+    uint32_t adlerA = 1, adlerB = 0;
+    for (uint8_t byte: scanlines) {
+        adlerA = (adlerA + byte) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    AppendBigEndian(zlib, adlerB << 16 | adlerA);
+
+    std::vector<uint8_t> header;
+    AppendBigEndian(header, width);
+    AppendBigEndian(header, height);
+    // 8 bits per channel, truecolor, default compression, filter and no interlacing
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    AppendPngChunk(png, "IHDR", header);
+    AppendPngChunk(png, "IDAT", zlib);
+    AppendPngChunk(png, "IEND", {});
+
+    return WriteFile(path, png.data(), png.size());
+}
+
+bool WriteExr(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels) {
+    std::vector<uint8_t> exr;
+    AppendLittleEndian<uint32_t>(exr, 20000630);
+    // Version 2, single part scanline file
+    AppendLittleEndian<uint32_t>(exr, 2);
+
+    auto appendAttribute = [&](const std::string &name, const std::string &type, const std::vector<uint8_t> &value) {
+        exr.insert(exr.end(), name.begin(), name.end());
+        exr.push_back(0);
+        exr.insert(exr.end(), type.begin(), type.end());
+        exr.push_back(0);
+        AppendLittleEndian<uint32_t>(exr, value.size());
+        exr.insert(exr.end(), value.begin(), value.end());
+    };
+
+    // Channels are stored in alphabetical order
+    constexpr char CHANNELS[] = {'A', 'B', 'G', 'R'};
+    constexpr uint32_t CHANNEL_INDICES[] = {3, 2, 1, 0};
+    std::vector<uint8_t> channelList;
+    for (char channel: CHANNELS) {
+        channelList.insert(channelList.end(), {(uint8_t) channel, 0});
+        // FLOAT pixel type, not perceptually linear, reserved bytes, no subsampling
+        AppendLittleEndian<uint32_t>(channelList, 2);
+        channelList.insert(channelList.end(), {0, 0, 0, 0});
+        AppendLittleEndian<int32_t>(channelList, 1);
+        AppendLittleEndian<int32_t>(channelList, 1);
+    }
+    channelList.push_back(0);
+
+    std::vector<uint8_t> window;
+    for (int32_t value: {0, 0, (int32_t) width - 1, (int32_t) height - 1}) {
+        AppendLittleEndian(window, value);
+    }
+
+    std::vector<uint8_t> pixelAspectRatio, screenWindowCenter, screenWindowWidth;
+    AppendLittleEndian(pixelAspectRatio, 1.0f);
+    AppendLittleEndian(screenWindowCenter, 0.0f);
+    AppendLittleEndian(screenWindowCenter, 0.0f);
+    AppendLittleEndian(screenWindowWidth, 1.0f);
+
+    appendAttribute("channels", "chlist", channelList);
+    // No compression
+    appendAttribute("compression", "compression", {0});
+    appendAttribute("dataWindow", "box2i", window);
+    appendAttribute("displayWindow", "box2i", window);
+    // Increasing y
+    appendAttribute("lineOrder", "lineOrder", {0});
+    appendAttribute("pixelAspectRatio", "float", pixelAspectRatio);
+    appendAttribute("screenWindowCenter", "v2f", screenWindowCenter);
+    appendAttribute("screenWindowWidth", "float", screenWindowWidth);
+    exr.push_back(0);
+
+    // One scanline per block, each one is its y, its size, then every channel of the row in turn
+    uint32_t blockSize = width * 4 * sizeof(float);
+    uint64_t offset = exr.size() + static_cast<uint64_t>(height) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; y++) {
+        AppendLittleEndian<uint64_t>(exr, offset + static_cast<uint64_t>(y) * (8 + blockSize));
+    }
+
+    exr.reserve(exr.size() + static_cast<size_t>(height) * (8 + blockSize));
+    for (uint32_t y = 0; y < height; y++) {
+        AppendLittleEndian<int32_t>(exr, y);
+        AppendLittleEndian<uint32_t>(exr, blockSize);
+        for (uint32_t channel: CHANNEL_INDICES) {
+            for (uint32_t x = 0; x < width; x++) {
+                AppendLittleEndian(exr, texels[(static_cast<size_t>(y) * width + x) * 4 + channel]);
+            }
+        }
+    }
+
+    return WriteFile(path, exr.data(), exr.size());
+}
+
+bool WriteRaw(const std::filesystem::path &path, uint32_t width, uint32_t height, const float *texels) {
+    return WriteFile(path, texels, static_cast<size_t>(width) * height * 4 * sizeof(float));
+}
+
+float HalfToFloat(uint16_t half) {
+    uint32_t sign = (half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0x1F) {
+        // Infinity and NaN
+        return std::bit_cast<float>(sign | 0x7F800000u | mantissa << 13);
+    }
+    if (exponent == 0) {
+        // Zero and subnormals, exactly representable as a float
+        float value = std::ldexp((float) mantissa, -24);
+        return sign ? -value : value;
+    }
+    return std::bit_cast<float>(sign | (exponent + 112) << 23 | mantissa << 13);
+}
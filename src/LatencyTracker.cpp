@@ -0,0 +1,198 @@
+#include <LatencyTracker.h>
+
+#include <algorithm>
+
+namespace {
+    // Frames after which a present that was never reported is given up on
+    constexpr uint64_t PRESENT_GIVE_UP_FRAMES = 16;
+
+    constexpr uint64_t WAITER_TIMEOUT_NANOSECONDS = 10'000'000;
+}
+
+void LatencyTracker::Init(VkDevice device, bool presentWaitSupported, uint32_t historySize) {
+    m_device = device;
+    m_historySize = historySize;
+    m_presentWaitSupported = presentWaitSupported;
+    if (presentWaitSupported) {
+        m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+        m_presentWaitSupported = m_waitForPresent != nullptr;
+    }
+    if (!m_presentWaitSupported) {
+        std::print("Present wait not supported, latency is measured up to the GPU completion\n");
+    }
+
+    VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+    semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphoreTypeCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo{};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+    VK_CHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &m_completionSemaphore));
+
+    m_waiterExit = false;
+    m_waiter = std::thread([this] { WaiterLoop(); });
+}
+
+void LatencyTracker::Destroy() {
+    m_waiterExit = true;
+    m_waiter.join();
+    vkDestroySemaphore(m_device, m_completionSemaphore, nullptr);
+    m_records.clear();
+}
+
+LatencyTracker::FrameRecord *LatencyTracker::FindRecord(uint64_t frameId) {
+    // Records are kept in frame order and the recent ones are looked up
+    for (auto it = m_records.rbegin(); it != m_records.rend(); ++it) {
+        if (it->id == frameId) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+void LatencyTracker::BeginFrame(uint64_t frameId) {
+    m_currentFrameId = frameId;
+
+    std::lock_guard lock(m_mutex);
+
+    // Completed frames leave in order
+    while (!m_records.empty()) {
+        const FrameRecord &record = m_records.front();
+        bool gpuComplete = record.times[GPU_COMPLETE] != Clock::time_point{};
+        bool presentDone = !m_presentWaitSupported || record.times[PRESENT] != Clock::time_point{} ||
+                           record.presentLost || record.id + PRESENT_GIVE_UP_FRAMES < frameId;
+        if (!gpuComplete || !presentDone) {
+            break;
+        }
+
+        Clock::time_point input = record.times[INPUT];
+        if (input != Clock::time_point{}) {
+            for (uint32_t stage = INPUT + 1; stage < STAGE_COUNT; stage++) {
+                if (record.times[stage] == Clock::time_point{}) {
+                    continue;
+                }
+                auto &history = m_history[stage];
+                history.push_back(std::chrono::duration<double, std::milli>(record.times[stage] - input).count());
+                if (history.size() > m_historySize) {
+                    history.pop_front();
+                }
+            }
+        }
+        m_records.pop_front();
+    }
+
+    FrameRecord record{};
+    record.id = frameId;
+    m_records.push_back(record);
+
+    UpdateStatistics();
+}
+
+void LatencyTracker::UpdateStatistics() {
+    m_statistics.frameCount = m_history[RECORD].size();
+    for (uint32_t stage = INPUT + 1; stage < STAGE_COUNT; stage++) {
+        std::vector<double> sorted(m_history[stage].begin(), m_history[stage].end());
+        if (sorted.empty()) {
+            m_statistics.median[stage] = 0.0;
+            m_statistics.p95[stage] = 0.0;
+            continue;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        m_statistics.median[stage] = sorted[sorted.size() / 2];
+        m_statistics.p95[stage] = sorted[std::min<size_t>(sorted.size() * 95 / 100, sorted.size() - 1)];
+    }
+}
+
+void LatencyTracker::MarkInput(Clock::time_point time) {
+    std::lock_guard lock(m_mutex);
+    FrameRecord *record = FindRecord(m_currentFrameId);
+    if (record != nullptr && (record->times[INPUT] == Clock::time_point{} || time < record->times[INPUT])) {
+        record->times[INPUT] = time;
+    }
+}
+
+void LatencyTracker::Mark(Stage stage) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard lock(m_mutex);
+    FrameRecord *record = FindRecord(m_currentFrameId);
+    if (record != nullptr) {
+        record->times[stage] = now;
+    }
+}
+
+void LatencyTracker::TrackPresent(uint64_t frameId) {
+    std::lock_guard lock(m_mutex);
+    FrameRecord *record = FindRecord(frameId);
+    if (record != nullptr) {
+        record->presentTracked = true;
+    }
+}
+
+void LatencyTracker::PollPresents(VkSwapchainKHR swapchain) {
+    if (!m_presentWaitSupported) {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    for (auto &record: m_records) {
+        if (!record.presentTracked || record.presentLost || record.times[PRESENT] != Clock::time_point{}) {
+            continue;
+        }
+
+        VkResult result = m_waitForPresent(m_device, swapchain, record.id + 1, 0);
+        if (result == VK_TIMEOUT) {
+            // Presents complete in order, the later ones are not done either
+            break;
+        }
+        if (result == VK_SUCCESS) {
+            record.times[PRESENT] = Clock::now();
+        } else {
+            // Out of date or surface lost, this present will never be reported
+            record.presentLost = true;
+        }
+    }
+}
+
+void LatencyTracker::ForgetPresents() {
+    std::lock_guard lock(m_mutex);
+    for (auto &record: m_records) {
+        if (record.presentTracked && record.times[PRESENT] == Clock::time_point{}) {
+            record.presentLost = true;
+        }
+    }
+}
+
+void LatencyTracker::WaiterLoop() {
+    uint64_t waitValue = 1;
+
+    while (!m_waiterExit) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_completionSemaphore;
+        waitInfo.pValues = &waitValue;
+
+        VkResult result = vkWaitSemaphores(m_device, &waitInfo, WAITER_TIMEOUT_NANOSECONDS);
+        if (result == VK_TIMEOUT) {
+            continue;
+        }
+        VK_CHECK(result);
+
+        Clock::time_point now = Clock::now();
+        uint64_t value;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_completionSemaphore, &value));
+
+        // Every frame up to value is complete, the ones signaled while this thread was busy get a late time
+        std::lock_guard lock(m_mutex);
+        for (; waitValue <= value; waitValue++) {
+            FrameRecord *record = FindRecord(waitValue - 1);
+            if (record != nullptr) {
+                record->times[GPU_COMPLETE] = now;
+            }
+        }
+    }
+}
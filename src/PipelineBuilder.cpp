@@ -5,30 +5,32 @@
 #include <Common.h>
 #include <PipelineBuilder.h>
 
+#include <algorithm>
 #include <utility>
 
 Pipeline::Pipeline() = default;
 
-void Pipeline::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) {
+void Pipeline::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, uint32_t copy) {
     if (!m_valid) {
         throw std::runtime_error("Pipeline not valid");
     }
     vkCmdBindPipeline(cmd, bindPoint, m_pipeline);
 
-    for (auto &[key, descriptorSet]: m_descriptorSets) {
+    for (auto &[key, descriptorSet]: m_descriptorSets[copy]) {
         vkCmdBindDescriptorSets(cmd, bindPoint, m_layout, key, 1, &descriptorSet, 0, nullptr);
     }
 }
 
 void Pipeline::WriteToDescriptorSet(uint32_t set, uint32_t binding, VkDescriptorType type,
-                                    VkDescriptorImageInfo *imageInfo, VkDescriptorBufferInfo *bufferInfo) {
+                                    VkDescriptorImageInfo *imageInfo, VkDescriptorBufferInfo *bufferInfo,
+                                    uint32_t copy) {
     if (!m_valid) {
         throw std::runtime_error("Pipeline not valid");
     }
 
     VkWriteDescriptorSet writeDescriptorSet{};
     writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescriptorSet.dstSet = m_descriptorSets[set];
+    writeDescriptorSet.dstSet = m_descriptorSets[copy][set];
     writeDescriptorSet.dstBinding = binding;
     writeDescriptorSet.descriptorType = type;
     writeDescriptorSet.descriptorCount = 1;
@@ -53,7 +55,7 @@ void Pipeline::Dispatch(VkCommandBuffer cmd, uint32_t groupCountX, uint32_t grou
 }
 
 Pipeline::Pipeline(PipelineType type, VkDevice device, VkPipeline pipeline, VkPipelineLayout layout,
-                   std::unordered_map<uint32_t, VkDescriptorSet> descriptorSets,
+                   std::vector<std::unordered_map<uint32_t, VkDescriptorSet> > descriptorSets,
                    std::unordered_map<uint32_t, VkDescriptorSetLayout> descriptorSetLayouts,
                    VkDescriptorPool descriptorPool) {
     m_type = type;
@@ -120,6 +122,10 @@ void PipelineBuilder::SetPushConstantSize(VkShaderStageFlags stage, size_t size)
     m_ranges[stage] = range;
 }
 
+void PipelineBuilder::SetDescriptorSetCopies(uint32_t copies) {
+    m_descriptorSetCopies = copies;
+}
+
 Pipeline PipelineBuilder::Build() {
     // Crete descriptor set layout
     std::unordered_map<uint32_t, VkDescriptorSetLayout> descriptorSetLayouts;
@@ -137,7 +143,7 @@ Pipeline PipelineBuilder::Build() {
         for (auto &binding: bindings) {
             VkDescriptorPoolSize poolSize{};
             poolSize.type = binding.descriptorType;
-            poolSize.descriptorCount = bindings.size();
+            poolSize.descriptorCount = bindings.size() * m_descriptorSetCopies;
             poolSizes.push_back(poolSize);
         }
 
@@ -149,24 +155,26 @@ Pipeline PipelineBuilder::Build() {
     poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolCreateInfo.poolSizeCount = poolSizes.size();
     poolCreateInfo.pPoolSizes = poolSizes.data();
-    poolCreateInfo.maxSets = 1;
+    poolCreateInfo.maxSets = std::max<uint32_t>(1, descriptorSetLayouts.size()) * m_descriptorSetCopies;
 
     VkDescriptorPool pool;
     vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &pool);
 
     // Allocate descriptor set
-    std::unordered_map<uint32_t, VkDescriptorSet> descriptorSets;
-    for (auto &[key, layout]: descriptorSetLayouts) {
-        VkDescriptorSetAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocateInfo.descriptorPool = pool;
-        allocateInfo.descriptorSetCount = 1;
-        allocateInfo.pSetLayouts = &layout;
-
-        VkDescriptorSet descriptorSet;
-        vkAllocateDescriptorSets(m_device, &allocateInfo, &descriptorSet);
-
-        descriptorSets[key] = descriptorSet;
+    std::vector<std::unordered_map<uint32_t, VkDescriptorSet> > descriptorSets(m_descriptorSetCopies);
+    for (auto &copy: descriptorSets) {
+        for (auto &[key, layout]: descriptorSetLayouts) {
+            VkDescriptorSetAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocateInfo.descriptorPool = pool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &layout;
+
+            VkDescriptorSet descriptorSet;
+            vkAllocateDescriptorSets(m_device, &allocateInfo, &descriptorSet);
+
+            copy[key] = descriptorSet;
+        }
     }
 
     // Setup push constant and pipeline layout
@@ -219,4 +227,5 @@ void PipelineBuilder::Reset() {
     m_stages = {};
     m_shaderModules = {};
     m_ranges = {};
+    m_descriptorSetCopies = 1;
 }
@@ -0,0 +1,184 @@
+#include <QualityGovernor.h>
+
+#include <algorithm>
+
+void QualityGovernor::SetBase(const RadianceCascadeSettings &settings) {
+    m_base = settings;
+
+    // Find how far each knob can be lowered on its own, they do not depend on each other
+    m_lowestLevel = 0;
+    for (uint32_t knob = 0; knob < KNOB_COUNT; knob++) {
+        KnobSteps steps{};
+        Quality previous = ComputeQuality(steps);
+        while (true) {
+            steps[knob]++;
+            Quality next = ComputeQuality(steps);
+            if (next.renderScale == previous.renderScale &&
+                next.settings.raymarchStepSize == previous.settings.raymarchStepSize &&
+                next.settings.maxLevel == previous.settings.maxLevel &&
+                next.settings.verticalProbeCountAtMaxLevel == previous.settings.verticalProbeCountAtMaxLevel) {
+                break;
+            }
+            previous = next;
+        }
+        m_maxSteps[knob] = steps[knob] - 1;
+        m_lowestLevel += m_maxSteps[knob];
+    }
+
+    m_upgradeAllowedFrame.assign(m_lowestLevel + 1, 0);
+    m_upgradeBackoff.assign(m_lowestLevel + 1, config.upgradeBackoffFrames);
+
+    m_lowered.clear();
+    SetSteps({});
+}
+
+bool QualityGovernor::Update(double gpuFrameMilliseconds, std::span<const GpuTimer::PassTiming> passTimings) {
+    m_frame++;
+
+    if (m_frame - m_lastChangeFrame <= config.settleFrames) {
+        return false;
+    }
+
+    std::array<double, PASS_CATEGORY_COUNT> passMilliseconds{};
+    for (const auto &passTiming: passTimings) {
+        PassCategory category = GetPassCategory(passTiming.name);
+        if (category != PASS_CATEGORY_COUNT) {
+            passMilliseconds[category] += passTiming.milliseconds;
+        }
+    }
+
+    m_samples.push_back(gpuFrameMilliseconds);
+    m_passSamples.push_back(passMilliseconds);
+    if (m_samples.size() < config.windowFrames) {
+        return false;
+    }
+
+    // Median rather than mean, a single stall should not move the quality
+    std::vector<double> sorted = m_samples;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    m_median = sorted[sorted.size() / 2];
+
+    // Summed over the window, it only decides which knob goes down
+    std::array<double, PASS_CATEGORY_COUNT> windowPassMilliseconds{};
+    for (const auto &sample: m_passSamples) {
+        for (uint32_t category = 0; category < PASS_CATEGORY_COUNT; category++) {
+            windowPassMilliseconds[category] += sample[category];
+        }
+    }
+
+    m_samples.erase(m_samples.begin());
+    m_passSamples.erase(m_passSamples.begin());
+
+    double target = config.targetFrameMilliseconds;
+
+    if (m_median > target * (1.0 + config.hysteresis) && m_level < m_lowestLevel) {
+        // An upgrade into this level did not hold, wait longer before trying it again
+        if (m_lastChangeWasUpgrade && m_frame - m_lastChangeFrame <= config.settleFrames + config.windowFrames * 2) {
+            m_upgradeBackoff[m_level] = std::min(m_upgradeBackoff[m_level] * 2, config.maxUpgradeBackoffFrames);
+        } else {
+            m_upgradeBackoff[m_level] = config.upgradeBackoffFrames;
+        }
+        m_upgradeAllowedFrame[m_level] = m_frame + m_upgradeBackoff[m_level];
+
+        // Without timings keep cycling after the knob lowered last
+        Knob preferred = m_lowered.empty() ? RAYMARCH_STEP_SIZE
+                                           : static_cast<Knob>((m_lowered.back() + 1) % KNOB_COUNT);
+        auto dominant = std::max_element(windowPassMilliseconds.begin(), windowPassMilliseconds.end());
+        if (*dominant > 0.0) {
+            switch (dominant - windowPassMilliseconds.begin()) {
+                case TRACE:
+                    preferred = RAYMARCH_STEP_SIZE;
+                    break;
+                case MERGE:
+                    // The cascade count comes right after it in the cycle
+                    preferred = PROBE_COUNT;
+                    break;
+                case SCREEN:
+                    preferred = RENDER_SCALE;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        Knob knob = PickKnob(preferred);
+        KnobSteps steps = m_steps;
+        steps[knob]++;
+        m_lowered.push_back(knob);
+        SetSteps(steps);
+        m_lastChangeWasUpgrade = false;
+        return true;
+    }
+
+    if (m_median < target * (1.0 - config.hysteresis) && m_level > 0 &&
+        m_frame >= m_upgradeAllowedFrame[m_level - 1]) {
+        KnobSteps steps = m_steps;
+        steps[m_lowered.back()]--;
+        m_lowered.pop_back();
+        SetSteps(steps);
+        m_lastChangeWasUpgrade = true;
+        return true;
+    }
+
+    return false;
+}
+
+QualityGovernor::PassCategory QualityGovernor::GetPassCategory(const std::string &passName) {
+    // Names given by RadianceCascadeRenderer::RecordFrameCommands
+    if (passName.starts_with("Raymarch level") || passName.starts_with("Raycast level")) {
+        return TRACE;
+    }
+    if (passName.starts_with("Merge level") || passName == "Build GI texture" || passName == "Accumulate bounce") {
+        return MERGE;
+    }
+    if (passName == "Draw to SDF" || passName == "Evaluate scene" || passName == "Rescale SDF" ||
+        passName == "Final pass") {
+        return SCREEN;
+    }
+    return PASS_CATEGORY_COUNT;
+}
+
+QualityGovernor::Quality QualityGovernor::ComputeQuality(const KnobSteps &steps) const {
+    Quality quality{m_base, 1.0f};
+    RadianceCascadeSettings &settings = quality.settings;
+
+    for (uint32_t step = 0; step < steps[RAYMARCH_STEP_SIZE] &&
+                            settings.raymarchStepSize < config.maxRaymarchStepSize; step++) {
+        settings.raymarchStepSize = std::min(settings.raymarchStepSize * 1.5f, config.maxRaymarchStepSize);
+    }
+    for (uint32_t step = 0; step < steps[RENDER_SCALE] && quality.renderScale > config.minRenderScale; step++) {
+        quality.renderScale = std::max(quality.renderScale * 0.85f, config.minRenderScale);
+    }
+    for (uint32_t step = 0; step < steps[PROBE_COUNT] &&
+                            settings.verticalProbeCountAtMaxLevel > config.minVerticalProbeCount; step++) {
+        settings.verticalProbeCountAtMaxLevel--;
+    }
+    for (uint32_t step = 0; step < steps[MAX_LEVEL] && settings.maxLevel > config.minMaxLevel; step++) {
+        settings.maxLevel--;
+    }
+
+    return quality;
+}
+
+QualityGovernor::Knob QualityGovernor::PickKnob(Knob preferred) const {
+    for (uint32_t attempt = 0; attempt < KNOB_COUNT; attempt++) {
+        Knob knob = static_cast<Knob>((preferred + attempt) % KNOB_COUNT);
+        if (m_steps[knob] < m_maxSteps[knob]) {
+            return knob;
+        }
+    }
+    return preferred;
+}
+
+void QualityGovernor::SetSteps(const KnobSteps &steps) {
+    m_steps = steps;
+    m_level = 0;
+    for (uint32_t knobSteps: steps) {
+        m_level += knobSteps;
+    }
+    m_quality = ComputeQuality(m_steps);
+    m_samples.clear();
+    m_passSamples.clear();
+    m_median = 0.0;
+    m_lastChangeFrame = m_frame;
+}
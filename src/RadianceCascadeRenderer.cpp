@@ -0,0 +1,1538 @@
+#include <RadianceCascadeRenderer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+
+// Generated by shader compilation
+// Avoid loading shaders through the filesystem, because i'm lazy
+#include <Shaders/AccumulateBounce.h>
+#include <Shaders/DrawToSDFTexture.h>
+#include <Shaders/EvaluateSceneSDF.h>
+#include <Shaders/FillTextureFloat4.h>
+#include <Shaders/FinalPass.h>
+#include <Shaders/FinalPassEdgeAware.h>
+#include <Shaders/RaymarchSDF.h>
+#include <Shaders/RaycastSegments.h>
+#include <Shaders/MergeCascades.h>
+#include <Shaders/MergeCascadesToGI.h>
+#include <Shaders/BuildGITexture.h>
+#include <Shaders/RescaleSDFTexture.h>
+#include <Shaders/RaymarchSDFRGBA16F.h>
+#include <Shaders/RaycastSegmentsRGBA16F.h>
+#include <Shaders/MergeCascadesRGBA16F.h>
+#include <Shaders/MergeCascadesToGIRGBA16F.h>
+#include <Shaders/BuildGITextureRGBA16F.h>
+#include <Shaders/AccumulateBounceRGBA16F.h>
+
+namespace {
+    // Cascade images larger than a block get their own allocation
+    constexpr VkDeviceSize CASCADE_POOL_BLOCK_SIZE = 256ull * 1024 * 1024;
+    // Settings changes between two defragmentations of the cascade pool
+    constexpr uint32_t DEFRAGMENTATION_INTERVAL = 8;
+
+    // Descriptor sets of the frames in flight and of the next configuration
+    constexpr uint32_t DESCRIPTOR_SLOTS = 2;
+
+    // Matches the image format declared in EvaluateSceneSDF.slang
+    constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // Every image of the renderer is a single mip 2D storage image that can also be sampled and copied from
+    VkImageCreateInfo StorageImageCreateInfo(VkExtent2D extent, VkFormat format) {
+        VkImageCreateInfo imgCreateInfo{};
+        imgCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imgCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imgCreateInfo.extent.width = extent.width;
+        imgCreateInfo.extent.height = extent.height;
+        imgCreateInfo.extent.depth = 1;
+        imgCreateInfo.mipLevels = 1;
+        imgCreateInfo.arrayLayers = 1;
+        imgCreateInfo.format = format;
+
+        imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imgCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imgCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        return imgCreateInfo;
+    }
+
+    // Smallest rectangle holding both, an empty rectangle holds nothing
+    VkRect2D UnionRect(VkRect2D a, VkRect2D b) {
+        if (a.extent.width == 0 || a.extent.height == 0) {
+            return b;
+        }
+        if (b.extent.width == 0 || b.extent.height == 0) {
+            return a;
+        }
+
+        int32_t minX = std::min(a.offset.x, b.offset.x);
+        int32_t minY = std::min(a.offset.y, b.offset.y);
+        int32_t maxX = std::max(a.offset.x + (int32_t) a.extent.width, b.offset.x + (int32_t) b.extent.width);
+        int32_t maxY = std::max(a.offset.y + (int32_t) a.extent.height, b.offset.y + (int32_t) b.extent.height);
+        return {{minX, minY}, {(uint32_t) (maxX - minX), (uint32_t) (maxY - minY)}};
+    }
+}
+
+void RadianceCascadeRenderer::Init(VkDevice device, VkPhysicalDevice physicalDevice, VmaAllocator allocator,
+                                   VkExtent2D renderExtent, const RadianceCascadeSettings &settings,
+                                   uint32_t framesInFlight, VkFormat cascadeFormat) {
+    if (cascadeFormat != VK_FORMAT_R32G32B32A32_SFLOAT && cascadeFormat != VK_FORMAT_R16G16B16A16_SFLOAT) {
+        throw std::runtime_error(std::format("Unsupported cascade format: {}", string_VkFormat(cascadeFormat)));
+    }
+
+    this->device = device;
+    this->allocator = allocator;
+    this->renderExtent = renderExtent;
+    this->radianceCascadeSettings = settings;
+    this->framesInFlight = framesInFlight;
+    this->cascadeFormat = cascadeFormat;
+
+    // The shader declares the storage format of the cascade images
+    bool halfCascades = cascadeFormat == VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    VkSamplerCreateInfo sdfSamplerCreateInfo{};
+    sdfSamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sdfSamplerCreateInfo.magFilter = VK_FILTER_NEAREST; //VK_FILTER_LINEAR;
+    sdfSamplerCreateInfo.minFilter = VK_FILTER_NEAREST; //VK_FILTER_LINEAR;
+    sdfSamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST; // VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sdfSamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sdfSamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sdfSamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sdfSamplerCreateInfo.mipLodBias = 0.0f;
+    sdfSamplerCreateInfo.anisotropyEnable = VK_FALSE;
+    sdfSamplerCreateInfo.maxAnisotropy = 1.0f;
+    sdfSamplerCreateInfo.compareEnable = VK_FALSE;
+    sdfSamplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    sdfSamplerCreateInfo.minLod = 0.0f;
+    sdfSamplerCreateInfo.maxLod = 0.0f;
+    sdfSamplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    sdfSamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+
+    VK_CHECK(vkCreateSampler(device, &sdfSamplerCreateInfo, nullptr, &linearSampler));
+
+    VkFormatProperties cascadeFormatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, cascadeFormat, &cascadeFormatProperties);
+    cascadeFilterSupported = cascadeFormatProperties.optimalTilingFeatures &
+                             VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    VkSamplerCreateInfo probeFilterSamplerCreateInfo = sdfSamplerCreateInfo;
+    probeFilterSamplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+    probeFilterSamplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+
+    VK_CHECK(vkCreateSampler(device, &probeFilterSamplerCreateInfo, nullptr, &probeFilterSampler));
+
+    brushSegmentBuffer = CreateBuffer(allocator, framesInFlight * MAX_BRUSH_SEGMENTS * sizeof(BrushSegment),
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                      VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    brushParameterBuffer = CreateBuffer(allocator, framesInFlight * sizeof(BrushParameters),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                        VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+    PipelineBuilder pipelineBuilder(device);
+
+    pipelineBuilder.AddShaderStage(DrawToSDFTexture, sizeof(DrawToSDFTexture), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // Draw to SDF pipeline
+    VkDescriptorSetLayoutBinding drawToSDFTextureDescriptorSetLayoutBinding{};
+    drawToSDFTextureDescriptorSetLayoutBinding.binding = 0;
+    drawToSDFTextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    drawToSDFTextureDescriptorSetLayoutBinding.descriptorCount = 1;
+    drawToSDFTextureDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    drawToSDFTextureDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, drawToSDFTextureDescriptorSetLayoutBinding);
+    drawToSDFTextureDescriptorSetLayoutBinding.binding = 1;
+    drawToSDFTextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pipelineBuilder.AddBinding(0, drawToSDFTextureDescriptorSetLayoutBinding);
+    drawToSDFTextureDescriptorSetLayoutBinding.binding = 2;
+    pipelineBuilder.AddBinding(0, drawToSDFTextureDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+
+    pipelineBuilder.SetPushConstantSize<DrawToSDFTexturePushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    drawToSDFTexturePipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    pipelineBuilder.AddShaderStage(EvaluateSceneSDF, sizeof(EvaluateSceneSDF), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // SDF and albedo, then the primitives, points, cell ranges and cell primitives
+    VkDescriptorSetLayoutBinding evaluateSceneSDFDescriptorSetLayoutBinding{};
+    evaluateSceneSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    evaluateSceneSDFDescriptorSetLayoutBinding.descriptorCount = 1;
+    evaluateSceneSDFDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    evaluateSceneSDFDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    for (uint32_t binding = 0; binding < 6; binding++) {
+        evaluateSceneSDFDescriptorSetLayoutBinding.binding = binding;
+        if (binding == 2) {
+            evaluateSceneSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        pipelineBuilder.AddBinding(0, evaluateSceneSDFDescriptorSetLayoutBinding);
+    }
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<EvaluateSceneSDFPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    evaluateSceneSDFPipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    pipelineBuilder.AddShaderStage(FillTextureFloat4, sizeof(FillTextureFloat4), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // Draw to SDF pipeline
+    VkDescriptorSetLayoutBinding fillTextureFloat4DescriptorSetLayoutBinding{};
+    fillTextureFloat4DescriptorSetLayoutBinding.binding = 0;
+    fillTextureFloat4DescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    fillTextureFloat4DescriptorSetLayoutBinding.descriptorCount = 1;
+    fillTextureFloat4DescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    fillTextureFloat4DescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, fillTextureFloat4DescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<FillTextureFloat4PushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    fillTextureFloat4Pipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    VkDescriptorSetLayoutBinding convertSDFDescriptorSetLayoutBinding{};
+    convertSDFDescriptorSetLayoutBinding.binding = 0;
+    convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    convertSDFDescriptorSetLayoutBinding.descriptorCount = 1;
+    convertSDFDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    convertSDFDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
+    convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    convertSDFDescriptorSetLayoutBinding.binding = 1;
+    pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
+    convertSDFDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    convertSDFDescriptorSetLayoutBinding.binding = 2;
+    pipelineBuilder.AddBinding(0, convertSDFDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+
+    // Same bindings for both variants
+    pipelineBuilder.AddShaderStage(FinalPass, sizeof(FinalPass), VK_SHADER_STAGE_COMPUTE_BIT);
+    finalPassPipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.AddShaderStage(FinalPassEdgeAware, sizeof(FinalPassEdgeAware), VK_SHADER_STAGE_COMPUTE_BIT);
+    finalPassEdgeAwarePipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(RaymarchSDFRGBA16F, sizeof(RaymarchSDFRGBA16F), VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(RaymarchSDF, sizeof(RaymarchSDF), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    VkDescriptorSetLayoutBinding raymarchDescriptorSetLayoutBinding{};
+    raymarchDescriptorSetLayoutBinding.binding = 0;
+    raymarchDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    raymarchDescriptorSetLayoutBinding.descriptorCount = 1;
+    raymarchDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    raymarchDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, raymarchDescriptorSetLayoutBinding);
+    raymarchDescriptorSetLayoutBinding.binding = 1;
+    raymarchDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pipelineBuilder.AddBinding(0, raymarchDescriptorSetLayoutBinding);
+    // Bounce and albedo for multi-bounce
+    raymarchDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    for (uint32_t binding = 2; binding < 4; binding++) {
+        raymarchDescriptorSetLayoutBinding.binding = binding;
+        pipelineBuilder.AddBinding(0, raymarchDescriptorSetLayoutBinding);
+    }
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<RaymarchPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    for (int i = 0; i < MAX_LEVEL; i++) {
+        raymarchPipelines.push_back(pipelineBuilder.Build());
+    }
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(RaycastSegmentsRGBA16F, sizeof(RaycastSegmentsRGBA16F),
+                                       VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(RaycastSegments, sizeof(RaycastSegments), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    // Raymarch bindings, then the segments, cell ranges and cell segments
+    VkDescriptorSetLayoutBinding raycastSegmentsDescriptorSetLayoutBinding{};
+    raycastSegmentsDescriptorSetLayoutBinding.binding = 0;
+    raycastSegmentsDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    raycastSegmentsDescriptorSetLayoutBinding.descriptorCount = 1;
+    raycastSegmentsDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    raycastSegmentsDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, raycastSegmentsDescriptorSetLayoutBinding);
+    raycastSegmentsDescriptorSetLayoutBinding.binding = 1;
+    raycastSegmentsDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pipelineBuilder.AddBinding(0, raycastSegmentsDescriptorSetLayoutBinding);
+    raycastSegmentsDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    for (uint32_t binding = 2; binding < 5; binding++) {
+        raycastSegmentsDescriptorSetLayoutBinding.binding = binding;
+        pipelineBuilder.AddBinding(0, raycastSegmentsDescriptorSetLayoutBinding);
+    }
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<RaycastSegmentsPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    for (int i = 0; i < MAX_LEVEL; i++) {
+        raycastSegmentsPipelines.push_back(pipelineBuilder.Build());
+    }
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(MergeCascadesRGBA16F, sizeof(MergeCascadesRGBA16F), VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(MergeCascades, sizeof(MergeCascades), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    VkDescriptorSetLayoutBinding mergeCascadeDescriptorSetLayoutBinding{};
+    mergeCascadeDescriptorSetLayoutBinding.binding = 0;
+    mergeCascadeDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    mergeCascadeDescriptorSetLayoutBinding.descriptorCount = 1;
+    mergeCascadeDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    mergeCascadeDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+    mergeCascadeDescriptorSetLayoutBinding.binding = 1;
+    pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+    // The input level again, sampled in the direction first layout
+    VkDescriptorSetLayoutBinding mergeCascadeSamplerDescriptorSetLayoutBinding = mergeCascadeDescriptorSetLayoutBinding;
+    mergeCascadeSamplerDescriptorSetLayoutBinding.binding = 3;
+    mergeCascadeSamplerDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pipelineBuilder.AddBinding(0, mergeCascadeSamplerDescriptorSetLayoutBinding);
+    // Raymarch of the output level
+    mergeCascadeDescriptorSetLayoutBinding.binding = 4;
+    pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<MergeCascadesPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    for (int i = 0; i < MAX_LEVEL; i++) {
+        mergeCascadesPipelines.push_back(pipelineBuilder.Build());
+    }
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(MergeCascadesToGIRGBA16F, sizeof(MergeCascadesToGIRGBA16F),
+                                       VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(MergeCascadesToGI, sizeof(MergeCascadesToGI), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    // Level 1, level 0, GI, level 1 sampled, then the raymarch of level 0
+    for (uint32_t binding = 0; binding < 3; binding++) {
+        mergeCascadeDescriptorSetLayoutBinding.binding = binding;
+        pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+    }
+    pipelineBuilder.AddBinding(0, mergeCascadeSamplerDescriptorSetLayoutBinding);
+    mergeCascadeDescriptorSetLayoutBinding.binding = 4;
+    pipelineBuilder.AddBinding(0, mergeCascadeDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<MergeCascadesToGIPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    mergeCascadesToGIPipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(BuildGITextureRGBA16F, sizeof(BuildGITextureRGBA16F),
+                                       VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(BuildGITexture, sizeof(BuildGITexture), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    VkDescriptorSetLayoutBinding buildGITextureDescriptorSetLayoutBinding{};
+    buildGITextureDescriptorSetLayoutBinding.binding = 0;
+    buildGITextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    buildGITextureDescriptorSetLayoutBinding.descriptorCount = 1;
+    buildGITextureDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    buildGITextureDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, buildGITextureDescriptorSetLayoutBinding);
+    buildGITextureDescriptorSetLayoutBinding.binding = 1;
+    pipelineBuilder.AddBinding(0, buildGITextureDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<CascadeLayout>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    buildGITexturePipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    if (halfCascades) {
+        pipelineBuilder.AddShaderStage(AccumulateBounceRGBA16F, sizeof(AccumulateBounceRGBA16F),
+                                       VK_SHADER_STAGE_COMPUTE_BIT);
+    } else {
+        pipelineBuilder.AddShaderStage(AccumulateBounce, sizeof(AccumulateBounce), VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    // GI, bounce
+    for (uint32_t binding = 0; binding < 2; binding++) {
+        buildGITextureDescriptorSetLayoutBinding.binding = binding;
+        pipelineBuilder.AddBinding(0, buildGITextureDescriptorSetLayoutBinding);
+    }
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<float>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    accumulateBouncePipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    pipelineBuilder.AddShaderStage(RescaleSDFTexture, sizeof(RescaleSDFTexture), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkDescriptorSetLayoutBinding rescaleSDFTextureDescriptorSetLayoutBinding{};
+    rescaleSDFTextureDescriptorSetLayoutBinding.binding = 0;
+    rescaleSDFTextureDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    rescaleSDFTextureDescriptorSetLayoutBinding.descriptorCount = 1;
+    rescaleSDFTextureDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    rescaleSDFTextureDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, rescaleSDFTextureDescriptorSetLayoutBinding);
+    rescaleSDFTextureDescriptorSetLayoutBinding.binding = 1;
+    pipelineBuilder.AddBinding(0, rescaleSDFTextureDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(DESCRIPTOR_SLOTS);
+    pipelineBuilder.SetPushConstantSize<float>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    rescaleSDFTexturePipeline = pipelineBuilder.Build();
+
+    // The cascade and GI images are recreated on every settings change, sub allocating them from blocks that stay
+    // alive avoids going back to the driver each time
+    VkImageCreateInfo cascadeImageCreateInfo = StorageImageCreateInfo({1, 1}, cascadeFormat);
+    VmaAllocationCreateInfo cascadeAllocationCreateInfo{};
+    cascadeAllocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    cascadeAllocationCreateInfo.priority = 1.0f;
+
+    VmaPoolCreateInfo cascadePoolCreateInfo{};
+    VK_CHECK(vmaFindMemoryTypeIndexForImageInfo(allocator, &cascadeImageCreateInfo, &cascadeAllocationCreateInfo,
+                                                &cascadePoolCreateInfo.memoryTypeIndex));
+    cascadePoolCreateInfo.blockSize = CASCADE_POOL_BLOCK_SIZE;
+    cascadePoolCreateInfo.priority = 1.0f;
+
+    VK_CHECK(vmaCreatePool(allocator, &cascadePoolCreateInfo, &cascadePool));
+    vmaSetPoolName(allocator, cascadePool, "Cascades");
+
+    CreateScreenImages();
+    CreateCascadeImages();
+    WriteDescriptors();
+}
+
+void RadianceCascadeRenderer::Destroy() {
+    deletionQueue.FlushAll();
+    fillTextureFloat4Pipeline.Destroy();
+    drawToSDFTexturePipeline.Destroy();
+    evaluateSceneSDFPipeline.Destroy();
+    finalPassPipeline.Destroy();
+    finalPassEdgeAwarePipeline.Destroy();
+    for (auto &raymarchPipeline: raymarchPipelines) {
+        raymarchPipeline.Destroy();
+    }
+    for (auto &raycastSegmentsPipeline: raycastSegmentsPipelines) {
+        raycastSegmentsPipeline.Destroy();
+    }
+    for (auto &mergeCascadesPipeline: mergeCascadesPipelines) {
+        mergeCascadesPipeline.Destroy();
+    }
+    mergeCascadesToGIPipeline.Destroy();
+    buildGITexturePipeline.Destroy();
+    accumulateBouncePipeline.Destroy();
+    rescaleSDFTexturePipeline.Destroy();
+    for (auto &raymarchImage: raymarchImages) {
+        if (raymarchImage.Initialized()) {
+            DestroyImage(device, allocator, raymarchImage);
+        }
+    }
+    for (auto &mergedImage: mergedImages) {
+        DestroyImage(device, allocator, mergedImage);
+    }
+    if (globalIlluminationImage.Initialized()) {
+        DestroyImage(device, allocator, globalIlluminationImage);
+    }
+    if (bounceImage.Initialized()) {
+        DestroyImage(device, allocator, bounceImage);
+    }
+    vmaDestroyPool(allocator, cascadePool);
+    vkDestroySampler(device, linearSampler, nullptr);
+    vkDestroySampler(device, probeFilterSampler, nullptr);
+    DestroyBuffer(allocator, brushSegmentBuffer);
+    DestroyBuffer(allocator, brushParameterBuffer);
+    for (const Buffer &sceneBuffer: {scenePrimitiveBuffer, scenePointBuffer, sceneCellRangeBuffer,
+                                     sceneCellPrimitiveBuffer, sceneSegmentBuffer, sceneSegmentCellRangeBuffer,
+                                     sceneSegmentCellBuffer}) {
+        if (sceneBuffer.Initialized()) {
+            DestroyBuffer(allocator, sceneBuffer);
+        }
+    }
+    DestroyImage(device, allocator, displayImage);
+    DestroyImage(device, allocator, albedoImage);
+    DestroyImage(device, allocator, sdfImage);
+    if (previousSDFImage.Initialized()) {
+        DestroyImage(device, allocator, previousSDFImage);
+    }
+}
+
+// Creates the images that follow the render resolution, WriteDescriptors binds them
+void RadianceCascadeRenderer::CreateScreenImages() {
+    VkImageCreateInfo imgCreateInfo = StorageImageCreateInfo(renderExtent, VK_FORMAT_R32G32B32A32_SFLOAT);
+
+    sdfImage = CreateImage(device, imgCreateInfo, allocator);
+    displayImage = CreateImage(device, imgCreateInfo, allocator);
+    albedoImage = CreateImage(device, StorageImageCreateInfo(renderExtent, ALBEDO_FORMAT), allocator);
+}
+
+void RadianceCascadeRenderer::SetConfiguration(VkExtent2D extent, const RadianceCascadeSettings &settings) {
+    if (frameNumber < spareDescriptorSlotReleaseFrame) {
+        // Frames in flight still use the spare descriptor sets, the latest configuration wins once they are done
+        pendingConfiguration = true;
+        pendingRenderExtent = extent;
+        pendingSettings = settings;
+        return;
+    }
+
+    ApplyConfiguration(extent, settings);
+}
+
+void RadianceCascadeRenderer::SetRenderExtent(VkExtent2D extent) {
+    SetConfiguration(extent, pendingConfiguration ? pendingSettings : radianceCascadeSettings);
+}
+
+// Builds the new images and descriptors next to the ones in flight, then switches to them for the next recorded
+// frame. The old images are destroyed once the frames using them are complete.
+void RadianceCascadeRenderer::ApplyConfiguration(VkExtent2D extent, const RadianceCascadeSettings &settings) {
+    pendingConfiguration = false;
+    radianceCascadeSettings = settings;
+
+    if (extent.width != renderExtent.width || extent.height != renderExtent.height) {
+        if (screenImagesRecreated) {
+            // The previous rescale was never recorded, keep the original content as the source
+            RetireImage(sdfImage);
+        } else {
+            previousSDFImage = sdfImage;
+            previousSDFExtent = renderExtent;
+        }
+        RetireImage(displayImage);
+        RetireImage(albedoImage);
+
+        renderExtent = extent;
+        CreateScreenImages();
+        screenImagesRecreated = true;
+        // Evaluated again at the new resolution instead of keeping the blurrier rescaled copy
+        sceneDirty = scenePrimitiveBuffer.Initialized();
+    }
+
+    for (auto &raymarchImage: raymarchImages) {
+        RetireImage(raymarchImage);
+    }
+    for (auto &mergedImage: mergedImages) {
+        RetireImage(mergedImage);
+    }
+    RetireImage(globalIlluminationImage);
+    RetireImage(bounceImage);
+
+    // Cascade resolution depends on the aspect ratio
+    CreateCascadeImages();
+
+    if (++settingsChangesSinceDefragmentation >= DEFRAGMENTATION_INTERVAL) {
+        DefragmentCascadePool();
+        settingsChangesSinceDefragmentation = 0;
+    }
+
+    spareDescriptorSlotReleaseFrame = frameNumber + framesInFlight;
+    descriptorSlot = (descriptorSlot + 1) % DESCRIPTOR_SLOTS;
+    WriteDescriptors();
+}
+
+void RadianceCascadeRenderer::RetireImage(const Image &image) {
+    // Recorded frames up to the current one may still use it
+    deletionQueue.Push(frameNumber + framesInFlight, [this, image] {
+        DestroyImage(device, allocator, image);
+    });
+}
+
+void RadianceCascadeRenderer::RetireBuffer(const Buffer &buffer) {
+    deletionQueue.Push(frameNumber + framesInFlight, [this, buffer] {
+        DestroyBuffer(allocator, buffer);
+    });
+}
+
+void RadianceCascadeRenderer::SetScene(const Scene &scene) {
+    ClearScene();
+    if (scene.Empty()) {
+        return;
+    }
+
+    sceneGrid = scene.BuildGrid();
+    std::vector<Scene::Segment> segments = scene.BuildSegments();
+    sceneSegmentGrid = Scene::BuildSegmentGrid(segments);
+
+    auto upload = [&](const auto &data) {
+        return CreateSceneBuffer(data.data(), data.size() * sizeof(data[0]));
+    };
+
+    scenePrimitiveBuffer = upload(scene.GetPrimitives());
+    scenePointBuffer = upload(scene.GetPoints());
+    sceneCellRangeBuffer = upload(sceneGrid.cellRanges);
+    sceneCellPrimitiveBuffer = upload(sceneGrid.cellPrimitives);
+    sceneSegmentBuffer = upload(segments);
+    sceneSegmentCellRangeBuffer = upload(sceneSegmentGrid.cellRanges);
+    sceneSegmentCellBuffer = upload(sceneSegmentGrid.cellPrimitives);
+    sceneDirty = true;
+}
+
+// Written once, so host visible memory read straight by the shaders is enough
+Buffer RadianceCascadeRenderer::CreateSceneBuffer(const void *data, VkDeviceSize size) {
+    Buffer buffer = CreateBuffer(allocator, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                 VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    std::memcpy(buffer.mapped, data, size);
+    VK_CHECK(vmaFlushAllocation(allocator, buffer.memory, 0, size));
+    return buffer;
+}
+
+void RadianceCascadeRenderer::ClearScene() {
+    if (scenePrimitiveBuffer.Initialized()) {
+        RetireBuffer(scenePrimitiveBuffer);
+        RetireBuffer(scenePointBuffer);
+        RetireBuffer(sceneCellRangeBuffer);
+        RetireBuffer(sceneCellPrimitiveBuffer);
+        RetireBuffer(sceneSegmentBuffer);
+        RetireBuffer(sceneSegmentCellRangeBuffer);
+        RetireBuffer(sceneSegmentCellBuffer);
+    }
+
+    scenePrimitiveBuffer = {};
+    scenePointBuffer = {};
+    sceneCellRangeBuffer = {};
+    sceneCellPrimitiveBuffer = {};
+    sceneSegmentBuffer = {};
+    sceneSegmentCellRangeBuffer = {};
+    sceneSegmentCellBuffer = {};
+    sceneGrid = {};
+    sceneSegmentGrid = {};
+    sceneDirty = false;
+}
+
+std::vector<RadianceCascadeRenderer::MemoryUsage> RadianceCascadeRenderer::GetMemoryUsage() const {
+    std::vector<MemoryUsage> usage;
+    auto addImage = [&](std::string role, const Image &image) {
+        if (image.Initialized()) {
+            VmaAllocationInfo allocationInfo;
+            vmaGetAllocationInfo(allocator, image.memory, &allocationInfo);
+            usage.push_back({std::move(role), allocationInfo.size});
+        }
+    };
+
+    addImage("SDF", sdfImage);
+    addImage("Albedo", albedoImage);
+    addImage("Display", displayImage);
+    addImage("Previous SDF", previousSDFImage);
+    for (size_t i = 0; i < raymarchImages.size(); i++) {
+        addImage(std::format("Cascade level {}", i), raymarchImages[i]);
+    }
+    for (size_t i = 0; i < mergedImages.size(); i++) {
+        addImage(std::format("Merged level {}", i), mergedImages[i]);
+    }
+    addImage("GI", globalIlluminationImage);
+    addImage("Bounce", bounceImage);
+
+    return usage;
+}
+
+VkDeviceSize RadianceCascadeRenderer::GetImageMemoryBytes() const {
+    VkDeviceSize bytes = 0;
+    for (const auto &usage: GetMemoryUsage()) {
+        bytes += usage.bytes;
+    }
+
+    return bytes;
+}
+
+VkDeviceSize RadianceCascadeRenderer::PredictImageMemoryBytes(VkExtent2D renderExtent,
+                                                              const RadianceCascadeSettings &settings) const {
+    VkExtent2D cascadeExtent = GetCascadeExtent(renderExtent, settings);
+
+    VkDeviceSize bytes = 2 * GetRequiredBytes(StorageImageCreateInfo(renderExtent, VK_FORMAT_R32G32B32A32_SFLOAT));
+    bytes += GetRequiredBytes(StorageImageCreateInfo(renderExtent, ALBEDO_FORMAT));
+    // The last level is never merged
+    uint32_t levelImages = KeepsHistory() ? 2 * settings.maxLevel - 1 : settings.maxLevel;
+    bytes += levelImages * GetRequiredBytes(StorageImageCreateInfo(cascadeExtent, cascadeFormat));
+    // GI and bounce
+    bytes += 2 * GetRequiredBytes(StorageImageCreateInfo({cascadeExtent.width / 2, cascadeExtent.height / 2},
+                                                         cascadeFormat));
+
+    return bytes;
+}
+
+// Asks the driver instead of multiplying texel sizes, so alignment and tiling padding are accounted for
+VkDeviceSize RadianceCascadeRenderer::GetRequiredBytes(const VkImageCreateInfo &imgCreateInfo) const {
+    VkDeviceImageMemoryRequirements requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+    requirementsInfo.pCreateInfo = &imgCreateInfo;
+
+    VkMemoryRequirements2 requirements{};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    vkGetDeviceImageMemoryRequirements(device, &requirementsInfo, &requirements);
+
+    return requirements.memoryRequirements.size;
+}
+
+VkExtent2D RadianceCascadeRenderer::GetCascadeExtent() const {
+    return GetCascadeExtent(renderExtent, radianceCascadeSettings);
+}
+
+VkExtent2D RadianceCascadeRenderer::GetCascadeExtent(VkExtent2D renderExtent, const RadianceCascadeSettings &settings) {
+    // size of cascades
+    // first we need to know the resolution the max level cascade
+    uint32_t maxLevelCascadeProbeResolution = 1 << settings.maxLevel;
+    uint32_t aspectRatio = std::ceil((float) renderExtent.width / renderExtent.height);
+    uint32_t horizontalProbeCountAtMaxLevel = aspectRatio * settings.verticalProbeCountAtMaxLevel;
+    uint32_t cascadeWidth = horizontalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+    uint32_t cascadeHeight = settings.verticalProbeCountAtMaxLevel * maxLevelCascadeProbeResolution;
+
+    return {cascadeWidth, cascadeHeight};
+}
+
+Image RadianceCascadeRenderer::CreateCascadeImage(const VkImageCreateInfo &imgCreateInfo) {
+    bool fitsInPool = GetRequiredBytes(imgCreateInfo) <= CASCADE_POOL_BLOCK_SIZE;
+    return CreateImage(device, imgCreateInfo, allocator, fitsInPool ? cascadePool : VK_NULL_HANDLE);
+}
+
+// The previous cascade images must have been retired
+void RadianceCascadeRenderer::CreateCascadeImages() {
+    raymarchImages.clear();
+
+    auto [cascadeWidth, cascadeHeight] = GetCascadeExtent();
+
+    VkImageCreateInfo imgCreateInfo = StorageImageCreateInfo({cascadeWidth, cascadeHeight}, cascadeFormat);
+
+    mergedImages.clear();
+    raymarchesKept = KeepsHistory();
+
+    for (int i = 0; i < radianceCascadeSettings.maxLevel; i++) {
+        raymarchImages.push_back(CreateCascadeImage(imgCreateInfo));
+        if (raymarchesKept && i + 1 < radianceCascadeSettings.maxLevel) {
+            mergedImages.push_back(CreateCascadeImage(imgCreateInfo));
+        }
+    }
+    UpdateMergedLevelImages();
+
+    VkImageCreateInfo imgCreateInfoOutputGI = StorageImageCreateInfo({cascadeWidth / 2, cascadeHeight / 2},
+                                                                     cascadeFormat);
+
+    globalIlluminationImage = CreateCascadeImage(imgCreateInfoOutputGI);
+    bounceImage = CreateCascadeImage(imgCreateInfoOutputGI);
+    bounceInvalid = true;
+    // The history is undefined
+    levelTraceCounts = {};
+    scheduleFrame = 0;
+
+    raymarchImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    outputGIImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+const Image &RadianceCascadeRenderer::GetMergedLevelImage(uint32_t level) const {
+    return level < mergedImages.size() ? mergedImages[level] : raymarchImages[level];
+}
+
+void RadianceCascadeRenderer::UpdateMergedLevelImages() {
+    mergedLevelImages.clear();
+    for (uint32_t level = 0; level < raymarchImages.size(); level++) {
+        mergedLevelImages.push_back(GetMergedLevelImage(level));
+    }
+}
+
+// Binds every image to the pipelines in the current descriptor slot, which no pending frame may use
+void RadianceCascadeRenderer::WriteDescriptors() {
+    VkDescriptorImageInfo descriptorImageInfoSDFImage{};
+    descriptorImageInfoSDFImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoSDFImage.imageView = sdfImage.view;
+    descriptorImageInfoSDFImage.sampler = VK_NULL_HANDLE;
+    drawToSDFTexturePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                  &descriptorImageInfoSDFImage, nullptr, descriptorSlot);
+    fillTextureFloat4Pipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                   &descriptorImageInfoSDFImage, nullptr, descriptorSlot);
+    for (Pipeline *pipeline: {&finalPassPipeline, &finalPassEdgeAwarePipeline}) {
+        pipeline->WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfoSDFImage, nullptr,
+                                       descriptorSlot);
+    }
+    rescaleSDFTexturePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                   &descriptorImageInfoSDFImage, nullptr, descriptorSlot);
+
+    VkDescriptorBufferInfo descriptorBufferInfoBrushSegments{};
+    descriptorBufferInfoBrushSegments.buffer = brushSegmentBuffer.buffer;
+    descriptorBufferInfoBrushSegments.offset = 0;
+    descriptorBufferInfoBrushSegments.range = VK_WHOLE_SIZE;
+    drawToSDFTexturePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+                                                  &descriptorBufferInfoBrushSegments, descriptorSlot);
+
+    VkDescriptorBufferInfo descriptorBufferInfoBrushParameters{};
+    descriptorBufferInfoBrushParameters.buffer = brushParameterBuffer.buffer;
+    descriptorBufferInfoBrushParameters.offset = 0;
+    descriptorBufferInfoBrushParameters.range = VK_WHOLE_SIZE;
+    drawToSDFTexturePipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+                                                  &descriptorBufferInfoBrushParameters, descriptorSlot);
+
+    VkDescriptorImageInfo descriptorImageInfoDisplayImage{};
+    descriptorImageInfoDisplayImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoDisplayImage.imageView = displayImage.view;
+    descriptorImageInfoDisplayImage.sampler = VK_NULL_HANDLE;
+    for (Pipeline *pipeline: {&finalPassPipeline, &finalPassEdgeAwarePipeline}) {
+        pipeline->WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfoDisplayImage,
+                                       nullptr, descriptorSlot);
+    }
+
+    VkDescriptorImageInfo descriptorImageInfoSDFImageSampler{};
+    descriptorImageInfoSDFImageSampler.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoSDFImageSampler.imageView = sdfImage.view;
+    descriptorImageInfoSDFImageSampler.sampler = linearSampler;
+    for (auto &raymarchPipeline: raymarchPipelines) {
+        raymarchPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                              &descriptorImageInfoSDFImageSampler, nullptr, descriptorSlot);
+    }
+
+    if (screenImagesRecreated) {
+        VkDescriptorImageInfo descriptorImageInfoPreviousSDFImage{};
+        descriptorImageInfoPreviousSDFImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoPreviousSDFImage.imageView = previousSDFImage.view;
+        descriptorImageInfoPreviousSDFImage.sampler = VK_NULL_HANDLE;
+        rescaleSDFTexturePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoPreviousSDFImage, nullptr, descriptorSlot);
+    }
+
+    for (int i = 0; i < radianceCascadeSettings.maxLevel; i++) {
+        VkDescriptorImageInfo descriptorImageInfo{};
+        descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfo.imageView = raymarchImages[i].view;
+        descriptorImageInfo.sampler = VK_NULL_HANDLE;
+        raymarchPipelines[i].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfo,
+                                                  nullptr, descriptorSlot);
+    }
+
+    // Merged in place unless the raymarches are kept, then each level reads its raymarch and writes its merged image
+    for (int i = 0; i < radianceCascadeSettings.maxLevel - 1; i++) {
+        VkDescriptorImageInfo descriptorImageInfoInput{};
+        descriptorImageInfoInput.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoInput.imageView = GetMergedLevelImage(i + 1).view;
+        descriptorImageInfoInput.sampler = VK_NULL_HANDLE;
+        VkDescriptorImageInfo descriptorImageInfoOutput{};
+        descriptorImageInfoOutput.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoOutput.imageView = GetMergedLevelImage(i).view;
+        descriptorImageInfoOutput.sampler = VK_NULL_HANDLE;
+        VkDescriptorImageInfo descriptorImageInfoLevel{};
+        descriptorImageInfoLevel.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoLevel.imageView = raymarchImages[i].view;
+        descriptorImageInfoLevel.sampler = VK_NULL_HANDLE;
+        mergeCascadesPipelines[i].WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoInput, nullptr, descriptorSlot);
+        mergeCascadesPipelines[i].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoOutput, nullptr, descriptorSlot);
+        mergeCascadesPipelines[i].WriteToDescriptorSet(0, 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoLevel, nullptr, descriptorSlot);
+        descriptorImageInfoInput.sampler = probeFilterSampler;
+        mergeCascadesPipelines[i].WriteToDescriptorSet(0, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                       &descriptorImageInfoInput, nullptr, descriptorSlot);
+    }
+
+    VkDescriptorImageInfo descriptorImageInfoOutputGI{};
+    descriptorImageInfoOutputGI.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoOutputGI.imageView = globalIlluminationImage.view;
+    descriptorImageInfoOutputGI.sampler = VK_NULL_HANDLE;
+    buildGITexturePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                &descriptorImageInfoOutputGI, nullptr, descriptorSlot);
+    accumulateBouncePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                  &descriptorImageInfoOutputGI, nullptr, descriptorSlot);
+
+    VkDescriptorImageInfo descriptorImageInfoBounce{};
+    descriptorImageInfoBounce.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoBounce.imageView = bounceImage.view;
+    descriptorImageInfoBounce.sampler = VK_NULL_HANDLE;
+    accumulateBouncePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                  &descriptorImageInfoBounce, nullptr, descriptorSlot);
+
+    VkDescriptorImageInfo descriptorImageInfoBounceSampler = descriptorImageInfoBounce;
+    descriptorImageInfoBounceSampler.sampler = linearSampler;
+    VkDescriptorImageInfo descriptorImageInfoAlbedoSampler{};
+    descriptorImageInfoAlbedoSampler.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoAlbedoSampler.imageView = albedoImage.view;
+    descriptorImageInfoAlbedoSampler.sampler = linearSampler;
+    for (auto &raymarchPipeline: raymarchPipelines) {
+        raymarchPipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                              &descriptorImageInfoBounceSampler, nullptr, descriptorSlot);
+        raymarchPipeline.WriteToDescriptorSet(0, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                              &descriptorImageInfoAlbedoSampler, nullptr, descriptorSlot);
+    }
+
+    VkDescriptorImageInfo descriptorImageInfoInputCascade{};
+    descriptorImageInfoInputCascade.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoInputCascade.imageView = GetMergedLevelImage(0).view;
+    descriptorImageInfoInputCascade.sampler = VK_NULL_HANDLE;
+    buildGITexturePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                &descriptorImageInfoInputCascade, nullptr, descriptorSlot);
+
+    // Without a level 1 there is nothing to merge and the fused pass is never used
+    if (radianceCascadeSettings.maxLevel > 1) {
+        VkDescriptorImageInfo descriptorImageInfoLevel1{};
+        descriptorImageInfoLevel1.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoLevel1.imageView = GetMergedLevelImage(1).view;
+        descriptorImageInfoLevel1.sampler = VK_NULL_HANDLE;
+        mergeCascadesToGIPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoLevel1, nullptr, descriptorSlot);
+        mergeCascadesToGIPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoInputCascade, nullptr, descriptorSlot);
+        mergeCascadesToGIPipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoOutputGI, nullptr, descriptorSlot);
+        descriptorImageInfoLevel1.sampler = probeFilterSampler;
+        mergeCascadesToGIPipeline.WriteToDescriptorSet(0, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                       &descriptorImageInfoLevel1, nullptr, descriptorSlot);
+        VkDescriptorImageInfo descriptorImageInfoLevel0{};
+        descriptorImageInfoLevel0.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        descriptorImageInfoLevel0.imageView = raymarchImages[0].view;
+        descriptorImageInfoLevel0.sampler = VK_NULL_HANDLE;
+        mergeCascadesToGIPipeline.WriteToDescriptorSet(0, 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                       &descriptorImageInfoLevel0, nullptr, descriptorSlot);
+    }
+
+    VkDescriptorImageInfo descriptorImageInfoInputGI{};
+    descriptorImageInfoInputGI.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoInputGI.imageView = globalIlluminationImage.view;
+    descriptorImageInfoInputGI.sampler = linearSampler;
+    for (Pipeline *pipeline: {&finalPassPipeline, &finalPassEdgeAwarePipeline}) {
+        pipeline->WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptorImageInfoInputGI,
+                                       nullptr, descriptorSlot);
+    }
+}
+
+// Compacts the cascade pool so the blocks emptied by the moves are released. Only the images just created move, the
+// GPU has not used them yet so they are recreated on their new memory without any copy. Retired images are left in
+// place for the frames still reading them. Descriptors must be written afterwards.
+void RadianceCascadeRenderer::DefragmentCascadePool() {
+    auto [cascadeWidth, cascadeHeight] = GetCascadeExtent();
+    VkImageCreateInfo imgCreateInfo = StorageImageCreateInfo({cascadeWidth, cascadeHeight}, cascadeFormat);
+    VkImageCreateInfo imgCreateInfoOutputGI = StorageImageCreateInfo({cascadeWidth / 2, cascadeHeight / 2},
+                                                                     cascadeFormat);
+
+    VmaDefragmentationInfo defragmentationInfo{};
+    defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT;
+    defragmentationInfo.pool = cascadePool;
+
+    VmaDefragmentationContext defragmentationContext;
+    VK_CHECK(vmaBeginDefragmentation(allocator, &defragmentationInfo, &defragmentationContext));
+
+    while (true) {
+        VmaDefragmentationPassMoveInfo passInfo;
+        VkResult result = vmaBeginDefragmentationPass(allocator, defragmentationContext, &passInfo);
+        if (result == VK_SUCCESS) {
+            break;
+        }
+        if (result != VK_INCOMPLETE) {
+            VK_CHECK(result);
+        }
+
+        for (uint32_t i = 0; i < passInfo.moveCount; i++) {
+            VmaDefragmentationMove &move = passInfo.pMoves[i];
+
+            Image *movedImage = nullptr;
+            const VkImageCreateInfo *movedImageCreateInfo = &imgCreateInfo;
+            for (auto *levelImages: {&raymarchImages, &mergedImages}) {
+                for (auto &levelImage: *levelImages) {
+                    if (levelImage.memory == move.srcAllocation) {
+                        movedImage = &levelImage;
+                    }
+                }
+            }
+            for (Image *giSizedImage: {&globalIlluminationImage, &bounceImage}) {
+                if (giSizedImage->memory == move.srcAllocation) {
+                    movedImage = giSizedImage;
+                    movedImageCreateInfo = &imgCreateInfoOutputGI;
+                }
+            }
+
+            if (movedImage == nullptr) {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            VkImage image;
+            VK_CHECK(vkCreateImage(device, movedImageCreateInfo, nullptr, &image));
+            VK_CHECK(vmaBindImageMemory(allocator, move.dstTmpAllocation, image));
+
+            // The allocation handle stays the same, VMA points it to the new memory when the pass ends
+            vkDestroyImageView(device, movedImage->view, nullptr);
+            vkDestroyImage(device, movedImage->image, nullptr);
+            movedImage->image = image;
+            movedImage->view = CreateImageView(device, image, *movedImageCreateInfo);
+        }
+
+        result = vmaEndDefragmentationPass(allocator, defragmentationContext, &passInfo);
+        if (result == VK_SUCCESS) {
+            break;
+        }
+        if (result != VK_INCOMPLETE) {
+            VK_CHECK(result);
+        }
+    }
+
+    vmaEndDefragmentation(allocator, defragmentationContext, nullptr);
+    UpdateMergedLevelImages();
+}
+
+void RadianceCascadeRenderer::BeginFrame() {
+    frameNumber++;
+    deletionQueue.Flush(frameNumber);
+
+    if (pendingConfiguration && frameNumber >= spareDescriptorSlotReleaseFrame) {
+        ApplyConfiguration(pendingRenderExtent, pendingSettings);
+    }
+}
+
+void RadianceCascadeRenderer::RecordInitCommands(VkCommandBuffer cmd) {
+    TransitionImage(cmd, sdfImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    TransitionImage(cmd, displayImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    TransitionImage(cmd, albedoImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    RecordClearAlbedo(cmd);
+
+    fillTextureFloat4Pipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+    FillTextureFloat4PushConstant pushConstant{};
+    // pushConstant.width = WINDOW_WIDTH;
+    // pushConstant.height = WINDOW_HEIGHT;
+    pushConstant.r = 0.0f;
+    pushConstant.g = 0.0f;
+    pushConstant.b = 0.0f;
+    pushConstant.a = 1000000.0f;
+
+    fillTextureFloat4Pipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+
+    fillTextureFloat4Pipeline.Dispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
+
+    // Images are freshly cleared, there is nothing to rescale
+    screenImagesRecreated = false;
+}
+
+// Only the bounding box of the segments is dispatched, every texel loops over all of them so overlapping segments
+// keep the nearest one like separate dabs would
+// Writes the segments and their bounding box into the slot of the frame recorded last. The slot was last read
+// framesInFlight frames ago, which BeginFrame guarantees is complete.
+VkRect2D RadianceCascadeRenderer::WriteBrushParameters(std::span<const BrushSegment> brushSegments) {
+    brushSegments = brushSegments.first(std::min<size_t>(brushSegments.size(), MAX_BRUSH_SEGMENTS));
+    uint32_t slot = frameNumber % framesInFlight;
+
+    float minX = renderExtent.width, minY = renderExtent.height, maxX = 0.0f, maxY = 0.0f;
+    for (const auto &segment: brushSegments) {
+        minX = std::min({minX, segment.startX - segment.radius, segment.endX - segment.radius});
+        minY = std::min({minY, segment.startY - segment.radius, segment.endY - segment.radius});
+        maxX = std::max({maxX, segment.startX + segment.radius, segment.endX + segment.radius});
+        maxY = std::max({maxY, segment.startY + segment.radius, segment.endY + segment.radius});
+    }
+
+    int32_t originX = std::max(0, (int32_t) std::floor(minX));
+    int32_t originY = std::max(0, (int32_t) std::floor(minY));
+    int32_t endX = std::min((int32_t) renderExtent.width, (int32_t) std::ceil(maxX) + 1);
+    int32_t endY = std::min((int32_t) renderExtent.height, (int32_t) std::ceil(maxY) + 1);
+
+    BrushParameters parameters{};
+    parameters.originX = originX;
+    parameters.originY = originY;
+    parameters.segmentOffset = slot * MAX_BRUSH_SEGMENTS;
+    parameters.segmentCount = brushSegments.size();
+    VkRect2D region{};
+    // No segments, or all of them outside the SDF: an empty dispatch
+    if (!brushSegments.empty() && originX < endX && originY < endY) {
+        parameters.groupCount = {(uint32_t) (endX - originX + 7) / 8, (uint32_t) (endY - originY + 7) / 8, 1};
+        region = {{originX, originY}, {(uint32_t) (endX - originX), (uint32_t) (endY - originY)}};
+    }
+
+    std::copy(brushSegments.begin(), brushSegments.end(),
+              static_cast<BrushSegment *>(brushSegmentBuffer.mapped) + parameters.segmentOffset);
+    VK_CHECK(vmaFlushAllocation(allocator, brushSegmentBuffer.memory, parameters.segmentOffset * sizeof(BrushSegment),
+                                brushSegments.size() * sizeof(BrushSegment)));
+
+    static_cast<BrushParameters *>(brushParameterBuffer.mapped)[slot] = parameters;
+    VK_CHECK(vmaFlushAllocation(allocator, brushParameterBuffer.memory, slot * sizeof(BrushParameters),
+                                sizeof(BrushParameters)));
+
+    return region;
+}
+
+void RadianceCascadeRenderer::LatchBrushSegments(std::span<const BrushSegment> brushSegments) {
+    // Host writes made before the submit are visible to it, no barrier needed
+    // The frame was recorded for the region of the segments it replaces
+    lateBrushRegion = UnionRect(lateBrushRegion, WriteBrushParameters(brushSegments));
+}
+
+// Always recorded, the dispatch size is only known once the segments are latched
+VkRect2D RadianceCascadeRenderer::RecordBrushCommands(VkCommandBuffer cmd, std::span<const BrushSegment> brushSegments,
+                                                      GpuTimer &gpuTimer) {
+    VkRect2D region = WriteBrushParameters(brushSegments);
+
+    DrawToSDFTexturePushConstant pushConstant{};
+    pushConstant.parameterIndex = frameNumber % framesInFlight;
+
+    gpuTimer.BeginPass(cmd, "Draw to SDF");
+    drawToSDFTexturePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+
+    drawToSDFTexturePipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+
+    vkCmdDispatchIndirect(cmd, brushParameterBuffer.buffer, pushConstant.parameterIndex * sizeof(BrushParameters));
+    gpuTimer.EndPass(cmd);
+
+    return region;
+}
+
+void RadianceCascadeRenderer::SetMultiBounce(const MultiBounceSettings &settings) {
+    if (settings.enabled && !multiBounce.enabled) {
+        bounceInvalid = true;
+    }
+    multiBounce = settings;
+}
+
+void RadianceCascadeRenderer::SetTemporal(const TemporalSettings &settings) {
+    bool keptHistory = KeepsHistory();
+    temporal = settings;
+    temporal.period = std::max(temporal.period, 1u);
+
+    if (KeepsHistory() != keptHistory) {
+        // Keep a configuration that is still waiting for the frames in flight
+        SetConfiguration(pendingConfiguration ? pendingRenderExtent : renderExtent,
+                         pendingConfiguration ? pendingSettings : radianceCascadeSettings);
+    }
+}
+
+void RadianceCascadeRenderer::SetCascadeLayout(CascadeLayout layout) {
+    if (layout != cascadeLayout) {
+        levelTraceCounts = {};
+        scheduleFrame = 0;
+    }
+    cascadeLayout = layout;
+}
+
+void RadianceCascadeRenderer::SetLevelSchedule(const LevelScheduleSettings &settings) {
+    bool keptHistory = KeepsHistory();
+    levelSchedule = settings;
+    levelSchedule.maxInterval = std::max(levelSchedule.maxInterval, 1u);
+
+    if (KeepsHistory() != keptHistory) {
+        SetConfiguration(pendingConfiguration ? pendingRenderExtent : renderExtent,
+                         pendingConfiguration ? pendingSettings : radianceCascadeSettings);
+    }
+}
+
+uint32_t RadianceCascadeRenderer::GetLevelInterval(uint32_t level) const {
+    if (!levelSchedule.enabled || level < levelSchedule.firstStaggeredLevel) {
+        return 1;
+    }
+    uint32_t doublings = std::min(level - levelSchedule.firstStaggeredLevel + 1, 31u);
+    return std::min(1u << doublings, levelSchedule.maxInterval);
+}
+
+void RadianceCascadeRenderer::RecordClearBounce(VkCommandBuffer cmd) {
+    VkClearColorValue clearColor{};
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdClearColorImage(cmd, bounceImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void RadianceCascadeRenderer::RecordClearAlbedo(VkCommandBuffer cmd) {
+    VkClearColorValue clearColor{};
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdClearColorImage(cmd, albedoImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+// Every texel of the SDF is evaluated, the grid keeps the work per texel to the primitives near its cell
+void RadianceCascadeRenderer::RecordSceneCommands(VkCommandBuffer cmd, GpuTimer &gpuTimer) {
+    if (!sceneDirty) {
+        return;
+    }
+    sceneDirty = false;
+
+    // The copy of this frame was last bound framesInFlight frames ago, which BeginFrame guarantees is complete
+    uint32_t copy = frameNumber % framesInFlight;
+
+    VkDescriptorImageInfo descriptorImageInfoSDFImage{};
+    descriptorImageInfoSDFImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoSDFImage.imageView = sdfImage.view;
+    descriptorImageInfoSDFImage.sampler = VK_NULL_HANDLE;
+    evaluateSceneSDFPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                  &descriptorImageInfoSDFImage, nullptr, copy);
+
+    VkDescriptorImageInfo descriptorImageInfoAlbedoImage{};
+    descriptorImageInfoAlbedoImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoAlbedoImage.imageView = albedoImage.view;
+    descriptorImageInfoAlbedoImage.sampler = VK_NULL_HANDLE;
+    evaluateSceneSDFPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                  &descriptorImageInfoAlbedoImage, nullptr, copy);
+
+    uint32_t binding = 2;
+    for (const Buffer &sceneBuffer: {scenePrimitiveBuffer, scenePointBuffer, sceneCellRangeBuffer,
+                                     sceneCellPrimitiveBuffer}) {
+        VkDescriptorBufferInfo descriptorBufferInfo{};
+        descriptorBufferInfo.buffer = sceneBuffer.buffer;
+        descriptorBufferInfo.offset = 0;
+        descriptorBufferInfo.range = VK_WHOLE_SIZE;
+        evaluateSceneSDFPipeline.WriteToDescriptorSet(0, binding++, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+                                                      &descriptorBufferInfo, copy);
+    }
+
+    EvaluateSceneSDFPushConstant pushConstant{};
+    pushConstant.gridOriginX = sceneGrid.origin.x;
+    pushConstant.gridOriginY = sceneGrid.origin.y;
+    pushConstant.cellSize = sceneGrid.cellSize;
+    pushConstant.band = sceneGrid.band;
+    pushConstant.columns = sceneGrid.columns;
+    pushConstant.rows = sceneGrid.rows;
+    pushConstant.scale = renderExtent.height;
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    gpuTimer.BeginPass(cmd, "Evaluate scene");
+    evaluateSceneSDFPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+    evaluateSceneSDFPipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+    evaluateSceneSDFPipeline.Dispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
+    gpuTimer.EndPass(cmd);
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void RadianceCascadeRenderer::FillLevelPushConstants(bool restartHistory, VkRect2D changedRegion) {
+    // The history follows the modes once the cascade images are recreated
+    bool useHistory = raymarchesKept;
+
+    if (restartHistory || !useHistory) {
+        levelTraceCounts = {};
+        scheduleFrame = 0;
+    }
+
+    // A full trace already covers the region
+    bool traceRegion = useHistory && !restartHistory && changedRegion.extent.width > 0 &&
+                       changedRegion.extent.height > 0;
+
+    auto [cascadeWidth, cascadeHeight] = GetCascadeExtent();
+    // RayCorrection scales the X of the probe origins and of the ray directions by this around the middle of the SDF
+    float correction = ((float) cascadeWidth / cascadeHeight) / ((float) renderExtent.width / renderExtent.height);
+    // Distance from its probe the last sample of a ray of the level can be at, in SDF uv where the height is 1
+    float reach = 0.0f;
+
+    for (uint32_t level = 0; level < radianceCascadeSettings.maxLevel; level++) {
+        reach += radianceCascadeSettings.radius * std::pow(radianceCascadeSettings.radiusMultiplier, (float) level);
+
+        RaymarchPushConstant &pushConstant = levelPushConstants[level];
+        pushConstant = {};
+        pushConstant.radianceCascadeSettings = radianceCascadeSettings;
+        pushConstant.currentLevel = level;
+        pushConstant.multiBounce = multiBounce.enabled;
+        pushConstant.paintedAlbedo = multiBounce.paintedAlbedo;
+        pushConstant.temporal = useHistory;
+        pushConstant.temporalPeriod = 1;
+        pushConstant.temporalPhase = 0;
+        pushConstant.jitter = 0.5f;
+        pushConstant.historyBlend = 1.0f;
+        pushConstant.cascadeLayout = cascadeLayout;
+        pushConstant.forcedProbeMinX = 0;
+        pushConstant.forcedProbeMinY = 0;
+        pushConstant.forcedProbeMaxX = -1;
+        pushConstant.forcedProbeMaxY = -1;
+        levelTraced[level] = true;
+
+        if (!useHistory) {
+            continue;
+        }
+
+        if (traceRegion) {
+            float probeCountX = (float) (cascadeWidth >> (level + 1));
+            float probeCountY = (float) (cascadeHeight >> (level + 1));
+            // The region in SDF uv, widened by the reach and by a texel for the point sampling
+            float minU = (changedRegion.offset.x - 1.0f) / renderExtent.width - reach * correction;
+            float maxU = (changedRegion.offset.x + changedRegion.extent.width + 1.0f) / renderExtent.width +
+                         reach * correction;
+            float minV = (changedRegion.offset.y - 1.0f) / renderExtent.height - reach;
+            float maxV = (changedRegion.offset.y + changedRegion.extent.height + 1.0f) / renderExtent.height + reach;
+            // Probes whose corrected origin, at (probe + 0.5) / probe count, is inside
+            float minProbeX = ((minU - .5f) / correction + .5f) * probeCountX - .5f;
+            float maxProbeX = ((maxU - .5f) / correction + .5f) * probeCountX - .5f;
+            pushConstant.forcedProbeMinX = (int32_t) std::clamp(std::floor(minProbeX), 0.0f, probeCountX - 1);
+            pushConstant.forcedProbeMinY = (int32_t) std::clamp(std::floor(minV * probeCountY - .5f), 0.0f,
+                                                                probeCountY - 1);
+            pushConstant.forcedProbeMaxX = (int32_t) std::clamp(std::ceil(maxProbeX), 0.0f, probeCountX - 1);
+            pushConstant.forcedProbeMaxY = (int32_t) std::clamp(std::ceil(maxV * probeCountY - .5f), 0.0f,
+                                                                probeCountY - 1);
+        }
+
+        // Every level is traced after a restart
+        bool traced = scheduleFrame == 0 || (scheduleFrame + level) % GetLevelInterval(level) == 0;
+        if (!traced) {
+            if (traceRegion) {
+                // Dispatched for the region only, no workgroup index modulo 1 matches phase 1
+                pushConstant.temporalPhase = 1;
+                continue;
+            }
+            // Not dispatched, its raymarch image still holds the last one
+            levelTraced[level] = false;
+            continue;
+        }
+
+        uint32_t traceCount = levelTraceCounts[level]++;
+        if (temporal.enabled && traceCount > 0) {
+            pushConstant.temporalPeriod = temporal.period;
+            pushConstant.temporalPhase = traceCount % temporal.period;
+            // Results the texels traced this frame already hold, a running average until the minimum blend is reached
+            uint32_t samples = (traceCount - 1) / temporal.period + 1;
+            pushConstant.historyBlend = std::max(1.0f / (samples + 1), temporal.minimumBlend);
+            // Golden ratio sequence, every sample of a texel gets a new angle evenly spread from the previous ones
+            float jitter = 0.5f + samples * 0.618034f;
+            pushConstant.jitter = jitter - std::floor(jitter);
+        }
+    }
+
+    if (useHistory) {
+        scheduleFrame++;
+    }
+}
+
+// Fills one cascade level, from the SDF or from the scene outline. Touches nothing but the level's own pipeline and
+// image, so the levels can be recorded from different threads.
+void RadianceCascadeRenderer::RecordTraceLevel(VkCommandBuffer cmd, uint32_t level, bool raycast) {
+    auto [cascadeWidth, cascadeHeight] = GetCascadeExtent();
+
+    if (!raycast) {
+        if (!levelTraced[level]) {
+            return;
+        }
+
+        raymarchPipelines[level].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        raymarchPipelines[level].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &levelPushConstants[level]);
+        raymarchPipelines[level].Dispatch(cmd, cascadeWidth / 8, cascadeHeight / 8, 1);
+        return;
+    }
+
+    // The cost follows the segments near each ray instead of its length
+    uint32_t copy = frameNumber % framesInFlight;
+    Pipeline &pipeline = raycastSegmentsPipelines[level];
+
+    VkDescriptorImageInfo descriptorImageInfoSDFImageSampler{};
+    descriptorImageInfoSDFImageSampler.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoSDFImageSampler.imageView = sdfImage.view;
+    descriptorImageInfoSDFImageSampler.sampler = linearSampler;
+
+    VkDescriptorImageInfo descriptorImageInfo{};
+    descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfo.imageView = raymarchImages[level].view;
+    descriptorImageInfo.sampler = VK_NULL_HANDLE;
+    pipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                  &descriptorImageInfoSDFImageSampler, nullptr, copy);
+    pipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfo, nullptr, copy);
+
+    uint32_t binding = 2;
+    for (const Buffer &sceneBuffer: {sceneSegmentBuffer, sceneSegmentCellRangeBuffer, sceneSegmentCellBuffer}) {
+        VkDescriptorBufferInfo descriptorBufferInfo{};
+        descriptorBufferInfo.buffer = sceneBuffer.buffer;
+        descriptorBufferInfo.offset = 0;
+        descriptorBufferInfo.range = VK_WHOLE_SIZE;
+        pipeline.WriteToDescriptorSet(0, binding++, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+                                      &descriptorBufferInfo, copy);
+    }
+
+    RaycastSegmentsPushConstant pushConstant{};
+    pushConstant.radianceCascadeSettings = radianceCascadeSettings;
+    pushConstant.currentLevel = level;
+    pushConstant.gridOriginX = sceneSegmentGrid.origin.x;
+    pushConstant.gridOriginY = sceneSegmentGrid.origin.y;
+    pushConstant.cellSize = sceneSegmentGrid.cellSize;
+    pushConstant.columns = sceneSegmentGrid.columns;
+    pushConstant.rows = sceneSegmentGrid.rows;
+    pushConstant.cascadeLayout = cascadeLayout;
+
+    pipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+    pipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+    pipeline.Dispatch(cmd, cascadeWidth / 8, cascadeHeight / 8, 1);
+}
+
+void RadianceCascadeRenderer::RecordFrameCommands(VkCommandBuffer cmd, std::span<const BrushSegment> brushSegments,
+                                                  bool resetSDF, GpuTimer &gpuTimer) {
+    // The history no longer matches the SDF anywhere, this frame traces every texel of every level. Brush strokes only
+    // retrace the probes that can see them.
+    bool sdfReplaced = screenImagesRecreated || resetSDF || sceneDirty;
+    VkRect2D changedRegion = lateBrushRegion;
+    lateBrushRegion = {};
+
+    if (screenImagesRecreated) {
+        // Frames still in flight may be drawing into the previous SDF
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        TransitionImage(cmd, sdfImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        TransitionImage(cmd, displayImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        TransitionImage(cmd, albedoImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        RecordClearAlbedo(cmd);
+
+        // Carry the drawn SDF over to the new resolution
+        float distanceScale = std::min((float) renderExtent.width / previousSDFExtent.width,
+                                       (float) renderExtent.height / previousSDFExtent.height);
+
+        gpuTimer.BeginPass(cmd, "Rescale SDF");
+        rescaleSDFTexturePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        rescaleSDFTexturePipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &distanceScale);
+        rescaleSDFTexturePipeline.Dispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
+        gpuTimer.EndPass(cmd);
+
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        screenImagesRecreated = false;
+        RetireImage(previousSDFImage);
+        previousSDFImage = {};
+    }
+
+    changedRegion = UnionRect(changedRegion, RecordBrushCommands(cmd, brushSegments, gpuTimer));
+
+    if (resetSDF) {
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        fillTextureFloat4Pipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        FillTextureFloat4PushConstant fillTextureFloat4PushConstant{};
+        fillTextureFloat4PushConstant.r = 0.0f;
+        fillTextureFloat4PushConstant.g = 0.0f;
+        fillTextureFloat4PushConstant.b = 0.0f;
+        fillTextureFloat4PushConstant.a = 1000000.0f;
+
+        fillTextureFloat4Pipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &fillTextureFloat4PushConstant);
+
+        fillTextureFloat4Pipeline.Dispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
+
+        RecordClearAlbedo(cmd);
+        // The light of the old surfaces would keep bouncing off the new ones
+        bounceInvalid = true;
+        // Back to the loaded scene, not to an empty SDF
+        sceneDirty = scenePrimitiveBuffer.Initialized();
+    }
+
+    RecordSceneCommands(cmd, gpuTimer);
+
+    if (raymarchImageLayout != VK_IMAGE_LAYOUT_GENERAL) {
+        for (auto &raymarchImage: raymarchImages) {
+            TransitionImage(cmd, raymarchImage.image, raymarchImageLayout, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        for (auto &mergedImage: mergedImages) {
+            TransitionImage(cmd, mergedImage.image, raymarchImageLayout, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        raymarchImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    if (outputGIImageLayout != VK_IMAGE_LAYOUT_GENERAL) {
+        TransitionImage(cmd, globalIlluminationImage.image, outputGIImageLayout, VK_IMAGE_LAYOUT_GENERAL);
+        TransitionImage(cmd, bounceImage.image, outputGIImageLayout, VK_IMAGE_LAYOUT_GENERAL);
+        outputGIImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    if (multiBounce.enabled && bounceInvalid) {
+        RecordClearBounce(cmd);
+        bounceInvalid = false;
+    }
+
+    // The brush, the scene and the bounce accumulated by the previous frame are read by the tracing
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    auto [cascadeWidth, cascadeHeight] = GetCascadeExtent();
+
+    bool raycast = traceMode == RAYCAST_SEGMENTS && sceneSegmentBuffer.Initialized();
+    const char *traceName = raycast ? "Raycast" : "Raymarch";
+
+    if (raycast) {
+        // Raycasting replaces the kept raymarches, every level is traced again in full when raymarching resumes
+        levelTraceCounts = {};
+        scheduleFrame = 0;
+    } else {
+        FillLevelPushConstants(sdfReplaced, changedRegion);
+    }
+
+    // The levels do not depend on each other, no barrier between them
+    if (commandRecorder != nullptr) {
+        // Timed as a whole, the timer is not shared between threads
+        gpuTimer.BeginPass(cmd, std::format("{} levels", traceName));
+        auto levelCommands = commandRecorder->RecordSecondary(
+            radianceCascadeSettings.maxLevel,
+            [&](uint32_t level, VkCommandBuffer levelCmd) { RecordTraceLevel(levelCmd, level, raycast); });
+        vkCmdExecuteCommands(cmd, levelCommands.size(), levelCommands.data());
+        gpuTimer.EndPass(cmd);
+    } else {
+        for (int i = 0; i < radianceCascadeSettings.maxLevel; i++) {
+            if (!raycast && !levelTraced[i]) {
+                continue;
+            }
+            gpuTimer.BeginPass(cmd, std::format("{} level {}", traceName, i));
+            RecordTraceLevel(cmd, i, raycast);
+            gpuTimer.EndPass(cmd);
+        }
+    }
+
+    MergeCascadesPushConstant mergeCascadesPushConstant{};
+    mergeCascadesPushConstant.radianceCascadeSettings = radianceCascadeSettings;
+    mergeCascadesPushConstant.cascadeLayout = cascadeLayout;
+    mergeCascadesPushConstant.filterProbes = cascadeFilterSupported;
+
+    bool fuseGI = fusedGIMerge && radianceCascadeSettings.maxLevel > 1;
+    int lastMergeLevel = fuseGI ? 1 : 0;
+
+    for (int i = radianceCascadeSettings.maxLevel - 2; i >= lastMergeLevel; i--) {
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        mergeCascadesPushConstant.outputLevel = i;
+        gpuTimer.BeginPass(cmd, std::format("Merge level {}", i));
+        mergeCascadesPipelines[i].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        mergeCascadesPipelines[i].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &mergeCascadesPushConstant);
+        mergeCascadesPipelines[i].Dispatch(cmd, cascadeWidth / 8, cascadeHeight / 8, 1);
+        gpuTimer.EndPass(cmd);
+    }
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (fuseGI) {
+        gpuTimer.BeginPass(cmd, "Merge level 0 to GI");
+        mergeCascadesToGIPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        MergeCascadesToGIPushConstant mergeCascadesToGIPushConstant{cascadeLayout, cascadeFilterSupported};
+        mergeCascadesToGIPipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &mergeCascadesToGIPushConstant);
+        mergeCascadesToGIPipeline.Dispatch(cmd, cascadeWidth / 16, cascadeHeight / 16, 1);
+        gpuTimer.EndPass(cmd);
+    } else {
+        gpuTimer.BeginPass(cmd, "Build GI texture");
+        buildGITexturePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        buildGITexturePipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &cascadeLayout);
+
+        buildGITexturePipeline.Dispatch(cmd, cascadeWidth / 16, cascadeHeight / 16, 1);
+        gpuTimer.EndPass(cmd);
+    }
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Read by the next frame's raymarch, the final pass does not need to wait for it
+    if (multiBounce.enabled) {
+        gpuTimer.BeginPass(cmd, "Accumulate bounce");
+        accumulateBouncePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+        accumulateBouncePipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &multiBounce.blend);
+        accumulateBouncePipeline.Dispatch(cmd, (cascadeWidth / 2 + 7) / 8, (cascadeHeight / 2 + 7) / 8, 1);
+        gpuTimer.EndPass(cmd);
+    }
+
+    gpuTimer.BeginPass(cmd, "Final pass");
+    Pipeline &finalPass = giUpsampling == SDF_GUIDED ? finalPassEdgeAwarePipeline : finalPassPipeline;
+    finalPass.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, descriptorSlot);
+
+    finalPass.Dispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
+    gpuTimer.EndPass(cmd);
+}
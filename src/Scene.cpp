@@ -0,0 +1,367 @@
+#include <Scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <print>
+#include <sstream>
+
+void Scene::AddPrimitive(PrimitiveType type, const std::vector<ScenePoint> &points, float radius,
+                         const SceneMaterial &material) {
+    Primitive primitive{};
+    primitive.type = type;
+    primitive.pointOffset = m_points.size();
+    primitive.pointCount = points.size();
+    primitive.radius = radius;
+    std::copy_n(material.emission, 3, primitive.emission);
+    std::copy_n(material.albedo, 3, primitive.albedo);
+    // Marks the texels the scene owns in the albedo image
+    primitive.albedo[3] = 1.0f;
+
+    m_primitives.push_back(primitive);
+    m_points.insert(m_points.end(), points.begin(), points.end());
+}
+
+void Scene::AddCircle(ScenePoint center, float radius, const SceneMaterial &material) {
+    AddPrimitive(CIRCLE, {center}, radius, material);
+}
+
+void Scene::AddBox(ScenePoint center, ScenePoint halfExtents, const SceneMaterial &material) {
+    AddPrimitive(BOX, {center, halfExtents}, 0.0f, material);
+}
+
+void Scene::AddCapsule(ScenePoint start, ScenePoint end, float radius, const SceneMaterial &material) {
+    AddPrimitive(CAPSULE, {start, end}, radius, material);
+}
+
+void Scene::AddPolygon(const std::vector<ScenePoint> &points, const SceneMaterial &material) {
+    AddPrimitive(POLYGON, points, 0.0f, material);
+}
+
+void Scene::AddBezier(ScenePoint start, ScenePoint control, ScenePoint end, float thickness,
+                      const SceneMaterial &material) {
+    AddPrimitive(BEZIER, {start, control, end}, thickness, material);
+}
+
+bool Scene::Load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::print("Failed to open scene {}\n", path);
+        return false;
+    }
+
+    Scene scene;
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+
+        std::string type;
+        if (!(stream >> type)) {
+            continue;
+        }
+
+        std::vector<ScenePoint> points;
+        auto readPoints = [&](uint32_t count) {
+            for (uint32_t i = 0; i < count; i++) {
+                ScenePoint point{};
+                stream >> point.x >> point.y;
+                points.push_back(point);
+            }
+        };
+
+        float radius = 0.0f;
+        PrimitiveType primitiveType;
+        if (type == "circle") {
+            primitiveType = CIRCLE;
+            readPoints(1);
+            stream >> radius;
+        } else if (type == "box") {
+            primitiveType = BOX;
+            readPoints(2);
+        } else if (type == "capsule") {
+            primitiveType = CAPSULE;
+            readPoints(2);
+            stream >> radius;
+        } else if (type == "polygon") {
+            primitiveType = POLYGON;
+            uint32_t count = 0;
+            stream >> count;
+            if (count < 3 || count > 4096) {
+                std::print("{}:{}: polygon needs between 3 and 4096 points\n", path, lineNumber);
+                return false;
+            }
+            readPoints(count);
+        } else if (type == "bezier") {
+            primitiveType = BEZIER;
+            readPoints(3);
+            stream >> radius;
+        } else {
+            std::print("{}:{}: unknown primitive '{}'\n", path, lineNumber, type);
+            return false;
+        }
+
+        SceneMaterial material{};
+        std::string emissionKeyword, albedoKeyword;
+        stream >> emissionKeyword >> material.emission[0] >> material.emission[1] >> material.emission[2]
+                >> albedoKeyword >> material.albedo[0] >> material.albedo[1] >> material.albedo[2];
+
+        if (!stream || emissionKeyword != "emission" || albedoKeyword != "albedo") {
+            std::print("{}:{}: malformed {}\n", path, lineNumber, type);
+            return false;
+        }
+
+        scene.AddPrimitive(primitiveType, points, radius, material);
+    }
+
+    *this = std::move(scene);
+    return true;
+}
+
+Scene Scene::CreateDemo() {
+    constexpr SceneMaterial WALL{{0.0f, 0.0f, 0.0f}, {0.8f, 0.8f, 0.8f}};
+
+    Scene scene;
+    scene.AddCircle({0.25f, 0.25f}, 0.05f, {{1.0f, 0.6f, 0.2f}, {1.0f, 1.0f, 1.0f}});
+    scene.AddCapsule({1.1f, 0.85f}, {1.4f, 0.85f}, 0.015f, {{0.2f, 0.5f, 1.0f}, {1.0f, 1.0f, 1.0f}});
+    scene.AddBezier({0.2f, 0.9f}, {0.5f, 0.6f}, {0.8f, 0.9f}, 0.01f, {{0.3f, 1.0f, 0.4f}, {1.0f, 1.0f, 1.0f}});
+
+    scene.AddBox({0.6f, 0.35f}, {0.15f, 0.02f}, WALL);
+    scene.AddBox({0.9f, 0.55f}, {0.02f, 0.2f}, WALL);
+    scene.AddPolygon({{1.2f, 0.2f}, {1.45f, 0.3f}, {1.35f, 0.5f}, {1.25f, 0.38f}, {1.1f, 0.45f}}, WALL);
+    scene.AddCircle({0.45f, 0.65f}, 0.06f, WALL);
+
+    return scene;
+}
+
+Scene::Grid Scene::BuildGrid(uint32_t cellsPerUnit, uint32_t bandCells) const {
+    // Bézier curves lie within the hull of their control points
+    std::vector<Bounds> primitiveBounds;
+    for (const auto &primitive: m_primitives) {
+        Bounds bounds{{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+        if (primitive.type == BOX) {
+            ScenePoint center = m_points[primitive.pointOffset];
+            ScenePoint halfExtents = m_points[primitive.pointOffset + 1];
+            bounds = {{center.x - halfExtents.x, center.y - halfExtents.y},
+                      {center.x + halfExtents.x, center.y + halfExtents.y}};
+        } else {
+            for (uint32_t i = 0; i < primitive.pointCount; i++) {
+                ScenePoint point = m_points[primitive.pointOffset + i];
+                bounds.min = {std::min(bounds.min.x, point.x - primitive.radius),
+                              std::min(bounds.min.y, point.y - primitive.radius)};
+                bounds.max = {std::max(bounds.max.x, point.x + primitive.radius),
+                              std::max(bounds.max.y, point.y + primitive.radius)};
+            }
+        }
+
+        primitiveBounds.push_back(bounds);
+    }
+
+    return BuildGrid(primitiveBounds, cellsPerUnit, bandCells, [](uint32_t, const Bounds &) { return true; });
+}
+
+std::vector<Scene::Segment> Scene::BuildSegments(float tolerance) const {
+    std::vector<Segment> segments;
+
+    for (const auto &primitive: m_primitives) {
+        auto point = [&](uint32_t i) { return m_points[primitive.pointOffset + i]; };
+        auto addSegment = [&](ScenePoint start, ScenePoint end) {
+            segments.push_back({start.x, start.y, end.x, end.y,
+                                {primitive.emission[0], primitive.emission[1], primitive.emission[2], 0.0f}});
+        };
+        auto addPolyline = [&](const std::vector<ScenePoint> &points, bool closed) {
+            for (size_t i = 0; i + 1 < points.size(); i++) {
+                addSegment(points[i], points[i + 1]);
+            }
+            if (closed && points.size() > 2) {
+                addSegment(points.back(), points.front());
+            }
+        };
+        // Counter clockwise arc, the chord error of n segments over a sweep is r (1 - cos(sweep / 2n))
+        auto appendArc = [&](std::vector<ScenePoint> &points, ScenePoint center, float radius, float startAngle,
+                             float sweep) {
+            float maxStep = 2.0f * std::acos(std::max(-1.0f, 1.0f - tolerance / radius));
+            uint32_t count = std::clamp((uint32_t) std::ceil(sweep / maxStep), 2u, 256u);
+            for (uint32_t i = 0; i <= count; i++) {
+                float angle = startAngle + sweep * i / count;
+                points.push_back({center.x + radius * std::cos(angle), center.y + radius * std::sin(angle)});
+            }
+        };
+
+        switch (primitive.type) {
+            case CIRCLE: {
+                std::vector<ScenePoint> outline;
+                appendArc(outline, point(0), primitive.radius, 0.0f, 2.0f * std::numbers::pi_v<float>);
+                outline.pop_back();
+                addPolyline(outline, true);
+                break;
+            }
+            case BOX: {
+                ScenePoint center = point(0);
+                ScenePoint halfExtents = point(1);
+                addPolyline({{center.x - halfExtents.x, center.y - halfExtents.y},
+                             {center.x + halfExtents.x, center.y - halfExtents.y},
+                             {center.x + halfExtents.x, center.y + halfExtents.y},
+                             {center.x - halfExtents.x, center.y + halfExtents.y}}, true);
+                break;
+            }
+            case CAPSULE: {
+                ScenePoint start = point(0);
+                ScenePoint end = point(1);
+                if (primitive.radius <= 0.0f) {
+                    addSegment(start, end);
+                    break;
+                }
+                // Half circle around each end, the closing edges are the straight sides
+                float angle = std::atan2(end.y - start.y, end.x - start.x);
+                float halfTurn = std::numbers::pi_v<float>;
+                std::vector<ScenePoint> outline;
+                appendArc(outline, end, primitive.radius, angle - halfTurn / 2, halfTurn);
+                appendArc(outline, start, primitive.radius, angle + halfTurn / 2, halfTurn);
+                addPolyline(outline, true);
+                break;
+            }
+            case POLYGON: {
+                std::vector<ScenePoint> outline(m_points.begin() + primitive.pointOffset,
+                                                m_points.begin() + primitive.pointOffset + primitive.pointCount);
+                addPolyline(outline, true);
+                break;
+            }
+            case BEZIER: {
+                ScenePoint a = point(0), b = point(1), c = point(2);
+                // The chord error of n uniform steps is |a - 2b + c| / 4n²
+                float curvature = std::hypot(a.x - 2 * b.x + c.x, a.y - 2 * b.y + c.y);
+                uint32_t count = std::clamp((uint32_t) std::ceil(std::sqrt(curvature / (4.0f * tolerance))), 1u, 64u);
+
+                std::vector<ScenePoint> left, right;
+                for (uint32_t i = 0; i <= count; i++) {
+                    float t = (float) i / count;
+                    ScenePoint p{(1 - t) * (1 - t) * a.x + 2 * (1 - t) * t * b.x + t * t * c.x,
+                                 (1 - t) * (1 - t) * a.y + 2 * (1 - t) * t * b.y + t * t * c.y};
+                    ScenePoint tangent{(1 - t) * (b.x - a.x) + t * (c.x - b.x), (1 - t) * (b.y - a.y) + t * (c.y - b.y)};
+                    float length = std::hypot(tangent.x, tangent.y);
+                    if (length == 0.0f) {
+                        tangent = {c.x - a.x, c.y - a.y};
+                        length = std::max(std::hypot(tangent.x, tangent.y), 1e-12f);
+                    }
+                    ScenePoint normal{-tangent.y / length * primitive.radius, tangent.x / length * primitive.radius};
+                    left.push_back({p.x + normal.x, p.y + normal.y});
+                    right.push_back({p.x - normal.x, p.y - normal.y});
+                }
+
+                if (primitive.radius <= 0.0f) {
+                    addPolyline(left, false);
+                    break;
+                }
+                // Square caps, the outline goes down one side and back up the other
+                left.insert(left.end(), right.rbegin(), right.rend());
+                addPolyline(left, true);
+                break;
+            }
+        }
+    }
+
+    return segments;
+}
+
+Scene::Grid Scene::BuildSegmentGrid(const std::vector<Segment> &segments, uint32_t cellsPerUnit) {
+    std::vector<Bounds> segmentBounds;
+    for (const auto &segment: segments) {
+        segmentBounds.push_back({{std::min(segment.startX, segment.endX), std::min(segment.startY, segment.endY)},
+                                 {std::max(segment.startX, segment.endX), std::max(segment.startY, segment.endY)}});
+    }
+
+    // Slab test of the segment against the cell, so long diagonals only land in the cells they cross
+    return BuildGrid(segmentBounds, cellsPerUnit, 0, [&](uint32_t index, const Bounds &cell) {
+        const Segment &segment = segments[index];
+        float tMin = 0.0f, tMax = 1.0f;
+        float start[2] = {segment.startX, segment.startY};
+        float delta[2] = {segment.endX - segment.startX, segment.endY - segment.startY};
+        float cellMin[2] = {cell.min.x, cell.min.y};
+        float cellMax[2] = {cell.max.x, cell.max.y};
+        for (int axis = 0; axis < 2; axis++) {
+            if (std::abs(delta[axis]) < 1e-12f) {
+                if (start[axis] < cellMin[axis] || start[axis] > cellMax[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float t0 = (cellMin[axis] - start[axis]) / delta[axis];
+            float t1 = (cellMax[axis] - start[axis]) / delta[axis];
+            tMin = std::max(tMin, std::min(t0, t1));
+            tMax = std::min(tMax, std::max(t0, t1));
+        }
+        return tMin <= tMax;
+    });
+}
+
+Scene::Grid Scene::BuildGrid(const std::vector<Bounds> &itemBounds, uint32_t cellsPerUnit, uint32_t bandCells,
+                             const std::function<bool(uint32_t, const Bounds &)> &overlaps) {
+    Grid grid{};
+    if (itemBounds.empty()) {
+        return grid;
+    }
+
+    Bounds sceneBounds{{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+    for (const auto &bounds: itemBounds) {
+        sceneBounds.min = {std::min(sceneBounds.min.x, bounds.min.x), std::min(sceneBounds.min.y, bounds.min.y)};
+        sceneBounds.max = {std::max(sceneBounds.max.x, bounds.max.x), std::max(sceneBounds.max.y, bounds.max.y)};
+    }
+
+    // Coarser cells for scenes much larger than the screen, so the grid stays small
+    constexpr uint32_t MAX_CELLS_PER_AXIS = 1024;
+    float sceneSize = std::max(sceneBounds.max.x - sceneBounds.min.x, sceneBounds.max.y - sceneBounds.min.y);
+    grid.cellSize = std::max(1.0f / cellsPerUnit, sceneSize / (MAX_CELLS_PER_AXIS - 2 * bandCells));
+    grid.band = bandCells * grid.cellSize;
+    grid.origin = {sceneBounds.min.x - grid.band, sceneBounds.min.y - grid.band};
+    grid.columns = std::ceil((sceneBounds.max.x + grid.band - grid.origin.x) / grid.cellSize);
+    grid.rows = std::ceil((sceneBounds.max.y + grid.band - grid.origin.y) / grid.cellSize);
+    grid.columns = std::clamp(grid.columns, 1u, MAX_CELLS_PER_AXIS);
+    grid.rows = std::clamp(grid.rows, 1u, MAX_CELLS_PER_AXIS);
+
+    // An item goes in every cell its bounds grown by the band overlap
+    auto forEachCell = [&](uint32_t index, auto &&function) {
+        const Bounds &bounds = itemBounds[index];
+        auto cell = [&](float coordinate, float origin, uint32_t count) {
+            return (uint32_t) std::clamp((int32_t) std::floor((coordinate - origin) / grid.cellSize), 0,
+                                         (int32_t) count - 1);
+        };
+        uint32_t minColumn = cell(bounds.min.x - grid.band, grid.origin.x, grid.columns);
+        uint32_t maxColumn = cell(bounds.max.x + grid.band, grid.origin.x, grid.columns);
+        uint32_t minRow = cell(bounds.min.y - grid.band, grid.origin.y, grid.rows);
+        uint32_t maxRow = cell(bounds.max.y + grid.band, grid.origin.y, grid.rows);
+        for (uint32_t row = minRow; row <= maxRow; row++) {
+            for (uint32_t column = minColumn; column <= maxColumn; column++) {
+                Bounds cellBounds{{grid.origin.x + column * grid.cellSize, grid.origin.y + row * grid.cellSize},
+                                  {grid.origin.x + (column + 1) * grid.cellSize,
+                                   grid.origin.y + (row + 1) * grid.cellSize}};
+                if (overlaps(index, cellBounds)) {
+                    function(row * grid.columns + column);
+                }
+            }
+        }
+    };
+
+    grid.cellRanges.assign(grid.columns * grid.rows, {});
+    for (uint32_t i = 0; i < itemBounds.size(); i++) {
+        forEachCell(i, [&](uint32_t cellIndex) { grid.cellRanges[cellIndex].count++; });
+    }
+
+    uint32_t offset = 0;
+    for (auto &cellRange: grid.cellRanges) {
+        cellRange.offset = offset;
+        offset += cellRange.count;
+        cellRange.count = 0;
+    }
+
+    grid.cellPrimitives.resize(offset);
+    for (uint32_t i = 0; i < itemBounds.size(); i++) {
+        forEachCell(i, [&](uint32_t cellIndex) {
+            CellRange &cellRange = grid.cellRanges[cellIndex];
+            grid.cellPrimitives[cellRange.offset + cellRange.count++] = i;
+        });
+    }
+
+    return grid;
+}
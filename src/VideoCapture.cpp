@@ -0,0 +1,291 @@
+#include <VideoCapture.h>
+
+#include <chrono>
+#include <format>
+
+#include <Shaders/ConvertVideoFrame.h>
+
+void VideoCapture::Init(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight, uint32_t slotCount) {
+    if (slotCount <= framesInFlight) {
+        throw std::runtime_error("Video capture needs more slots than frames in flight");
+    }
+
+    m_device = device;
+    m_allocator = allocator;
+    m_framesInFlight = framesInFlight;
+    m_slots = std::vector<Slot>(slotCount);
+
+    PipelineBuilder pipelineBuilder(device);
+
+    pipelineBuilder.AddShaderStage(ConvertVideoFrame, sizeof(ConvertVideoFrame), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkDescriptorSetLayoutBinding convertDescriptorSetLayoutBinding{};
+    convertDescriptorSetLayoutBinding.binding = 0;
+    convertDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    convertDescriptorSetLayoutBinding.descriptorCount = 1;
+    convertDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    convertDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+    pipelineBuilder.AddBinding(0, convertDescriptorSetLayoutBinding);
+    convertDescriptorSetLayoutBinding.binding = 1;
+    convertDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pipelineBuilder.AddBinding(0, convertDescriptorSetLayoutBinding);
+
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    // One copy per slot, rewritten when the slot is reused
+    pipelineBuilder.SetDescriptorSetCopies(slotCount);
+    pipelineBuilder.SetPushConstantSize<PushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    m_convertPipeline = pipelineBuilder.Build();
+}
+
+void VideoCapture::Destroy() {
+    if (m_recording) {
+        // Every recorded frame is complete once the device is idle
+        Stop();
+        m_frameNumber += m_framesInFlight;
+        BeginFrame();
+    }
+
+    for (auto &slot: m_slots) {
+        if (slot.buffer.Initialized()) {
+            DestroyBuffer(m_allocator, slot.buffer);
+        }
+    }
+    m_slots.clear();
+    m_convertPipeline.Destroy();
+}
+
+VkDeviceSize VideoCapture::GetFrameBytes() const {
+    VkDeviceSize pixels = static_cast<VkDeviceSize>(m_extent.width) * m_extent.height;
+    return m_format == Y4M ? pixels * 3 / 2 : pixels * 3;
+}
+
+bool VideoCapture::Start(const std::string &target, VkExtent2D extent, Format format, uint32_t framesPerSecond,
+                         LagPolicy lagPolicy) {
+    if (m_recording) {
+        std::print("Video capture already running\n");
+        return false;
+    }
+
+    m_extent = {extent.width / 8 * 8, extent.height / 2 * 2};
+    if (m_extent.width == 0 || m_extent.height == 0) {
+        std::print("Video capture needs at least 8x2 pixels, got {}x{}\n", extent.width, extent.height);
+        return false;
+    }
+
+    m_streamIsPipe = target.starts_with('|');
+    m_stream = m_streamIsPipe ? popen(target.substr(1).c_str(), "w") : std::fopen(target.c_str(), "wb");
+    if (m_stream == nullptr) {
+        std::print("Failed to open video capture target {}\n", target);
+        return false;
+    }
+
+    m_format = format;
+    m_lagPolicy = lagPolicy;
+    if (format == Y4M) {
+        std::string header = std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+                                         m_extent.width, m_extent.height, framesPerSecond);
+        std::fwrite(header.data(), 1, header.size(), m_stream);
+    }
+
+    // Buffers from a previous capture are kept when they are large enough
+    for (auto &slot: m_slots) {
+        VmaAllocationInfo allocationInfo{};
+        if (slot.buffer.Initialized()) {
+            vmaGetAllocationInfo(m_allocator, slot.buffer.memory, &allocationInfo);
+        }
+        if (!slot.buffer.Initialized() || allocationInfo.size < GetFrameBytes()) {
+            if (slot.buffer.Initialized()) {
+                DestroyBuffer(m_allocator, slot.buffer);
+            }
+            // Written by the GPU and read by the host, cached host memory keeps the writer fast
+            slot.buffer = CreateBuffer(m_allocator, GetFrameBytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                       VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                                       VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        }
+    }
+
+    m_written = 0;
+    m_dropped = 0;
+    m_blockedMilliseconds = 0.0;
+    m_lagging = false;
+    m_nextSlot = 0;
+    m_writerExit = false;
+    m_stopping = false;
+    m_recording = true;
+    m_writer = std::thread([this] { WriterLoop(); });
+
+    std::print("Video capture started: {}x{} {} to {}\n", m_extent.width, m_extent.height,
+               format == Y4M ? "Y4M" : "RGB24", target);
+    return true;
+}
+
+void VideoCapture::Stop() {
+    if (m_recording) {
+        m_stopping = true;
+    }
+}
+
+void VideoCapture::BeginFrame() {
+    m_frameNumber++;
+    if (!m_recording) {
+        return;
+    }
+
+    // Ring order is frame order, so the ready frames are queued in the order they were recorded
+    bool recordedLeft = false;
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+        Slot &slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+        if (slot.state.load(std::memory_order_acquire) != RECORDED) {
+            continue;
+        }
+        if (slot.readyFrame > m_frameNumber) {
+            recordedLeft = true;
+            continue;
+        }
+
+        VK_CHECK(vmaInvalidateAllocation(m_allocator, slot.buffer.memory, 0, VK_WHOLE_SIZE));
+        slot.state.store(WRITING, std::memory_order_relaxed);
+        {
+            std::lock_guard lock(m_mutex);
+            m_writeQueue.push_back((m_nextSlot + i) % m_slots.size());
+        }
+        m_writerCondition.notify_one();
+    }
+
+    if (m_stopping && !recordedLeft) {
+        Finish();
+    }
+}
+
+void VideoCapture::Finish() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_writerExit = true;
+    }
+    m_writerCondition.notify_one();
+    m_writer.join();
+
+    if (m_streamIsPipe) {
+        pclose(m_stream);
+    } else {
+        std::fclose(m_stream);
+    }
+    m_stream = nullptr;
+    m_recording = false;
+    m_stopping = false;
+
+    std::print("Video capture stopped: {} frames written, {} dropped, {:.1f} ms blocked on the writer\n",
+               m_written.load(), m_dropped, m_blockedMilliseconds);
+}
+
+void VideoCapture::RecordFrame(VkCommandBuffer cmd, const Image &displayImage) {
+    if (!m_recording || m_stopping) {
+        return;
+    }
+
+    uint32_t slotIndex = m_nextSlot;
+    Slot &slot = m_slots[slotIndex];
+    // With more slots than frames in flight, the next slot was recorded long enough ago that BeginFrame already
+    // handed it to the writer, so waiting on it always ends
+    if (slot.state.load(std::memory_order_acquire) != FREE) {
+        if (m_lagPolicy == DROP) {
+            if (!m_lagging) {
+                std::print("Video capture: the writer is lagging, dropping frames\n");
+            }
+            m_lagging = true;
+            m_dropped++;
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock lock(m_mutex);
+        m_freeCondition.wait(lock, [&] { return slot.state.load(std::memory_order_acquire) == FREE; });
+        m_blockedMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count();
+    } else if (m_lagging) {
+        std::print("Video capture: the writer caught up after {} dropped frames\n", m_dropped);
+        m_lagging = false;
+    }
+
+    // The copy of this slot was last used by the frame that filled it, which is complete
+    VkDescriptorImageInfo descriptorImageInfoDisplayImage{};
+    descriptorImageInfoDisplayImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    descriptorImageInfoDisplayImage.imageView = displayImage.view;
+    descriptorImageInfoDisplayImage.sampler = VK_NULL_HANDLE;
+    m_convertPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &descriptorImageInfoDisplayImage,
+                                           nullptr, slotIndex);
+
+    VkDescriptorBufferInfo descriptorBufferInfo{};
+    descriptorBufferInfo.buffer = slot.buffer.buffer;
+    descriptorBufferInfo.offset = 0;
+    descriptorBufferInfo.range = GetFrameBytes();
+    m_convertPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &descriptorBufferInfo,
+                                           slotIndex);
+
+    // Display writes -> conversion reads
+    VkMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    PushConstant pushConstant{m_extent.width, m_extent.height, (uint32_t) m_format};
+
+    m_convertPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, slotIndex);
+    m_convertPipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+    m_convertPipeline.Dispatch(cmd, (m_extent.width / 8 + 7) / 8, (m_extent.height / 2 + 7) / 8, 1);
+
+    // Conversion writes -> host read, made visible by the fence the frame loop waits on
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    slot.readyFrame = m_frameNumber + m_framesInFlight;
+    slot.state.store(RECORDED, std::memory_order_relaxed);
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+}
+
+void VideoCapture::WriterLoop() {
+    static constexpr char FRAME_HEADER[] = "FRAME\n";
+
+    while (true) {
+        uint32_t slotIndex;
+        {
+            std::unique_lock lock(m_mutex);
+            m_writerCondition.wait(lock, [this] { return m_writerExit || !m_writeQueue.empty(); });
+            if (m_writeQueue.empty()) {
+                break;
+            }
+            slotIndex = m_writeQueue.front();
+            m_writeQueue.pop_front();
+        }
+
+        Slot &slot = m_slots[slotIndex];
+        // A slow pipe consumer blocks here, not on the render thread
+        if (m_format == Y4M) {
+            std::fwrite(FRAME_HEADER, 1, sizeof(FRAME_HEADER) - 1, m_stream);
+        }
+        std::fwrite(slot.buffer.mapped, 1, GetFrameBytes(), m_stream);
+        m_written++;
+
+        {
+            std::lock_guard lock(m_mutex);
+            slot.state.store(FREE, std::memory_order_release);
+        }
+        m_freeCondition.notify_all();
+    }
+
+    std::fflush(m_stream);
+}
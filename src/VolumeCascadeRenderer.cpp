@@ -0,0 +1,444 @@
+#include <VolumeCascadeRenderer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+
+#include <Shaders/EvaluateVolumeSDF.h>
+#include <Shaders/RaymarchVolumeSDF.h>
+#include <Shaders/MergeVolumeCascades.h>
+#include <Shaders/BuildGIVolume.h>
+#include <Shaders/FinalPassVolume.h>
+
+namespace {
+    // Filterable everywhere, unlike RGBA32F, and half the memory which matters more in 3D. Matches the image formats
+    // declared in the volume shaders.
+    constexpr VkFormat VOLUME_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VkImageCreateInfo VolumeImageCreateInfo(VkExtent3D extent, VkFormat format) {
+        VkImageCreateInfo imgCreateInfo{};
+        imgCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imgCreateInfo.imageType = VK_IMAGE_TYPE_3D;
+        imgCreateInfo.extent = extent;
+        imgCreateInfo.mipLevels = 1;
+        imgCreateInfo.arrayLayers = 1;
+        imgCreateInfo.format = format;
+
+        imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imgCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imgCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        return imgCreateInfo;
+    }
+
+    VkDescriptorSetLayoutBinding ComputeBinding(uint32_t binding, VkDescriptorType type) {
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding = binding;
+        layoutBinding.descriptorType = type;
+        layoutBinding.descriptorCount = 1;
+        layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        layoutBinding.pImmutableSamplers = nullptr;
+        return layoutBinding;
+    }
+
+    VkDescriptorImageInfo StorageImageInfo(const Image &image) {
+        return {VK_NULL_HANDLE, image.view, VK_IMAGE_LAYOUT_GENERAL};
+    }
+
+    void Normalize(float v[3]) {
+        float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (int i = 0; i < 3; i++) {
+            v[i] /= length;
+        }
+    }
+
+    void Cross(const float a[3], const float b[3], float out[3]) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+}
+
+void VolumeCascadeRenderer::Init(VkDevice device, VmaAllocator allocator, uint32_t volumeResolution,
+                                 const RadianceCascadeSettings &settings, uint32_t framesInFlight) {
+    this->device = device;
+    this->allocator = allocator;
+    this->volumeResolution = volumeResolution;
+    this->radianceCascadeSettings = settings;
+    this->radianceCascadeSettings.maxLevel = std::clamp(settings.maxLevel, 1u, (uint32_t) MAX_VOLUME_LEVEL);
+    this->framesInFlight = framesInFlight;
+
+    VkSamplerCreateInfo samplerCreateInfo{};
+    samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+    samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.maxAnisotropy = 1.0f;
+    samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+    VK_CHECK(vkCreateSampler(device, &samplerCreateInfo, nullptr, &linearSampler));
+
+    PipelineBuilder pipelineBuilder(device);
+
+    // SDF and albedo volumes, then the primitives
+    pipelineBuilder.AddShaderStage(EvaluateVolumeSDF, sizeof(EvaluateVolumeSDF), VK_SHADER_STAGE_COMPUTE_BIT);
+    pipelineBuilder.AddBinding(0, ComputeBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.AddBinding(0, ComputeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.AddBinding(0, ComputeBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER));
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<EvaluateVolumeSDFPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    evaluateVolumeSDFPipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    // SDF volume, cascade level
+    pipelineBuilder.AddShaderStage(RaymarchVolumeSDF, sizeof(RaymarchVolumeSDF), VK_SHADER_STAGE_COMPUTE_BIT);
+    pipelineBuilder.AddBinding(0, ComputeBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER));
+    pipelineBuilder.AddBinding(0, ComputeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<RaymarchVolumePushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    for (int i = 0; i < MAX_VOLUME_LEVEL; i++) {
+        raymarchPipelines.push_back(pipelineBuilder.Build());
+    }
+
+    pipelineBuilder.Reset();
+
+    // Level above, level merged into
+    pipelineBuilder.AddShaderStage(MergeVolumeCascades, sizeof(MergeVolumeCascades), VK_SHADER_STAGE_COMPUTE_BIT);
+    pipelineBuilder.AddBinding(0, ComputeBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.AddBinding(0, ComputeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<MergeVolumeCascadesPushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    for (int i = 0; i < MAX_VOLUME_LEVEL; i++) {
+        mergeCascadesPipelines.push_back(pipelineBuilder.Build());
+    }
+
+    pipelineBuilder.Reset();
+
+    // Level 0, GI
+    pipelineBuilder.AddShaderStage(BuildGIVolume, sizeof(BuildGIVolume), VK_SHADER_STAGE_COMPUTE_BIT);
+    pipelineBuilder.AddBinding(0, ComputeBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.AddBinding(0, ComputeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+
+    buildGIVolumePipeline = pipelineBuilder.Build();
+
+    pipelineBuilder.Reset();
+
+    // SDF, albedo and GI volumes, output
+    pipelineBuilder.AddShaderStage(FinalPassVolume, sizeof(FinalPassVolume), VK_SHADER_STAGE_COMPUTE_BIT);
+    for (uint32_t binding = 0; binding < 3; binding++) {
+        pipelineBuilder.AddBinding(0, ComputeBinding(binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER));
+    }
+    pipelineBuilder.AddBinding(0, ComputeBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    pipelineBuilder.SetPipelineType(Pipeline::COMPUTE);
+    pipelineBuilder.SetDescriptorSetCopies(framesInFlight);
+    pipelineBuilder.SetPushConstantSize<FinalPassVolumePushConstant>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+    finalPassPipeline = pipelineBuilder.Build();
+
+    VkExtent3D volumeExtent{volumeResolution, volumeResolution, volumeResolution};
+    sdfVolume = CreateImage(device, VolumeImageCreateInfo(volumeExtent, VOLUME_FORMAT), allocator);
+    albedoVolume = CreateImage(device, VolumeImageCreateInfo(volumeExtent, ALBEDO_FORMAT), allocator);
+    sdfVolumesCreated = true;
+
+    CreateCascadeImages();
+    SetPrimitives({});
+}
+
+void VolumeCascadeRenderer::Destroy() {
+    deletionQueue.FlushAll();
+    evaluateVolumeSDFPipeline.Destroy();
+    for (auto &raymarchPipeline: raymarchPipelines) {
+        raymarchPipeline.Destroy();
+    }
+    for (auto &mergeCascadesPipeline: mergeCascadesPipelines) {
+        mergeCascadesPipeline.Destroy();
+    }
+    buildGIVolumePipeline.Destroy();
+    finalPassPipeline.Destroy();
+    for (auto &cascadeVolume: cascadeVolumes) {
+        DestroyImage(device, allocator, cascadeVolume);
+    }
+    DestroyImage(device, allocator, globalIlluminationVolume);
+    DestroyImage(device, allocator, sdfVolume);
+    DestroyImage(device, allocator, albedoVolume);
+    DestroyBuffer(allocator, primitiveBuffer);
+    vkDestroySampler(device, linearSampler, nullptr);
+}
+
+uint32_t VolumeCascadeRenderer::GetCascadeWidth() const {
+    return GetCascadeWidth(radianceCascadeSettings);
+}
+
+uint32_t VolumeCascadeRenderer::GetCascadeWidth(const RadianceCascadeSettings &settings) {
+    // Same probe count at the last level as the 2D cascade has vertically
+    return settings.verticalProbeCountAtMaxLevel << settings.maxLevel;
+}
+
+void VolumeCascadeRenderer::CreateCascadeImages() {
+    cascadeVolumes.clear();
+
+    uint32_t cascadeWidth = GetCascadeWidth();
+    for (uint32_t level = 0; level < radianceCascadeSettings.maxLevel; level++) {
+        // A probe layer per slice, its directions tiled in the other two
+        VkExtent3D extent{cascadeWidth, cascadeWidth, cascadeWidth >> (level + 1)};
+        cascadeVolumes.push_back(CreateImage(device, VolumeImageCreateInfo(extent, VOLUME_FORMAT), allocator));
+    }
+
+    uint32_t probeCount = cascadeWidth / 2;
+    globalIlluminationVolume = CreateImage(device,
+                                           VolumeImageCreateInfo({probeCount, probeCount, probeCount}, VOLUME_FORMAT),
+                                           allocator);
+    cascadeVolumesCreated = true;
+
+    std::print("Volume cascade resolution: {}x{}, {} probes per side at level 0\n", cascadeWidth, cascadeWidth,
+               probeCount);
+}
+
+void VolumeCascadeRenderer::SetSettings(const RadianceCascadeSettings &settings) {
+    radianceCascadeSettings = settings;
+    radianceCascadeSettings.maxLevel = std::clamp(settings.maxLevel, 1u, (uint32_t) MAX_VOLUME_LEVEL);
+
+    for (auto &cascadeVolume: cascadeVolumes) {
+        RetireImage(cascadeVolume);
+    }
+    RetireImage(globalIlluminationVolume);
+
+    CreateCascadeImages();
+}
+
+void VolumeCascadeRenderer::RetireImage(const Image &image) {
+    // Recorded frames up to the current one may still use it
+    deletionQueue.Push(frameNumber + framesInFlight, [this, image] {
+        DestroyImage(device, allocator, image);
+    });
+}
+
+void VolumeCascadeRenderer::SetPrimitives(std::span<const Primitive> primitives) {
+    if (primitiveBuffer.Initialized()) {
+        Buffer buffer = primitiveBuffer;
+        deletionQueue.Push(frameNumber + framesInFlight, [this, buffer] {
+            DestroyBuffer(allocator, buffer);
+        });
+    }
+
+    primitiveCount = primitives.size();
+    // Never empty so the descriptor stays valid, the shader reads primitiveCount entries
+    VkDeviceSize size = std::max<size_t>(primitives.size(), 1) * sizeof(Primitive);
+    primitiveBuffer = CreateBuffer(allocator, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                   VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                   VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    std::memcpy(primitiveBuffer.mapped, primitives.data(), primitives.size() * sizeof(Primitive));
+    VK_CHECK(vmaFlushAllocation(allocator, primitiveBuffer.memory, 0, size));
+    sceneDirty = true;
+}
+
+std::vector<VolumeCascadeRenderer::Primitive> VolumeCascadeRenderer::CreateDemoScene() {
+    auto box = [](float x, float y, float z, float sx, float sy, float sz, float r, float g, float b) {
+        return Primitive{{x, y, z}, Primitive::BOX, {sx, sy, sz}, 0.0f, {0.0f, 0.0f, 0.0f}, 0.0f, {r, g, b}, 0.0f};
+    };
+
+    std::vector<Primitive> primitives{
+        // Floor, ceiling and back wall, open towards -z
+        box(0.5f, 0.06f, 0.5f, 0.44f, 0.02f, 0.44f, 0.8f, 0.8f, 0.8f),
+        box(0.5f, 0.94f, 0.5f, 0.44f, 0.02f, 0.44f, 0.8f, 0.8f, 0.8f),
+        box(0.5f, 0.5f, 0.94f, 0.44f, 0.44f, 0.02f, 0.8f, 0.8f, 0.8f),
+        // Red and green side walls
+        box(0.06f, 0.5f, 0.5f, 0.02f, 0.44f, 0.44f, 0.8f, 0.1f, 0.1f),
+        box(0.94f, 0.5f, 0.5f, 0.02f, 0.44f, 0.44f, 0.1f, 0.8f, 0.1f),
+        // Blockers
+        box(0.35f, 0.24f, 0.6f, 0.1f, 0.16f, 0.1f, 0.8f, 0.8f, 0.8f),
+        {{0.66f, 0.2f, 0.4f}, Primitive::SPHERE, {0.12f, 0.0f, 0.0f}, 0.0f, {0.0f, 0.0f, 0.0f}, 0.0f,
+         {0.8f, 0.8f, 0.8f}, 0.0f},
+    };
+
+    // Light panel just under the ceiling
+    Primitive light = box(0.5f, 0.9f, 0.5f, 0.14f, 0.015f, 0.14f, 1.0f, 1.0f, 1.0f);
+    light.emission[0] = 20.0f;
+    light.emission[1] = 18.0f;
+    light.emission[2] = 15.0f;
+    primitives.push_back(light);
+
+    return primitives;
+}
+
+VkDeviceSize VolumeCascadeRenderer::GetImageMemoryBytes() const {
+    VkDeviceSize bytes = 0;
+    auto addImage = [&](const Image &image) {
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(allocator, image.memory, &allocationInfo);
+        bytes += allocationInfo.size;
+    };
+
+    addImage(sdfVolume);
+    addImage(albedoVolume);
+    for (const auto &cascadeVolume: cascadeVolumes) {
+        addImage(cascadeVolume);
+    }
+    addImage(globalIlluminationVolume);
+
+    return bytes;
+}
+
+void VolumeCascadeRenderer::BeginFrame() {
+    frameNumber++;
+    deletionQueue.Flush(frameNumber);
+}
+
+// The copy of this frame was last bound framesInFlight frames ago, which BeginFrame guarantees is complete
+void VolumeCascadeRenderer::WriteDescriptors(uint32_t copy, const Image &output) {
+    VkDescriptorImageInfo sdfVolumeInfo = StorageImageInfo(sdfVolume);
+    VkDescriptorImageInfo albedoVolumeInfo = StorageImageInfo(albedoVolume);
+    evaluateVolumeSDFPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &sdfVolumeInfo, nullptr,
+                                                   copy);
+    evaluateVolumeSDFPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &albedoVolumeInfo,
+                                                   nullptr, copy);
+
+    VkDescriptorBufferInfo primitiveBufferInfo{primitiveBuffer.buffer, 0, VK_WHOLE_SIZE};
+    evaluateVolumeSDFPipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+                                                   &primitiveBufferInfo, copy);
+
+    VkDescriptorImageInfo sdfVolumeSamplerInfo{linearSampler, sdfVolume.view, VK_IMAGE_LAYOUT_GENERAL};
+    for (uint32_t level = 0; level < radianceCascadeSettings.maxLevel; level++) {
+        VkDescriptorImageInfo cascadeInfo = StorageImageInfo(cascadeVolumes[level]);
+        raymarchPipelines[level].WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      &sdfVolumeSamplerInfo, nullptr, copy);
+        raymarchPipelines[level].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &cascadeInfo, nullptr,
+                                                      copy);
+
+        if (level + 1 < radianceCascadeSettings.maxLevel) {
+            VkDescriptorImageInfo inputCascadeInfo = StorageImageInfo(cascadeVolumes[level + 1]);
+            mergeCascadesPipelines[level].WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                               &inputCascadeInfo, nullptr, copy);
+            mergeCascadesPipelines[level].WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &cascadeInfo,
+                                                               nullptr, copy);
+        }
+    }
+
+    VkDescriptorImageInfo level0Info = StorageImageInfo(cascadeVolumes[0]);
+    VkDescriptorImageInfo giVolumeInfo = StorageImageInfo(globalIlluminationVolume);
+    buildGIVolumePipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &level0Info, nullptr, copy);
+    buildGIVolumePipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &giVolumeInfo, nullptr, copy);
+
+    VkDescriptorImageInfo albedoVolumeSamplerInfo{linearSampler, albedoVolume.view, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo giVolumeSamplerInfo{linearSampler, globalIlluminationVolume.view, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo outputInfo = StorageImageInfo(output);
+    finalPassPipeline.WriteToDescriptorSet(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &sdfVolumeSamplerInfo,
+                                           nullptr, copy);
+    finalPassPipeline.WriteToDescriptorSet(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedoVolumeSamplerInfo,
+                                           nullptr, copy);
+    finalPassPipeline.WriteToDescriptorSet(0, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &giVolumeSamplerInfo,
+                                           nullptr, copy);
+    finalPassPipeline.WriteToDescriptorSet(0, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &outputInfo, nullptr, copy);
+}
+
+void VolumeCascadeRenderer::RecordFrameCommands(VkCommandBuffer cmd, const Image &output, VkExtent2D outputExtent,
+                                                const Camera &camera, GpuTimer &gpuTimer) {
+    uint32_t copy = frameNumber % framesInFlight;
+    WriteDescriptors(copy, output);
+
+    if (sdfVolumesCreated) {
+        TransitionImage(cmd, sdfVolume.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        TransitionImage(cmd, albedoVolume.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        sdfVolumesCreated = false;
+    }
+
+    if (cascadeVolumesCreated) {
+        for (auto &cascadeVolume: cascadeVolumes) {
+            TransitionImage(cmd, cascadeVolume.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        TransitionImage(cmd, globalIlluminationVolume.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        cascadeVolumesCreated = false;
+    }
+
+    if (sceneDirty) {
+        sceneDirty = false;
+
+        // Frames still in flight may be reading the volume
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        EvaluateVolumeSDFPushConstant pushConstant{primitiveCount};
+        uint32_t groupCount = (volumeResolution + 3) / 4;
+
+        gpuTimer.BeginPass(cmd, "Evaluate volume");
+        evaluateVolumeSDFPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+        evaluateVolumeSDFPipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+        evaluateVolumeSDFPipeline.Dispatch(cmd, groupCount, groupCount, groupCount);
+        gpuTimer.EndPass(cmd);
+    }
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    uint32_t cascadeWidth = GetCascadeWidth();
+    uint32_t cascadeGroups = (cascadeWidth + 7) / 8;
+
+    // The levels do not depend on each other, no barrier between them
+    RaymarchVolumePushConstant raymarchPushConstant{radianceCascadeSettings};
+    for (uint32_t level = 0; level < radianceCascadeSettings.maxLevel; level++) {
+        raymarchPushConstant.currentLevel = level;
+        gpuTimer.BeginPass(cmd, std::format("Raymarch volume level {}", level));
+        raymarchPipelines[level].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+        raymarchPipelines[level].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &raymarchPushConstant);
+        raymarchPipelines[level].Dispatch(cmd, cascadeGroups, cascadeGroups, cascadeWidth >> (level + 1));
+        gpuTimer.EndPass(cmd);
+    }
+
+    MergeVolumeCascadesPushConstant mergePushConstant{radianceCascadeSettings};
+    for (int level = (int) radianceCascadeSettings.maxLevel - 2; level >= 0; level--) {
+        CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        mergePushConstant.outputLevel = level;
+        gpuTimer.BeginPass(cmd, std::format("Merge volume level {}", level));
+        mergeCascadesPipelines[level].Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+        mergeCascadesPipelines[level].SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &mergePushConstant);
+        mergeCascadesPipelines[level].Dispatch(cmd, cascadeGroups, cascadeGroups, cascadeWidth >> (level + 1));
+        gpuTimer.EndPass(cmd);
+    }
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    uint32_t giGroups = (cascadeWidth / 2 + 3) / 4;
+    gpuTimer.BeginPass(cmd, "Build GI volume");
+    buildGIVolumePipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+    buildGIVolumePipeline.Dispatch(cmd, giGroups, giGroups, giGroups);
+    gpuTimer.EndPass(cmd);
+
+    CmdWaitForPipelineStage(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Orbit around the centre, y up
+    FinalPassVolumePushConstant pushConstant{};
+    float worldUp[3] = {0.0f, 1.0f, 0.0f};
+    pushConstant.eye[0] = 0.5f + camera.distance * std::cos(camera.pitch) * std::sin(camera.yaw);
+    pushConstant.eye[1] = 0.5f + camera.distance * std::sin(camera.pitch);
+    pushConstant.eye[2] = 0.5f - camera.distance * std::cos(camera.pitch) * std::cos(camera.yaw);
+    for (int i = 0; i < 3; i++) {
+        pushConstant.forward[i] = 0.5f - pushConstant.eye[i];
+    }
+    Normalize(pushConstant.forward);
+    Cross(worldUp, pushConstant.forward, pushConstant.right);
+    Normalize(pushConstant.right);
+    Cross(pushConstant.forward, pushConstant.right, pushConstant.up);
+    pushConstant.tanHalfFieldOfView = std::tan(camera.fieldOfView / 2.0f);
+    pushConstant.aspectRatio = (float) outputExtent.width / outputExtent.height;
+
+    gpuTimer.BeginPass(cmd, "Volume final pass");
+    finalPassPipeline.Bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, copy);
+    finalPassPipeline.SetPushConstant(cmd, VK_SHADER_STAGE_COMPUTE_BIT, &pushConstant);
+    finalPassPipeline.Dispatch(cmd, (outputExtent.width + 7) / 8, (outputExtent.height + 7) / 8, 1);
+    gpuTimer.EndPass(cmd);
+}
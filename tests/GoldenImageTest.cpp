@@ -0,0 +1,337 @@
+// Runs the GPU cascade pipeline headlessly on seeded brush scripts and compares displayImage, every cascade level and
+// the GI texture against stored golden images. Meant to run on lavapipe so machines without a GPU can catch kernel
+// changes that alter the lighting. Per pass timings are written next to the results.
+// Usage: GoldenImageTest --golden-dir D --output-dir D [--update-golden] [--case NAME] [--any-device]
+// Fails when golden images are missing, create them with --update-golden from a trusted build. The device name is
+// written to device.txt next to them.
+//
+
+#include <HeadlessContext.h>
+#include <RadianceCascadeRenderer.h>
+
+#include "PfmImage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <print>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+    struct Options {
+        std::filesystem::path goldenDir = "golden";
+        std::filesystem::path outputDir = "results";
+        std::string caseName;
+        bool updateGolden = false;
+        bool preferCPU = true;
+    };
+
+    Options ParseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            if (!std::strcmp(argv[i], "--update-golden")) options.updateGolden = true;
+            else if (!std::strcmp(argv[i], "--any-device")) options.preferCPU = false;
+            else if (!std::strcmp(argv[i], "--golden-dir") && i + 1 < argc) options.goldenDir = argv[++i];
+            else if (!std::strcmp(argv[i], "--output-dir") && i + 1 < argc) options.outputDir = argv[++i];
+            else if (!std::strcmp(argv[i], "--case") && i + 1 < argc) options.caseName = argv[++i];
+            else std::print("Unknown option {}\n", argv[i]);
+        }
+        return options;
+    }
+
+    struct TestCase {
+        const char *name;
+        VkExtent2D extent;
+        RadianceCascadeSettings settings;
+        uint32_t seed;
+        uint32_t strokeCount;
+        // Stroke after which the SDF is reset, strokeCount to never reset
+        uint32_t resetAfterStroke;
+    };
+
+    // Small extents keep a software rasterizer run under a few seconds per case
+    const TestCase TEST_CASES[] = {
+        {"sparse", {320, 180}, {6, 2, .01f, 1.5f, .01f, 100.f}, 1, 4, 4},
+        {"dense_wide", {400, 100}, {5, 3, .02f, 2.0f, .005f, 50.f}, 2, 12, 12},
+        {"reset_square", {256, 256}, {6, 2, .01f, 1.5f, .01f, 100.f}, 3, 8, 4},
+    };
+
+    struct Tolerance {
+        // Per channel absolute error
+        float absolute[4];
+        // Fraction of the golden value added to the absolute error
+        float relative;
+        // A ray grazing a texel edge can hit or miss depending on rounding, a few texels may flip
+        double maxBadTexelFraction;
+    };
+
+    constexpr Tolerance DISPLAY_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 0.0f}, 1e-3f, 1e-3};
+    constexpr Tolerance GI_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 1e-3f}, 1e-2f, 2e-3};
+    constexpr Tolerance CASCADE_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 1e-4f}, 1e-3f, 2e-3};
+
+    struct BrushStep {
+        std::vector<RadianceCascadeRenderer::BrushSegment> segments;
+        bool resetSDF;
+    };
+
+    // Strokes are sampled into dabs, one zero length segment per frame like a slow mouse would. Every other stroke is a
+    // black occluder.
+    std::vector<BrushStep> GenerateBrushScript(const TestCase &testCase) {
+        uint32_t state = testCase.seed;
+        auto next = [&state] {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        };
+
+        std::vector<BrushStep> steps;
+        for (uint32_t stroke = 0; stroke < testCase.strokeCount; stroke++) {
+            float startX = next() % testCase.extent.width;
+            float startY = next() % testCase.extent.height;
+            float endX = next() % testCase.extent.width;
+            float endY = next() % testCase.extent.height;
+            uint8_t radius = 2 + next() % 18;
+            bool emitter = stroke % 2 == 0;
+            uint8_t r = emitter ? next() % 256 : 0;
+            uint8_t g = emitter ? next() % 256 : 0;
+            uint8_t b = emitter ? next() % 256 : 0;
+
+            float length = std::hypot(endX - startX, endY - startY);
+            uint32_t dabCount = std::clamp<uint32_t>(length / std::max(1, radius / 2), 1, 16);
+            for (uint32_t dab = 0; dab < dabCount; dab++) {
+                float t = dabCount > 1 ? (float) dab / (dabCount - 1) : 0.0f;
+                // Dabs land on whole texels with 8 bit colors, like the original mouse brush
+                float x = (uint16_t) std::lerp(startX, endX, t);
+                float y = (uint16_t) std::lerp(startY, endY, t);
+                BrushStep step{};
+                step.segments.push_back({x, y, x, y, (float) radius, r / 256.0f, g / 256.0f, b / 256.0f});
+                steps.push_back(step);
+            }
+
+            if (stroke + 1 == testCase.resetAfterStroke && stroke + 1 < testCase.strokeCount) {
+                steps.back().resetSDF = true;
+            }
+        }
+
+        // Last frame draws nothing, so every image reflects the final SDF
+        steps.push_back({});
+
+        return steps;
+    }
+
+    bool WithinTolerance(float expected, float actual, float absolute, float relative) {
+        // The shaders divide by zero when a probe sits inside an emitter, those must stay identical
+        if (std::isnan(expected) || std::isnan(actual)) {
+            return std::isnan(expected) && std::isnan(actual);
+        }
+        if (std::isinf(expected) || std::isinf(actual)) {
+            return expected == actual;
+        }
+        return std::abs(expected - actual) <= absolute + relative * std::abs(expected);
+    }
+
+    enum class Result {
+        PASSED,
+        FAILED,
+        MISSING_GOLDEN
+    };
+
+    Result CompareImage(const std::string &name, const PfmImage &actual, const std::filesystem::path &goldenPath,
+                        const std::filesystem::path &outputPath, const Tolerance &tolerance) {
+        PfmImage golden;
+        if (!ReadRGBAPfm(goldenPath, golden)) {
+            std::print("  {:<12} missing golden {}\n", name, goldenPath.string());
+            return Result::MISSING_GOLDEN;
+        }
+
+        if (golden.width != actual.width || golden.height != actual.height) {
+            std::print("  {:<12} FAILED, size {}x{} expected {}x{}\n", name, actual.width, actual.height,
+                       golden.width, golden.height);
+            return Result::FAILED;
+        }
+
+        size_t texelCount = static_cast<size_t>(actual.width) * actual.height;
+        size_t badTexels = 0;
+        float maxError[4] = {};
+        PfmImage difference{actual.width, actual.height, std::vector<float>(texelCount * 4)};
+
+        for (size_t i = 0; i < texelCount; i++) {
+            bool bad = false;
+            for (int channel = 0; channel < 4; channel++) {
+                float expected = golden.texels[i * 4 + channel];
+                float value = actual.texels[i * 4 + channel];
+                if (!WithinTolerance(expected, value, tolerance.absolute[channel], tolerance.relative)) {
+                    bad = true;
+                }
+                float error = std::abs(expected - value);
+                if (std::isfinite(error)) {
+                    maxError[channel] = std::max(maxError[channel], error);
+                    difference.texels[i * 4 + channel] = error;
+                }
+            }
+            badTexels += bad;
+        }
+
+        double badFraction = (double) badTexels / texelCount;
+        bool passed = badFraction <= tolerance.maxBadTexelFraction;
+
+        std::print("  {:<12} {}, max error ({:.2e}, {:.2e}, {:.2e}, {:.2e}), {} texels out of tolerance\n", name,
+                   passed ? "passed" : "FAILED", maxError[0], maxError[1], maxError[2], maxError[3], badTexels);
+
+        if (!passed) {
+            std::filesystem::path differencePath = outputPath;
+            differencePath.replace_extension(".diff.pfm");
+            WriteRGBAPfm(differencePath, difference);
+        }
+
+        return passed ? Result::PASSED : Result::FAILED;
+    }
+
+    void WriteTimings(const std::filesystem::path &path, const std::string &deviceName, uint32_t frameCount,
+                      const std::vector<std::string> &passOrder,
+                      const std::map<std::string, std::vector<double> > &passTimings) {
+        std::ofstream file(path);
+        file << "{\n  \"device\": \"" << deviceName << "\",\n  \"frames\": " << frameCount << ",\n  \"passes\": [";
+        for (size_t i = 0; i < passOrder.size(); i++) {
+            const auto &timings = passTimings.at(passOrder[i]);
+            double total = 0.0;
+            for (double timing: timings) {
+                total += timing;
+            }
+            double maximum = *std::max_element(timings.begin(), timings.end());
+            file << (i ? ",\n" : "\n") << std::format(
+                R"(    {{"name": "{}", "mean_ms": {:.4f}, "max_ms": {:.4f}, "samples": {}}})", passOrder[i],
+                total / timings.size(), maximum, timings.size());
+        }
+        file << "\n  ]\n}\n";
+    }
+
+    Result RunTestCase(HeadlessContext &context, const TestCase &testCase, const Options &options) {
+        std::print("{}: {}x{}, max level {}, {} probes\n", testCase.name, testCase.extent.width,
+                   testCase.extent.height, testCase.settings.maxLevel, testCase.settings.verticalProbeCountAtMaxLevel);
+
+        GpuTimer gpuTimer;
+        gpuTimer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetQueueFamilyIndex(), 1, 32);
+
+        RadianceCascadeRenderer renderer;
+        renderer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetAllocator(), testCase.extent,
+                      testCase.settings, 1);
+
+        context.Submit([&](VkCommandBuffer cmd) { renderer.RecordInitCommands(cmd); });
+
+        std::vector<BrushStep> script = GenerateBrushScript(testCase);
+        std::vector<std::string> passOrder;
+        std::map<std::string, std::vector<double> > passTimings;
+
+        for (uint32_t frame = 0; frame < script.size(); frame++) {
+            renderer.BeginFrame();
+            context.Submit([&](VkCommandBuffer cmd) {
+                gpuTimer.BeginFrame(cmd, 0);
+                renderer.RecordFrameCommands(cmd, script[frame].segments, script[frame].resetSDF, gpuTimer);
+            });
+
+            gpuTimer.Resolve(0);
+            for (const auto &passTiming: gpuTimer.GetPassTimings()) {
+                auto &timings = passTimings[passTiming.name];
+                if (timings.empty()) {
+                    passOrder.push_back(passTiming.name);
+                }
+                timings.push_back(passTiming.milliseconds);
+            }
+        }
+
+        // Everything the lighting depends on, the cascades hold merged radiance at this point
+        std::vector<std::tuple<std::string, const Image *, VkExtent2D, const Tolerance *> > images;
+        VkExtent2D cascadeExtent = renderer.GetCascadeExtent();
+        images.emplace_back("display", &renderer.GetDisplayImage(), renderer.GetRenderExtent(), &DISPLAY_TOLERANCE);
+        images.emplace_back("gi", &renderer.GetGlobalIlluminationImage(),
+                            VkExtent2D{cascadeExtent.width / 2, cascadeExtent.height / 2}, &GI_TOLERANCE);
+        for (size_t level = 0; level < renderer.GetCascadeImages().size(); level++) {
+            images.emplace_back(std::format("cascade_{}", level), &renderer.GetCascadeImages()[level], cascadeExtent,
+                                &CASCADE_TOLERANCE);
+        }
+
+        std::filesystem::path goldenDir = options.goldenDir / testCase.name;
+        std::filesystem::path outputDir = options.outputDir / testCase.name;
+        std::filesystem::create_directories(options.updateGolden ? goldenDir : outputDir);
+
+        Result result = Result::PASSED;
+        for (const auto &[name, image, extent, tolerance]: images) {
+            PfmImage actual{extent.width, extent.height, context.ReadImage(*image, extent)};
+            std::filesystem::path fileName = name + ".pfm";
+
+            if (options.updateGolden) {
+                if (!WriteRGBAPfm(goldenDir / fileName, actual)) {
+                    std::print("  {:<12} FAILED to write {}\n", name, (goldenDir / fileName).string());
+                    result = Result::FAILED;
+                }
+                continue;
+            }
+
+            WriteRGBAPfm(outputDir / fileName, actual);
+            Result imageResult = CompareImage(name, actual, goldenDir / fileName, outputDir / fileName, *tolerance);
+            if (imageResult == Result::FAILED) {
+                result = Result::FAILED;
+            } else if (imageResult == Result::MISSING_GOLDEN && result == Result::PASSED) {
+                result = Result::MISSING_GOLDEN;
+            }
+        }
+
+        if (gpuTimer.Supported() && !passOrder.empty()) {
+            std::filesystem::create_directories(outputDir);
+            WriteTimings(outputDir / "timings.json", context.GetDeviceName(), script.size(), passOrder, passTimings);
+        }
+
+        renderer.Destroy();
+        gpuTimer.Destroy();
+
+        return result;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options = ParseOptions(argc, argv);
+
+    HeadlessContext context;
+    if (!context.Init(options.preferCPU)) {
+        context.Destroy();
+        return 1;
+    }
+
+    // Golden images are only comparable on the device they were created on
+    std::filesystem::path deviceFile = options.goldenDir / "device.txt";
+    if (options.updateGolden) {
+        std::filesystem::create_directories(options.goldenDir);
+        std::ofstream(deviceFile) << context.GetDeviceName() << '\n';
+    } else {
+        std::ifstream file(deviceFile);
+        std::string goldenDevice;
+        if (std::getline(file, goldenDevice) && goldenDevice != context.GetDeviceName()) {
+            std::print("Golden images were created on {}, running on {}\n", goldenDevice, context.GetDeviceName());
+        }
+    }
+
+    bool failed = false;
+    bool missingGolden = false;
+    for (const auto &testCase: TEST_CASES) {
+        if (!options.caseName.empty() && options.caseName != testCase.name) {
+            continue;
+        }
+
+        Result result = RunTestCase(context, testCase, options);
+        failed = failed || result == Result::FAILED;
+        missingGolden = missingGolden || result == Result::MISSING_GOLDEN;
+    }
+
+    context.Destroy();
+
+    if (missingGolden) {
+        std::print("Golden images are missing, run with --update-golden to create them\n");
+    }
+    return failed || missingGolden ? 1 : 0;
+}
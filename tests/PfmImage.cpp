@@ -0,0 +1,118 @@
+#include "PfmImage.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace {
+    std::filesystem::path AlphaPath(const std::filesystem::path &path) {
+        std::filesystem::path alphaPath = path;
+        alphaPath.replace_extension(".alpha.pfm");
+        return alphaPath;
+    }
+}
+
+bool WritePfm(const std::filesystem::path &path, uint32_t width, uint32_t height, uint32_t channels,
+              const float *data) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    // Negative scale means little endian
+    float scale = std::endian::native == std::endian::little ? -1.0f : 1.0f;
+    file << (channels == 3 ? "PF" : "Pf") << "\n" << width << " " << height << "\n" << scale << "\n";
+
+    // Rows are stored bottom to top
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    for (uint32_t y = height; y-- > 0;) {
+        file.write(reinterpret_cast<const char *>(data + y * rowSize), rowSize * sizeof(float));
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool ReadPfm(const std::filesystem::path &path, uint32_t &width, uint32_t &height, uint32_t &channels,
+             std::vector<float> &data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::string magic;
+    float scale;
+    file >> magic >> width >> height >> scale;
+    // Single whitespace before the raster
+    file.get();
+
+    if (!file || (magic != "PF" && magic != "Pf")) {
+        return false;
+    }
+
+    channels = magic == "PF" ? 3 : 1;
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    data.resize(rowSize * height);
+
+    for (uint32_t y = height; y-- > 0;) {
+        file.read(reinterpret_cast<char *>(data.data() + y * rowSize), rowSize * sizeof(float));
+    }
+
+    bool fileLittleEndian = scale < 0.0f;
+    if (fileLittleEndian != (std::endian::native == std::endian::little)) {
+        for (float &value: data) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = std::byteswap(bits);
+            std::memcpy(&value, &bits, sizeof(bits));
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool WriteRGBAPfm(const std::filesystem::path &path, const PfmImage &image) {
+    size_t texelCount = static_cast<size_t>(image.width) * image.height;
+    std::vector<float> color(texelCount * 3);
+    std::vector<float> alpha(texelCount);
+
+    for (size_t i = 0; i < texelCount; i++) {
+        color[i * 3 + 0] = image.texels[i * 4 + 0];
+        color[i * 3 + 1] = image.texels[i * 4 + 1];
+        color[i * 3 + 2] = image.texels[i * 4 + 2];
+        alpha[i] = image.texels[i * 4 + 3];
+    }
+
+    return WritePfm(path, image.width, image.height, 3, color.data()) &&
+           WritePfm(AlphaPath(path), image.width, image.height, 1, alpha.data());
+}
+
+bool ReadRGBAPfm(const std::filesystem::path &path, PfmImage &image) {
+    uint32_t colorWidth, colorHeight, colorChannels;
+    uint32_t alphaWidth, alphaHeight, alphaChannels;
+    std::vector<float> color;
+    std::vector<float> alpha;
+
+    if (!ReadPfm(path, colorWidth, colorHeight, colorChannels, color) ||
+        !ReadPfm(AlphaPath(path), alphaWidth, alphaHeight, alphaChannels, alpha)) {
+        return false;
+    }
+
+    if (colorChannels != 3 || alphaChannels != 1 || colorWidth != alphaWidth || colorHeight != alphaHeight) {
+        return false;
+    }
+
+    image.width = colorWidth;
+    image.height = colorHeight;
+    size_t texelCount = static_cast<size_t>(image.width) * image.height;
+    image.texels.resize(texelCount * 4);
+
+    for (size_t i = 0; i < texelCount; i++) {
+        image.texels[i * 4 + 0] = color[i * 3 + 0];
+        image.texels[i * 4 + 1] = color[i * 3 + 1];
+        image.texels[i * 4 + 2] = color[i * 3 + 2];
+        image.texels[i * 4 + 3] = alpha[i];
+    }
+
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Portable float map, the simplest lossless float format most image viewers open. Only 1 (Pf) or 3 (PF) channels
+// exist, RGBA images are stored as name.pfm for the color and name.alpha.pfm for the alpha.
+struct PfmImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Row major, top row first, 4 floats per texel
+    std::vector<float> texels;
+};
+
+bool WritePfm(const std::filesystem::path &path, uint32_t width, uint32_t height, uint32_t channels,
+              const float *data);
+
+bool ReadPfm(const std::filesystem::path &path, uint32_t &width, uint32_t &height, uint32_t &channels,
+             std::vector<float> &data);
+
+// path is the color file, the alpha file name is derived from it
+bool WriteRGBAPfm(const std::filesystem::path &path, const PfmImage &image);
+
+bool ReadRGBAPfm(const std::filesystem::path &path, PfmImage &image);
@@ -0,0 +1,276 @@
+// Runs the GPU cascade pipeline and the scalar CPU reference on the same brush strokes and scenes, then compares the
+// SDF, every cascade level, the GI texture and the display image. Fails when a kernel and its reference drift apart,
+// so a change to the shader semantics has to update cpu/src/ReferencePipeline.cpp too.
+// Usage: ReferenceComparisonTest [--case NAME] [--any-device]
+//
+
+#include <HeadlessContext.h>
+#include <RadianceCascadeRenderer.h>
+#include <ReferencePipeline.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+        std::string caseName;
+        bool preferCPU = true;
+    };
+
+    Options ParseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            if (!std::strcmp(argv[i], "--any-device")) options.preferCPU = false;
+            else if (!std::strcmp(argv[i], "--case") && i + 1 < argc) options.caseName = argv[++i];
+            else std::print("Unknown option {}\n", argv[i]);
+        }
+        return options;
+    }
+
+    struct TestCase {
+        const char *name;
+        VkExtent2D extent;
+        RadianceCascadeSettings settings;
+        RadianceCascadeRenderer::CascadeLayout layout;
+        bool fusedGIMerge;
+        bool multiBounce;
+        // Evaluates Scene::CreateDemo under the strokes
+        bool scene;
+        uint32_t seed;
+        uint32_t frameCount;
+    };
+
+    // The reference is single threaded, small extents keep each case under a few seconds. Step sizes do not divide
+    // the ray lengths, otherwise whether a ray takes its last step depends on rounding.
+    const TestCase TEST_CASES[] = {
+        {"probe_first", {320, 180}, {5, 2, .01f, 1.5f, .0097f, 100.f}, RadianceCascadeRenderer::PROBE_FIRST,
+         true, false, false, 1, 4},
+        {"direction_first", {320, 180}, {5, 2, .01f, 1.5f, .0097f, 100.f}, RadianceCascadeRenderer::DIRECTION_FIRST,
+         true, false, false, 2, 4},
+        {"morton_unfused", {256, 256}, {5, 2, .02f, 2.0f, .0047f, 50.f}, RadianceCascadeRenderer::MORTON,
+         false, false, false, 3, 4},
+        {"scene_bounce", {320, 180}, {5, 2, .01f, 1.5f, .0097f, 100.f}, RadianceCascadeRenderer::PROBE_FIRST,
+         true, true, true, 4, 6},
+    };
+
+    struct Tolerance {
+        // Per channel absolute error
+        float absolute[4];
+        // Fraction of the expected value added to the absolute error
+        float relative;
+        // pow and sqrt differ slightly between the CPU and the GPU, a ray grazing a surface can hit or miss and the
+        // merges spread such a flip to the levels below
+        double maxBadTexelFraction;
+    };
+
+    // The fractions are about twice the worst ones measured between the reference and a copy of it built with FMA
+    // contraction, 8 bit filtering weights and pow, sqrt, cos and sin off by up to 1e-6 relative: 1.7e-5 for the
+    // SDF, 2.1e-2 for a cascade, 1.4e-2 for the GI and the bounce, 4.1e-3 for the display. The same copy with the
+    // attenuation 5% off has 3.8e-2 to 2.6e-1 of the cascade texels, 1.2e-1 to 2.7e-1 of the GI ones and 1.4e-2 to
+    // 4.6e-2 of the display ones out of tolerance.
+    constexpr Tolerance SDF_TOLERANCE{{1e-4f, 1e-4f, 1e-4f, 1e-3f}, 1e-4f, 1e-3};
+    constexpr Tolerance DISPLAY_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 0.0f}, 1e-2f, 1e-2};
+    constexpr Tolerance GI_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 1e-3f}, 1e-2f, 3e-2};
+    constexpr Tolerance CASCADE_TOLERANCE{{1e-3f, 1e-3f, 1e-3f, 1e-4f}, 1e-2f, 5e-2};
+
+    // A few strokes per frame drawn as capsules, every other frame in black to occlude
+    std::vector<std::vector<reference::BrushSegment> > GenerateStrokes(const TestCase &testCase) {
+        uint32_t state = testCase.seed;
+        auto next = [&state] {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        };
+
+        std::vector<std::vector<reference::BrushSegment> > frames(testCase.frameCount);
+        // Last frame draws nothing, so every image reflects the final SDF
+        for (uint32_t frame = 0; frame + 1 < testCase.frameCount; frame++) {
+            bool emitter = frame % 2 == 0;
+            uint32_t segmentCount = 1 + next() % 3;
+            for (uint32_t i = 0; i < segmentCount; i++) {
+                reference::BrushSegment segment{};
+                segment.startX = next() % testCase.extent.width;
+                segment.startY = next() % testCase.extent.height;
+                segment.endX = segment.startX + (float) (next() % 81) - 40.0f;
+                segment.endY = segment.startY + (float) (next() % 81) - 40.0f;
+                segment.radius = 2 + next() % 12;
+                segment.r = emitter ? (next() % 256) / 256.0f : 0.0f;
+                segment.g = emitter ? (next() % 256) / 256.0f : 0.0f;
+                segment.b = emitter ? (next() % 256) / 256.0f : 0.0f;
+                frames[frame].push_back(segment);
+            }
+        }
+
+        return frames;
+    }
+
+    RadianceCascadeRenderer::BrushSegment ToRenderer(const reference::BrushSegment &segment) {
+        return {segment.startX, segment.startY, segment.endX, segment.endY, segment.radius, segment.r, segment.g,
+                segment.b};
+    }
+
+    bool WithinTolerance(float expected, float actual, float absolute, float relative) {
+        // Probes inside an emitter divide by zero on both sides
+        if (std::isnan(expected) || std::isnan(actual)) {
+            return std::isnan(expected) && std::isnan(actual);
+        }
+        if (std::isinf(expected) || std::isinf(actual)) {
+            return expected == actual;
+        }
+        return std::abs(expected - actual) <= absolute + relative * std::abs(expected);
+    }
+
+    bool CompareImage(const std::string &name, const std::vector<float> &actual, VkExtent2D extent,
+                      const reference::Texture &expected, const Tolerance &tolerance) {
+        if (expected.Width() != extent.width || expected.Height() != extent.height) {
+            std::print("  {:<12} FAILED, size {}x{} expected {}x{}\n", name, extent.width, extent.height,
+                       expected.Width(), expected.Height());
+            return false;
+        }
+
+        size_t texelCount = expected.Data().size();
+        size_t badTexels = 0;
+        float maxError[4] = {};
+
+        for (size_t i = 0; i < texelCount; i++) {
+            const reference::Float4 &texel = expected.Data()[i];
+            float expectedChannels[4] = {texel.x, texel.y, texel.z, texel.w};
+            bool bad = false;
+            for (int channel = 0; channel < 4; channel++) {
+                float value = actual[i * 4 + channel];
+                if (!WithinTolerance(expectedChannels[channel], value, tolerance.absolute[channel],
+                                     tolerance.relative)) {
+                    bad = true;
+                }
+                float error = std::abs(expectedChannels[channel] - value);
+                if (std::isfinite(error)) {
+                    maxError[channel] = std::max(maxError[channel], error);
+                }
+            }
+            badTexels += bad;
+        }
+
+        bool passed = (double) badTexels / texelCount <= tolerance.maxBadTexelFraction;
+
+        std::print("  {:<12} {}, max error ({:.2e}, {:.2e}, {:.2e}, {:.2e}), {} texels out of tolerance\n", name,
+                   passed ? "passed" : "FAILED", maxError[0], maxError[1], maxError[2], maxError[3], badTexels);
+
+        return passed;
+    }
+
+    bool RunTestCase(HeadlessContext &context, const TestCase &testCase) {
+        std::print("{}: {}x{}, max level {}, {} probes\n", testCase.name, testCase.extent.width,
+                   testCase.extent.height, testCase.settings.maxLevel, testCase.settings.verticalProbeCountAtMaxLevel);
+
+        GpuTimer gpuTimer;
+        gpuTimer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetQueueFamilyIndex(), 1, 32);
+
+        RadianceCascadeRenderer renderer;
+        renderer.Init(context.GetDevice(), context.GetPhysicalDevice(), context.GetAllocator(), testCase.extent,
+                      testCase.settings, 1);
+        renderer.SetCascadeLayout(testCase.layout);
+        renderer.SetFusedGIMerge(testCase.fusedGIMerge);
+
+        // The reference traces every level every frame and only has the bilinear final pass, so the comparison
+        // relies on these renderer defaults
+        if (renderer.GetGIUpsampling() != RadianceCascadeRenderer::BILINEAR || renderer.GetTemporal().enabled ||
+            renderer.GetLevelSchedule().enabled) {
+            std::print("  FAILED, the renderer no longer defaults to bilinear upsampling without temporal "
+                       "amortization and level schedule\n");
+            renderer.Destroy();
+            gpuTimer.Destroy();
+            return false;
+        }
+
+        reference::ReferencePipeline pipeline(testCase.extent.width, testCase.extent.height, testCase.settings);
+        pipeline.SetCascadeLayout(static_cast<reference::CascadeLayout>(testCase.layout));
+        pipeline.SetFilterProbes(renderer.GetProbeFiltering());
+        pipeline.SetFusedGIMerge(testCase.fusedGIMerge);
+
+        if (testCase.multiBounce) {
+            RadianceCascadeRenderer::MultiBounceSettings multiBounce{};
+            multiBounce.enabled = true;
+            renderer.SetMultiBounce(multiBounce);
+            pipeline.SetMultiBounce({true, multiBounce.blend, multiBounce.paintedAlbedo});
+        }
+
+        if (testCase.scene) {
+            Scene scene = Scene::CreateDemo();
+            renderer.SetScene(scene);
+            pipeline.SetScene(scene, scene.BuildGrid());
+        }
+
+        context.Submit([&](VkCommandBuffer cmd) { renderer.RecordInitCommands(cmd); });
+
+        for (const auto &segments: GenerateStrokes(testCase)) {
+            std::vector<RadianceCascadeRenderer::BrushSegment> brushSegments;
+            for (const auto &segment: segments) {
+                brushSegments.push_back(ToRenderer(segment));
+            }
+
+            renderer.BeginFrame();
+            context.Submit([&](VkCommandBuffer cmd) {
+                gpuTimer.BeginFrame(cmd, 0);
+                renderer.RecordFrameCommands(cmd, brushSegments, false, gpuTimer);
+            });
+            gpuTimer.Resolve(0);
+
+            pipeline.Draw(segments);
+            pipeline.Render();
+        }
+
+        VkExtent2D cascadeExtent = renderer.GetCascadeExtent();
+        VkExtent2D giExtent{cascadeExtent.width / 2, cascadeExtent.height / 2};
+
+        bool passed = true;
+        auto compare = [&](const std::string &name, const Image &image, VkExtent2D extent,
+                           const reference::Texture &expected, const Tolerance &tolerance) {
+            passed &= CompareImage(name, context.ReadImage(image, extent), extent, expected, tolerance);
+        };
+
+        compare("sdf", renderer.GetSDFImage(), renderer.GetRenderExtent(), pipeline.GetSDF(), SDF_TOLERANCE);
+        for (uint32_t level = 0; level < renderer.GetCascadeImages().size(); level++) {
+            compare(std::format("cascade_{}", level), renderer.GetCascadeImages()[level], cascadeExtent,
+                    pipeline.GetCascade(level), CASCADE_TOLERANCE);
+        }
+        compare("gi", renderer.GetGlobalIlluminationImage(), giExtent, pipeline.GetGlobalIllumination(),
+                GI_TOLERANCE);
+        if (testCase.multiBounce) {
+            compare("bounce", renderer.GetBounceImage(), giExtent, pipeline.GetBounce(), GI_TOLERANCE);
+        }
+        compare("display", renderer.GetDisplayImage(), renderer.GetRenderExtent(), pipeline.GetDisplay(),
+                DISPLAY_TOLERANCE);
+
+        renderer.Destroy();
+        gpuTimer.Destroy();
+
+        return passed;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options = ParseOptions(argc, argv);
+
+    HeadlessContext context;
+    if (!context.Init(options.preferCPU)) {
+        context.Destroy();
+        return 1;
+    }
+
+    bool failed = false;
+    for (const auto &testCase: TEST_CASES) {
+        if (!options.caseName.empty() && options.caseName != testCase.name) {
+            continue;
+        }
+
+        failed = !RunTestCase(context, testCase) || failed;
+    }
+
+    context.Destroy();
+
+    return failed ? 1 : 0;
+}